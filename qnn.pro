@@ -4,7 +4,7 @@
 #
 #-------------------------------------------------
 
-QT       += core concurrent
+QT       += core concurrent network
 
 QT       -= gui
 
@@ -18,6 +18,13 @@ INCLUDEPATH += src/
 
 QMAKE_CXXFLAGS += -std=c++11
 
+# The vector kernels use SSE2 by default. Build with "qmake CONFIG+=avx" to enable the AVX kernels
+# (the resulting library only runs on CPUs supporting AVX).
+avx {
+    msvc: QMAKE_CXXFLAGS += /arch:AVX
+    else: QMAKE_CXXFLAGS += -mavx
+}
+
 SOURCES += \
     src/network/abstractneuralnetwork.cpp \
     src/network/feedforwardnetwork.cpp \
@@ -32,7 +39,18 @@ SOURCES += \
     src/network/networktoxml.cpp \
     src/simulation/rebergrammarsimulation.cpp \
     src/ga/cuckoosearch.cpp \
-    src/simulation/abstractsimulation.cpp
+    src/simulation/abstractsimulation.cpp \
+    src/ga/populationarchive.cpp \
+    src/network/vectorfunctions.cpp \
+    src/network/feedforwardnetworkensemble.cpp \
+    src/network/spatialgrid.cpp \
+    src/ga/evaluationscheduler.cpp \
+    src/ga/evaluationcostmodel.cpp \
+    src/ga/steadystategeneticalgorithm.cpp \
+    src/ga/islandgeneticalgorithm.cpp \
+    src/ga/distributedprotocol.cpp \
+    src/ga/distributedevaluator.cpp \
+    src/ga/distributedworker.cpp
 
 HEADERS += \
     src/network/abstractneuralnetwork.h \
@@ -50,7 +68,19 @@ HEADERS += \
     src/simulation/rebergrammarsimulation.h \
     src/ga/cuckoosearch.h \
     src/randomhelper.h \
-    src/simulation/abstractsimulation.h
+    src/simulation/abstractsimulation.h \
+    src/ga/populationarchive.h \
+    src/network/vectorfunctions.h \
+    src/network/feedforwardnetworkensemble.h \
+    src/network/fixedfeedforwardnetwork.h \
+    src/network/spatialgrid.h \
+    src/ga/evaluationscheduler.h \
+    src/ga/evaluationcostmodel.h \
+    src/ga/steadystategeneticalgorithm.h \
+    src/ga/islandgeneticalgorithm.h \
+    src/ga/distributedprotocol.h \
+    src/ga/distributedevaluator.h \
+    src/ga/distributedworker.h
 
 DESTDIR = $$PWD
 
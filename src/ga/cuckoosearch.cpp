@@ -2,8 +2,7 @@
 
 #include <math.h>
 #include <QtCore/qmath.h>
-#include <QtConcurrentRun>
-#include <QFuture>
+#include <QVector>
 #include <QtAlgorithms>
 #include <random>
 #include <randomhelper.h>
@@ -11,17 +10,6 @@
 namespace {
 
 static const qint32 MAX_FORWARD_RANDOM = 256;
-
-double runSimulation(AbstractSimulation *simulation, AbstractNeuralNetwork *network, GenericGene *gene)
-{
-    // Run simulation
-    double score;
-    AbstractSimulation *newSimulation = simulation->createConfigCopy();
-    newSimulation->initialise(network, gene);
-    score = newSimulation->getScore();
-    delete newSimulation;
-    return score;
-}
 }
 
 CuckooSearch::CuckooSearch(AbstractNeuralNetwork *network, AbstractSimulation *simulation, qint32 population_size, double fitness_to_reach, qint32 max_rounds, config config, QObject *parent) :
@@ -46,46 +34,36 @@ CuckooSearch::CuckooSearch(config config, QObject *parent) :
 
 void CuckooSearch::createChildren()
 {
-    // Create new eggs
-    QList< QFuture<GeneContainer *> > newEggs;
+    // Create new eggs and evaluate them together
+    QList<GeneContainer *> newEggs;
+    QList<GenericGene *> geneList;
     for(qint32 i = 0; i < _population_size; ++i)
     {
-        // Create new container to prevent modification of the pointers
-        GeneContainer cuckoo;
-        cuckoo.fitness = _population[i].fitness;
-        cuckoo.gene = _population[i].gene;
-        cuckoo.network = _population[i].network;
-        newEggs.append(QtConcurrent::run(this, &CuckooSearch::performLevyFlight, cuckoo, _simulation));
+        GeneContainer *egg = performLevyFlight(_population[i]);
+        newEggs.append(egg);
+        geneList.append(egg->gene);
     }
+    QList<double> fitnessList = evaluateGenes(geneList);
 
     // Replace eggs
-    // Because the genes / networks may be accessed in a parallel running performLevyFlight we have to store them for now and delete them later
-    QList<GenericGene *> geneToDelete;
-    QList<AbstractNeuralNetwork *> networksToDelete;
     for(qint32 i = 0; i < _population_size; ++i)
     {
-        GeneContainer *egg = newEggs[i].result();
+        GeneContainer *egg = newEggs[i];
+        egg->fitness = fitnessList[i];
         qint32 chosenNest = RandomHelper::getRandomInt(0, _population_size-1);
         if(egg->fitness > _population[chosenNest].fitness)
         {
             // Replace egg
-            // Cache genes / networks for deletion
-            networksToDelete.append(_population[chosenNest].network);
-            geneToDelete.append(_population[chosenNest].gene);
+            delete _population[chosenNest].gene;
             _population[chosenNest] = *egg;
         }
         else
         {
             // Do not replace egg
-            // Because this genes / networks are never in the population we can delete them directly
             delete egg->gene;
-            delete egg->network;
         }
         delete egg;
     }
-    // Now we can delete the genes / networks
-    qDeleteAll(geneToDelete);
-    qDeleteAll(networksToDelete);
 }
 
 void CuckooSearch::survivorSelection()
@@ -98,45 +76,44 @@ void CuckooSearch::survivorSelection()
     for(qint32 i = 0; i < numberNests; ++i)
     {
         GeneContainer container = _population.takeFirst();
-        delete container.network;
         delete container.gene;
     }
 
-    QList< QFuture<double> > futureList;
+    QList<GenericGene *> geneList;
     QList<GeneContainer> nestList;
     for(qint32 i = 0; i < numberNests; ++i)
     {
         GeneContainer nest;
-        nest.network = _network->createConfigCopy();
         nest.gene = _network->getRandomGene();
         nest.fitness = -1.0;
         nestList.append(nest);
-        futureList.append(QtConcurrent::run(runSimulation, _simulation, nest.network, nest.gene));
+        geneList.append(nest.gene);
     }
+    QList<double> fitnessList = evaluateGenes(geneList);
     for(qint32 i = 0; i < numberNests; ++i)
     {
-        nestList[i].fitness = futureList[i].result();
+        nestList[i].fitness = fitnessList[i];
     }
     _population.append(nestList);
 }
 
-GenericGeneticAlgorithm::GeneContainer *CuckooSearch::performLevyFlight(GenericGeneticAlgorithm::GeneContainer cuckoo, AbstractSimulation *simulation)
+GenericGeneticAlgorithm::GeneContainer *CuckooSearch::performLevyFlight(GenericGeneticAlgorithm::GeneContainer cuckoo)
 {
     // Create new egg
     GeneContainer *newEgg = new GeneContainer;
     newEgg->fitness = -1.0;
-    newEgg->network = cuckoo.network->createConfigCopy();
     GenericGene *newGene = cuckoo.gene->createCopy();
 
     // Create new gene using Levy flight
-    for(int segment = 0; segment < newGene->segments().size(); ++segment)
+    for(int segment = 0; segment < newGene->numSegments(); ++segment)
     {
-        for(int i = 0; i < newGene->segments()[segment].size(); ++i)
+        qint32 *values = newGene->segment(segment);
+        for(int i = 0; i < newGene->segmentSize(); ++i)
         {
             double u = RandomHelper::getNormalDistributedDouble() * levy_sigma;
             double v = RandomHelper::getNormalDistributedDouble();
             double stepsize = levy_alpha * u/qPow(qAbs(v),(1/levy_beta));
-            qint64 newValue = qAbs((double) newGene->segments()[segment][i] + stepsize * RandomHelper::getNormalDistributedDouble());
+            qint64 newValue = qAbs((double) values[i] + stepsize * RandomHelper::getNormalDistributedDouble());
             if(Q_UNLIKELY(newValue < 0))
             {
                 newValue = 0;
@@ -145,15 +122,9 @@ GenericGeneticAlgorithm::GeneContainer *CuckooSearch::performLevyFlight(GenericG
             {
                 newValue = MAX_GENE_VALUE;
             }
-            newGene->segments()[segment][i] = newValue;
+            values[i] = newValue;
         }
     }
     newEgg->gene = newGene;
-
-    // Calculate fitness
-    AbstractSimulation *newSimulation = simulation->createConfigCopy();
-    newSimulation->initialise(newEgg->network, newEgg->gene);
-    newEgg->fitness = newSimulation->getScore();
-    delete newSimulation;
     return newEgg;
 }
@@ -68,7 +68,7 @@ protected:
     /*!
      * \brief In this function the new population is build. This is an overwritten function.
      *
-     * The building of the new population consists of performing Lévy flights and replacing eggs
+     * The building of the new population consists of performing Lévy flights, evaluating all new eggs with evaluateGenes and replacing eggs
      */
     void createChildren();
 
@@ -81,11 +81,13 @@ protected:
 
     /*!
      * \brief This function performs the Lévy flight for a single solution (cuckoo).
+     *
+     * The new egg is not evaluated, its fitness is -1.
+     *
      * \param cuckoo The initial solution
-     * \param simulation The simulation from which the fitness is calculated
-     * \return Pointer to GenericGeneticAlgorithm::GeneContainer. The caller must delete the container as well as the network / gene in the container
+     * \return Pointer to GenericGeneticAlgorithm::GeneContainer. The caller must delete the container as well as the gene in the container
      */
-    GeneContainer *performLevyFlight(GeneContainer cuckoo, AbstractSimulation *simulation);
+    GeneContainer *performLevyFlight(GeneContainer cuckoo);
 
     /*!
      * \brief Configuration of the cuckoo search
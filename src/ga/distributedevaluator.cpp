@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "distributedevaluator.h"
+#include "distributedprotocol.h"
+
+#include <QThread>
+#include <QProcess>
+#include <QLocalSocket>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <limits>
+
+/*!
+ * \brief Thread which starts, feeds and restarts one worker process
+ */
+class DistributedEvaluator::Connection : public QThread
+{
+public:
+    Connection(DistributedEvaluator *evaluator, qint32 index) :
+        QThread(),
+        _evaluator(evaluator),
+        _server_name(QString("qnn-worker-%1-%2").arg(QCoreApplication::applicationPid()).arg(index)),
+        _process(NULL),
+        _socket(NULL)
+    {
+    }
+
+protected:
+    void run()
+    {
+        qint32 restarts = 0;
+        while(true)
+        {
+            bool mismatch = false;
+            bool known_cause = false;
+            if(startWorker(&mismatch))
+            {
+                QList<Job> in_flight;
+                bool got_result = false;
+                if(serve(&in_flight, &got_result))
+                {
+                    stopWorker();
+                    return;
+                }
+                known_cause = _evaluator->requeueJobs(in_flight);
+                if(got_result)
+                {
+                    restarts = 0;
+                }
+                QNN_WARNING_MSG("Worker crashed or timed out - restarting");
+            }
+            else if(mismatch)
+            {
+                QNN_CRITICAL_MSG("Worker configuration does not match - giving up worker");
+                stopWorker();
+                _evaluator->removeConnection();
+                return;
+            }
+            stopWorker();
+
+            // A crash caused by a known gene is limited by max_attempts of that gene and does not count against the worker
+            if(!known_cause && ++restarts > _evaluator->_config.max_restarts)
+            {
+                QNN_CRITICAL_MSG("Worker can not be started - giving up worker");
+                _evaluator->removeConnection();
+                return;
+            }
+
+            QMutexLocker locker(&_evaluator->_mutex);
+            if(_evaluator->_stop)
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    /*!
+     * \brief Starts the worker process, connects to it and checks the handshake
+     * \param mismatch Set to true if the worker answered with a different handshake
+     * \return True if the worker is ready
+     */
+    bool startWorker(bool *mismatch)
+    {
+        const config &config = _evaluator->_config;
+
+        _process = new QProcess();
+        _process->setProcessChannelMode(QProcess::ForwardedChannels);
+        _process->start(config.program, QStringList(config.arguments) << _server_name);
+        if(!_process->waitForStarted(config.start_timeout))
+        {
+            return false;
+        }
+
+        // The worker needs some time until it listens
+        QElapsedTimer timer;
+        timer.start();
+        _socket = new QLocalSocket();
+        while(true)
+        {
+            _socket->connectToServer(_server_name);
+            if(_socket->waitForConnected(100))
+            {
+                break;
+            }
+            if(_process->state() == QProcess::NotRunning || timer.elapsed() > config.start_timeout)
+            {
+                delete _socket;
+                _socket = NULL;
+                return false;
+            }
+            QThread::msleep(50);
+        }
+
+        QByteArray handshake;
+        if(!DistributedProtocol::writeMessage(_socket, _evaluator->_handshake, config.start_timeout) || !DistributedProtocol::readMessage(_socket, &handshake, config.start_timeout))
+        {
+            return false;
+        }
+        *mismatch = handshake != _evaluator->_handshake;
+        return !*mismatch;
+    }
+
+    /*!
+     * \brief Sends jobs to the worker and receives the results until the evaluator shuts down
+     * \param in_flight Jobs sent to the worker without result. Contains the unfinished jobs on error
+     * \param got_result Set to true if at least one result was received
+     * \return True if the evaluator shuts down, false if the connection failed
+     */
+    bool serve(QList<Job> *in_flight, bool *got_result)
+    {
+        const config &config = _evaluator->_config;
+        while(true)
+        {
+            QList<Job> jobs;
+            if(!_evaluator->takeJobs(*in_flight, &jobs))
+            {
+                QByteArray message;
+                QDataStream stream(&message, QIODevice::WriteOnly);
+                DistributedProtocol::prepareStream(&stream);
+                stream << (quint32) DistributedProtocol::shutdown_message;
+                DistributedProtocol::writeMessage(_socket, message, config.start_timeout);
+                return true;
+            }
+
+            if(!jobs.isEmpty())
+            {
+                QByteArray message;
+                QDataStream stream(&message, QIODevice::WriteOnly);
+                DistributedProtocol::prepareStream(&stream);
+                stream << (quint32) DistributedProtocol::jobs_message;
+                stream << (quint32) jobs.length();
+                foreach(Job job, jobs)
+                {
+                    stream << job.id;
+                    stream << job.gene;
+                }
+                in_flight->append(jobs);
+                if(!DistributedProtocol::writeMessage(_socket, message, config.start_timeout))
+                {
+                    return false;
+                }
+
+                // Fill the pipeline before waiting for results
+                if(in_flight->length() < config.jobs_in_flight)
+                {
+                    continue;
+                }
+            }
+
+            if(in_flight->isEmpty())
+            {
+                continue;
+            }
+
+            QByteArray message;
+            if(!DistributedProtocol::readMessage(_socket, &message, config.evaluation_timeout))
+            {
+                return false;
+            }
+            QDataStream stream(message);
+            DistributedProtocol::prepareStream(&stream);
+            quint32 type;
+            quint32 count;
+            stream >> type;
+            stream >> count;
+            if(stream.status() != QDataStream::Ok || type != DistributedProtocol::results_message)
+            {
+                QNN_CRITICAL_MSG("Invalid message from worker");
+                return false;
+            }
+            for(quint32 i = 0; i < count; ++i)
+            {
+                qint32 id;
+                double fitness;
+                stream >> id;
+                stream >> fitness;
+                if(stream.status() != QDataStream::Ok)
+                {
+                    QNN_CRITICAL_MSG("Invalid message from worker");
+                    return false;
+                }
+                for(qint32 j = 0; j < in_flight->length(); ++j)
+                {
+                    if(in_flight->at(j).id == id)
+                    {
+                        _evaluator->finishJob(in_flight->takeAt(j), fitness);
+                        *got_result = true;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    /*!
+     * \brief Closes the connection and stops the worker process
+     */
+    void stopWorker()
+    {
+        if(_socket != NULL)
+        {
+            _socket->abort();
+            delete _socket;
+            _socket = NULL;
+        }
+        if(_process != NULL)
+        {
+            if(!_process->waitForFinished(1000))
+            {
+                _process->kill();
+                _process->waitForFinished(-1);
+            }
+            delete _process;
+            _process = NULL;
+        }
+    }
+
+    DistributedEvaluator *_evaluator;
+    QString _server_name;
+    QProcess *_process;
+    QLocalSocket *_socket;
+};
+
+DistributedEvaluator::DistributedEvaluator(AbstractNeuralNetwork *network, AbstractSimulation *simulation, config config) :
+    _config(config),
+    _network(NULL),
+    _simulation(NULL),
+    _handshake(),
+    _connections(),
+    _mutex(),
+    _jobs_available(),
+    _jobs_finished(),
+    _queue(),
+    _next_id(0),
+    _active_connections(0),
+    _stop(false)
+{
+    if(Q_UNLIKELY(network == NULL))
+    {
+        QNN_FATAL_MSG("Network might not be NULL");
+    }
+    if(Q_UNLIKELY(simulation == NULL))
+    {
+        QNN_FATAL_MSG("Simulation might not be NULL");
+    }
+    if(_config.workers == -1)
+    {
+        _config.workers = qMax(1, QThread::idealThreadCount());
+    }
+    if(Q_UNLIKELY(_config.workers <= 0 || _config.batch_size <= 0 || _config.jobs_in_flight <= 0 || _config.max_attempts <= 0 || _config.max_restarts < 0))
+    {
+        QNN_FATAL_MSG("Invalid configuration");
+    }
+
+    _network = network->createConfigCopy();
+    _simulation = simulation->createConfigCopy();
+    _handshake = DistributedProtocol::handshake(_network, _simulation);
+
+    _active_connections = _config.workers;
+    for(qint32 i = 0; i < _config.workers; ++i)
+    {
+        Connection *connection = new Connection(this, i);
+        _connections.append(connection);
+        connection->start();
+    }
+}
+
+DistributedEvaluator::~DistributedEvaluator()
+{
+    {
+        QMutexLocker locker(&_mutex);
+        _stop = true;
+        _jobs_available.wakeAll();
+    }
+    foreach(Connection *connection, _connections)
+    {
+        connection->wait();
+    }
+    qDeleteAll(_connections);
+    delete _network;
+    delete _simulation;
+}
+
+QList<double> DistributedEvaluator::evaluate(QList<GenericGene *> genes)
+{
+    Evaluation evaluation;
+    evaluation.results = QVector<double>(genes.length(), 0.0);
+    evaluation.remaining = genes.length();
+
+    QList<Job> jobs;
+    for(qint32 i = 0; i < genes.length(); ++i)
+    {
+        Job job;
+        job.evaluation = &evaluation;
+        job.index = i;
+        job.gene = DistributedProtocol::encodeGene(genes[i]);
+        job.attempts = 0;
+        job.isolated = false;
+        jobs.append(job);
+    }
+
+    QMutexLocker locker(&_mutex);
+    for(qint32 i = 0; i < jobs.length(); ++i)
+    {
+        jobs[i].id = _next_id;
+        _next_id = (_next_id + 1) % std::numeric_limits<qint32>::max();
+    }
+    _queue.append(jobs);
+    _jobs_available.wakeAll();
+
+    while(evaluation.remaining > 0)
+    {
+        if(_active_connections > 0)
+        {
+            _jobs_finished.wait(&_mutex);
+            continue;
+        }
+
+        // No worker is left. A gene might crash this process, so the remaining genes of this evaluation are given up
+        QNN_CRITICAL_MSG("No worker left - assigning fitness 0 to the remaining genes");
+        for(qint32 i = _queue.length()-1; i >= 0; --i)
+        {
+            if(_queue[i].evaluation == &evaluation)
+            {
+                _queue.removeAt(i);
+                --evaluation.remaining;
+            }
+        }
+    }
+
+    QList<double> fitnessList;
+    fitnessList.reserve(evaluation.results.size());
+    for(qint32 i = 0; i < evaluation.results.size(); ++i)
+    {
+        fitnessList.append(evaluation.results[i]);
+    }
+    return fitnessList;
+}
+
+qint32 DistributedEvaluator::activeWorkers()
+{
+    QMutexLocker locker(&_mutex);
+    return _active_connections;
+}
+
+bool DistributedEvaluator::takeJobs(const QList<Job> &in_flight, QList<Job> *jobs)
+{
+    QMutexLocker locker(&_mutex);
+    while(in_flight.isEmpty() && _queue.isEmpty() && !_stop)
+    {
+        _jobs_available.wait(&_mutex);
+    }
+    if(_stop && in_flight.isEmpty())
+    {
+        return false;
+    }
+
+    if(!_queue.isEmpty() && _queue.first().isolated)
+    {
+        if(in_flight.isEmpty())
+        {
+            jobs->append(_queue.takeFirst());
+        }
+        return true;
+    }
+    if(!in_flight.isEmpty() && in_flight.first().isolated)
+    {
+        return true;
+    }
+
+    while(!_queue.isEmpty() && !_queue.first().isolated && jobs->length() < _config.batch_size && in_flight.length() + jobs->length() < _config.jobs_in_flight)
+    {
+        jobs->append(_queue.takeFirst());
+    }
+    return true;
+}
+
+void DistributedEvaluator::finishJob(const Job &job, double fitness)
+{
+    QMutexLocker locker(&_mutex);
+    job.evaluation->results[job.index] = fitness;
+    if(--job.evaluation->remaining == 0)
+    {
+        _jobs_finished.wakeAll();
+    }
+}
+
+bool DistributedEvaluator::requeueJobs(const QList<Job> &jobs)
+{
+    QMutexLocker locker(&_mutex);
+    // If more than one job was in flight the job which caused the crash is unknown, so only isolate them
+    bool known_cause = jobs.length() == 1;
+
+    // Put the jobs back at the front in their original order
+    for(qint32 i = jobs.length()-1; i >= 0; --i)
+    {
+        Job job = jobs[i];
+        job.isolated = true;
+        if(known_cause && ++job.attempts >= _config.max_attempts)
+        {
+            QNN_WARNING_MSG("Gene crashed the worker repeatedly - assigning fitness 0");
+            job.evaluation->results[job.index] = 0.0;
+            if(--job.evaluation->remaining == 0)
+            {
+                _jobs_finished.wakeAll();
+            }
+            continue;
+        }
+        _queue.prepend(job);
+    }
+    _jobs_available.wakeAll();
+    return known_cause;
+}
+
+void DistributedEvaluator::removeConnection()
+{
+    QMutexLocker locker(&_mutex);
+    --_active_connections;
+    _jobs_finished.wakeAll();
+}
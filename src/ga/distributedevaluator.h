@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DISTRIBUTEDEVALUATOR_H
+#define DISTRIBUTEDEVALUATOR_H
+
+#include <qnn-global.h>
+
+#include "../network/abstractneuralnetwork.h"
+#include "../simulation/abstractsimulation.h"
+#include <QList>
+#include <QVector>
+#include <QStringList>
+#include <QByteArray>
+#include <QMutex>
+#include <QWaitCondition>
+
+/*!
+ * \brief The DistributedEvaluator class evaluates genes in separate worker processes.
+ *
+ * The evaluator starts config.workers processes of config.program. Each process gets the name of a local server as its last argument
+ * and must run a DistributedWorker with the same network and simulation configuration on it.
+ * The configurations are compared in a handshake (see DistributedProtocol::handshake) when the connection is created.
+ *
+ * Every worker is served by its own thread which sends the genes in batches and keeps up to config.jobs_in_flight genes at the worker,
+ * so the worker does not have to wait for the next batch. If a worker crashes or times out it is restarted and its unfinished genes are
+ * evaluated again. Because it is unknown which of the unfinished genes caused the crash, they are sent again one at a time.
+ * A gene which crashes a worker config.max_attempts times while it is evaluated alone gets the fitness 0.
+ * If no worker is left the remaining genes get the fitness 0. They are never evaluated in the calling process, because a crashing gene would end the whole run.
+ *
+ * A crash in a simulation therefore does not end the whole run. Use GenericGeneticAlgorithm::setDistributedEvaluator to use the evaluator.
+ */
+class QNNSHARED_EXPORT DistributedEvaluator
+{
+public:
+    /*!
+     * \brief This struct contains all configuration option of the distributed evaluator
+     */
+    struct config {
+        /*!
+         * \brief program holds the path of the worker executable
+         */
+        QString program;
+
+        /*!
+         * \brief arguments holds the arguments of the worker. The name of the server is appended as last argument
+         */
+        QStringList arguments;
+
+        /*!
+         * \brief workers holds the number of worker processes. If set to -1 QThread::idealThreadCount() workers are started
+         */
+        qint32 workers;
+
+        /*!
+         * \brief batch_size holds the maximum number of genes sent in one message
+         */
+        qint32 batch_size;
+
+        /*!
+         * \brief jobs_in_flight holds the maximum number of genes sent to a worker without a result
+         */
+        qint32 jobs_in_flight;
+
+        /*!
+         * \brief max_attempts holds the number of crashes after which a gene is given up. Only crashes while the gene was the only gene at the worker are counted
+         */
+        qint32 max_attempts;
+
+        /*!
+         * \brief max_restarts holds the number of restarts without a single result after which a worker is given up. Crashes caused by a known gene are not counted
+         */
+        qint32 max_restarts;
+
+        /*!
+         * \brief start_timeout holds the time in milliseconds a worker has to start and accept the connection
+         */
+        qint32 start_timeout;
+
+        /*!
+         * \brief evaluation_timeout holds the time in milliseconds a worker may take for a result. After this time the worker is restarted. -1 disables the timeout
+         */
+        qint32 evaluation_timeout;
+
+        /*!
+         * \brief Constructor for standard values
+         */
+        config() :
+            program(),
+            arguments(),
+            workers(-1),
+            batch_size(2),
+            jobs_in_flight(4),
+            max_attempts(3),
+            max_restarts(5),
+            start_timeout(30000),
+            evaluation_timeout(-1)
+        {
+        }
+    };
+
+    /*!
+     * \brief Constructor. Starts all workers
+     *
+     * The evaluator saves a deep copy of the network/simulation so the caller can delete both at any time.
+     *
+     * \param network The network used by the workers. Might not be NULL
+     * \param simulation The simulation used by the workers. Might not be NULL
+     * \param config Configuration of the evaluator
+     */
+    DistributedEvaluator(AbstractNeuralNetwork *network, AbstractSimulation *simulation, config config = config());
+
+    /*!
+     * \brief Destructor. Shuts down all workers
+     */
+    ~DistributedEvaluator();
+
+    /*!
+     * \brief Evaluates genes in the worker processes. Returns once all genes are evaluated
+     *
+     * The method may be called from several threads at once. The genes of all calls share the workers.
+     *
+     * \param genes Genes to evaluate
+     * \return Fitness of each gene
+     */
+    QList<double> evaluate(QList<GenericGene *> genes);
+
+    /*!
+     * \brief Returns the number of workers which are still used
+     * \return Number of workers
+     */
+    qint32 activeWorkers();
+
+private:
+    class Connection;
+
+    /*!
+     * \brief State of one call of evaluate
+     */
+    struct Evaluation {
+        /*!
+         * \brief Fitness of the genes
+         */
+        QVector<double> results;
+
+        /*!
+         * \brief Number of unfinished jobs
+         */
+        qint32 remaining;
+    };
+
+    /*!
+     * \brief A gene waiting for its evaluation
+     */
+    struct Job {
+        /*!
+         * \brief Id of the job sent to the worker. Unique among all queued jobs
+         */
+        qint32 id;
+
+        /*!
+         * \brief The evaluation the job belongs to
+         */
+        Evaluation *evaluation;
+
+        /*!
+         * \brief Index of the gene in its evaluation
+         */
+        qint32 index;
+
+        /*!
+         * \brief The gene in the binary gene format
+         */
+        QByteArray gene;
+
+        /*!
+         * \brief Number of worker crashes while the gene was the only gene at the worker
+         */
+        qint32 attempts;
+
+        /*!
+         * \brief True if the gene was at a crashed worker. It is sent alone until it is evaluated, so the gene causing a crash can be identified
+         */
+        bool isolated;
+    };
+
+    /*!
+     * \brief Takes jobs from the queue for a connection. Waits until jobs are available if the connection has no jobs in flight. _mutex must not be locked
+     *
+     * An isolated job is only taken if the connection has no jobs in flight and is never taken together with other jobs.
+     *
+     * \param in_flight Jobs of the connection without result
+     * \param jobs Pointer to which the jobs are appended
+     * \return False if the evaluator is shutting down and the connection has no jobs in flight
+     */
+    bool takeJobs(const QList<Job> &in_flight, QList<Job> *jobs);
+
+    /*!
+     * \brief Stores the result of a job. _mutex must not be locked
+     * \param job The finished job
+     * \param fitness Fitness of the gene
+     */
+    void finishJob(const Job &job, double fitness);
+
+    /*!
+     * \brief Puts the jobs of a crashed worker back into the queue. _mutex must not be locked
+     *
+     * The jobs are isolated. An attempt is only counted if a single job was in flight, because only then the job is known to have caused the crash.
+     *
+     * \param jobs Jobs which were in flight
+     * \return True if the crash was caused by a known job
+     */
+    bool requeueJobs(const QList<Job> &jobs);
+
+    /*!
+     * \brief Marks a connection as given up. _mutex must not be locked
+     */
+    void removeConnection();
+
+    /*!
+     * \brief Configuration of the evaluator
+     */
+    config _config;
+
+    /*!
+     * \brief The network used by the workers
+     */
+    AbstractNeuralNetwork *_network;
+
+    /*!
+     * \brief The simulation used by the workers
+     */
+    AbstractSimulation *_simulation;
+
+    /*!
+     * \brief Handshake message of this configuration
+     */
+    QByteArray _handshake;
+
+    /*!
+     * \brief Threads serving the workers
+     */
+    QList<Connection *> _connections;
+
+    /*!
+     * \brief Mutex protecting all following members
+     */
+    QMutex _mutex;
+
+    /*!
+     * \brief Signaled when jobs are queued or the evaluator shuts down
+     */
+    QWaitCondition _jobs_available;
+
+    /*!
+     * \brief Signaled when a job is finished or a connection is given up
+     */
+    QWaitCondition _jobs_finished;
+
+    /*!
+     * \brief Jobs which are not sent to a worker
+     */
+    QList<Job> _queue;
+
+    /*!
+     * \brief Id of the next job
+     */
+    qint32 _next_id;
+
+    /*!
+     * \brief Number of connections which have not been given up
+     */
+    qint32 _active_connections;
+
+    /*!
+     * \brief True if the evaluator shuts down
+     */
+    bool _stop;
+};
+
+#endif // DISTRIBUTEDEVALUATOR_H
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "distributedprotocol.h"
+
+#include <QBuffer>
+#include <QtEndian>
+#include <typeinfo>
+#include <randomhelper.h>
+
+namespace {
+static const quint32 PROTOCOL_MAGIC = 0x444e4e51; // "QNND"
+static const quint32 PROTOCOL_VERSION = 2;
+
+// Seed of the gene used to describe the network configuration in the handshake
+static const quint32 HANDSHAKE_SEED = 0x514e4e;
+
+// Frames larger than this are treated as a broken stream
+static const quint32 MAX_MESSAGE_SIZE = 256 * 1024 * 1024;
+}
+
+void DistributedProtocol::prepareStream(QDataStream *stream)
+{
+    stream->setVersion(QDataStream::Qt_5_0);
+    stream->setByteOrder(QDataStream::LittleEndian);
+}
+
+bool DistributedProtocol::writeMessage(QIODevice *device, const QByteArray &message, int timeout)
+{
+    uchar header[sizeof(quint32)];
+    qToLittleEndian<quint32>(message.size(), header);
+    if(device->write(reinterpret_cast<const char *>(header), sizeof(header)) != sizeof(header) || device->write(message) != message.size())
+    {
+        return false;
+    }
+    while(device->bytesToWrite() > 0)
+    {
+        if(!device->waitForBytesWritten(timeout))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool DistributedProtocol::readMessage(QIODevice *device, QByteArray *message, int timeout)
+{
+    while(device->bytesAvailable() < (qint64) sizeof(quint32))
+    {
+        if(!device->waitForReadyRead(timeout))
+        {
+            return false;
+        }
+    }
+    QByteArray header = device->read(sizeof(quint32));
+    quint32 size = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(header.constData()));
+    if(Q_UNLIKELY(size > MAX_MESSAGE_SIZE))
+    {
+        QNN_CRITICAL_MSG("Message too large");
+        return false;
+    }
+
+    while(device->bytesAvailable() < size)
+    {
+        if(!device->waitForReadyRead(timeout))
+        {
+            return false;
+        }
+    }
+    *message = device->read(size);
+    return true;
+}
+
+QByteArray DistributedProtocol::handshake(AbstractNeuralNetwork *network, AbstractSimulation *simulation)
+{
+    // The same seed on both sides creates the same gene if the network configurations are equal
+    QString random_state = RandomHelper::saveState();
+    RandomHelper::engine().seed(HANDSHAKE_SEED);
+    GenericGene *gene = network->getRandomGene();
+    RandomHelper::restoreState(random_state);
+
+    QString fingerprint = QString("%1;%2;%3;%4;%5;%6;%7")
+            .arg(PROTOCOL_VERSION)
+            .arg(typeid(*network).name())
+            .arg(typeid(*gene).name())
+            .arg(gene->segmentSize())
+            .arg(typeid(*simulation).name())
+            .arg(simulation->needInputLength())
+            .arg(simulation->needOutputLength());
+
+    // The network configuration is compared through the description of a network built from that gene
+    QByteArray network_config;
+    QBuffer buffer(&network_config);
+    AbstractNeuralNetwork *probe = network->createConfigCopy();
+    probe->initialise(gene);
+    if(!buffer.open(QIODevice::WriteOnly) || !probe->saveNetworkConfig(&buffer))
+    {
+        QNN_CRITICAL_MSG("Can not describe network configuration");
+    }
+    buffer.close();
+    delete probe;
+    delete gene;
+
+    QByteArray message;
+    QDataStream stream(&message, QIODevice::WriteOnly);
+    prepareStream(&stream);
+    stream << (quint32) handshake_message;
+    stream << PROTOCOL_MAGIC;
+    stream << fingerprint.toUtf8();
+    stream << network_config;
+    stream << simulation->configDescription().toUtf8();
+    return message;
+}
+
+QByteArray DistributedProtocol::encodeGene(GenericGene *gene)
+{
+    QByteArray data;
+    QBuffer buffer(&data);
+    if(!buffer.open(QIODevice::WriteOnly) || !gene->saveGeneBinary(&buffer))
+    {
+        QNN_CRITICAL_MSG("Can not encode gene");
+        return QByteArray();
+    }
+    buffer.close();
+    return data;
+}
+
+GenericGene *DistributedProtocol::decodeGene(GenericGene *prototype, const QByteArray &data)
+{
+    return prototype->loadGene(reinterpret_cast<const uchar *>(data.constData()), data.size());
+}
+
+quint32 DistributedProtocol::messageType(const QByteArray &message)
+{
+    QDataStream stream(message);
+    prepareStream(&stream);
+    quint32 type = 0;
+    stream >> type;
+    if(stream.status() != QDataStream::Ok)
+    {
+        return 0;
+    }
+    return type;
+}
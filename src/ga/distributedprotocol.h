@@ -0,0 +1,114 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DISTRIBUTEDPROTOCOL_H
+#define DISTRIBUTEDPROTOCOL_H
+
+#include <qnn-global.h>
+
+#include "../network/abstractneuralnetwork.h"
+#include "../simulation/abstractsimulation.h"
+#include <QIODevice>
+#include <QByteArray>
+#include <QDataStream>
+
+/*!
+ * \brief This namespace contains the protocol used between DistributedEvaluator and DistributedWorker.
+ *
+ * All messages are sent as a frame consisting of the length of the message (quint32, little endian) followed by the message.
+ * A message is written with a QDataStream prepared by prepareStream and starts with its MessageType:
+ *  - handshake_message: QByteArray fingerprint, QByteArray network configuration, QByteArray simulation configuration. Sent by both sides after connecting
+ *  - jobs_message: quint32 count, then count times qint32 id and QByteArray gene in the binary gene format
+ *  - results_message: quint32 count, then count times qint32 id and double fitness
+ *  - shutdown_message: no content. The worker exits after receiving it
+ *
+ * Only the device API is used, so the protocol works with every blocking QIODevice (e.g. QLocalSocket or QTcpSocket).
+ */
+namespace DistributedProtocol {
+
+/*!
+ * \brief Types of the messages
+ */
+enum MessageType {handshake_message = 1,
+                  jobs_message = 2,
+                  results_message = 3,
+                  shutdown_message = 4};
+
+/*!
+ * \brief Sets version and byte order of a stream used to read or write a message
+ * \param stream Stream to prepare
+ */
+void prepareStream(QDataStream *stream);
+
+/*!
+ * \brief Writes a message as a frame and waits until it has been written
+ * \param device Device to write to
+ * \param message Message to write
+ * \param timeout Timeout in milliseconds for each wait. -1 waits forever
+ * \return True if the message was written
+ */
+bool writeMessage(QIODevice *device, const QByteArray &message, int timeout);
+
+/*!
+ * \brief Reads a whole frame from the device
+ * \param device Device to read from
+ * \param message Pointer to which the message is written
+ * \param timeout Timeout in milliseconds for each wait. -1 waits forever
+ * \return True if a message was read. False on timeout, error or if the device was closed
+ */
+bool readMessage(QIODevice *device, QByteArray *message, int timeout);
+
+/*!
+ * \brief Creates the handshake message for a network / simulation pair.
+ *
+ * The fingerprint contains the protocol version, the types of network, gene and simulation as well as the input, output and segment sizes.
+ * The network configuration is the XML description (see AbstractNeuralNetwork::saveNetworkConfig) of a network initialised with a gene
+ * created from a fixed seed, the simulation configuration is AbstractSimulation::configDescription.
+ * Evaluator and worker only work together if their handshakes are equal.
+ *
+ * \param network Network used for the evaluation
+ * \param simulation Simulation used for the evaluation
+ * \return Handshake message
+ */
+QByteArray handshake(AbstractNeuralNetwork *network, AbstractSimulation *simulation);
+
+/*!
+ * \brief Encodes a gene in the binary gene format
+ * \param gene Gene to encode
+ * \return Encoded gene. Empty if the gene could not be saved
+ */
+QByteArray encodeGene(GenericGene *gene);
+
+/*!
+ * \brief Decodes a gene encoded by encodeGene
+ * \param prototype A gene of the type of the encoded gene. It is not modified
+ * \param data Encoded gene
+ * \return Decoded gene or NULL if the gene could not be loaded. The caller must delete the gene
+ */
+GenericGene *decodeGene(GenericGene *prototype, const QByteArray &data);
+
+/*!
+ * \brief Returns the type of a message
+ * \param message Message
+ * \return Type of the message or 0 if the message is invalid
+ */
+quint32 messageType(const QByteArray &message);
+}
+
+#endif // DISTRIBUTEDPROTOCOL_H
@@ -0,0 +1,150 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "distributedworker.h"
+#include "distributedprotocol.h"
+
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QDataStream>
+
+DistributedWorker::DistributedWorker(AbstractNeuralNetwork *network, AbstractSimulation *simulation) :
+    _network(NULL),
+    _simulation(NULL),
+    _simulation_initialised(false)
+{
+    if(Q_UNLIKELY(network == NULL))
+    {
+        QNN_FATAL_MSG("Network might not be NULL");
+    }
+    if(Q_UNLIKELY(simulation == NULL))
+    {
+        QNN_FATAL_MSG("Simulation might not be NULL");
+    }
+    _network = network->createConfigCopy();
+    _simulation = simulation->createConfigCopy();
+}
+
+DistributedWorker::~DistributedWorker()
+{
+    delete _network;
+    delete _simulation;
+}
+
+bool DistributedWorker::run(QString server_name)
+{
+    QLocalServer server;
+    QLocalServer::removeServer(server_name);
+    if(!server.listen(server_name))
+    {
+        QNN_CRITICAL_MSG("Can not listen on server");
+        return false;
+    }
+    if(!server.waitForNewConnection(-1))
+    {
+        QNN_CRITICAL_MSG("No connection from evaluator");
+        return false;
+    }
+    QLocalSocket *socket = server.nextPendingConnection();
+    server.close();
+
+    // Both sides send their handshake so the evaluator can report a mismatch
+    QByteArray own_handshake = DistributedProtocol::handshake(_network, _simulation);
+    QByteArray handshake;
+    if(!DistributedProtocol::readMessage(socket, &handshake, -1) || !DistributedProtocol::writeMessage(socket, own_handshake, -1) || handshake != own_handshake)
+    {
+        QNN_CRITICAL_MSG("Handshake failed");
+        delete socket;
+        return false;
+    }
+
+    GenericGene *prototype = _network->getRandomGene();
+    bool result = false;
+    QByteArray message;
+    while(DistributedProtocol::readMessage(socket, &message, -1))
+    {
+        QDataStream stream(message);
+        DistributedProtocol::prepareStream(&stream);
+        quint32 type;
+        stream >> type;
+        if(type == DistributedProtocol::shutdown_message)
+        {
+            result = true;
+            break;
+        }
+
+        quint32 count;
+        stream >> count;
+        if(stream.status() != QDataStream::Ok || type != DistributedProtocol::jobs_message)
+        {
+            QNN_CRITICAL_MSG("Invalid message from evaluator");
+            break;
+        }
+
+        QByteArray answer;
+        QDataStream answer_stream(&answer, QIODevice::WriteOnly);
+        DistributedProtocol::prepareStream(&answer_stream);
+        answer_stream << (quint32) DistributedProtocol::results_message;
+        answer_stream << count;
+        bool valid = true;
+        for(quint32 i = 0; i < count && valid; ++i)
+        {
+            qint32 id;
+            QByteArray data;
+            stream >> id;
+            stream >> data;
+            GenericGene *gene = stream.status() == QDataStream::Ok ? DistributedProtocol::decodeGene(prototype, data) : NULL;
+            if(gene == NULL)
+            {
+                valid = false;
+                break;
+            }
+            answer_stream << id;
+            answer_stream << evaluateGene(gene);
+            delete gene;
+        }
+        if(!valid)
+        {
+            QNN_CRITICAL_MSG("Invalid gene from evaluator");
+            break;
+        }
+        if(!DistributedProtocol::writeMessage(socket, answer, -1))
+        {
+            break;
+        }
+    }
+
+    delete prototype;
+    delete socket;
+    return result;
+}
+
+double DistributedWorker::evaluateGene(GenericGene *gene)
+{
+    if(!_simulation_initialised)
+    {
+        _simulation->initialise(_network, gene);
+        _simulation_initialised = true;
+    }
+    else
+    {
+        _simulation->reinitialise(gene);
+    }
+    return _simulation->getScore();
+}
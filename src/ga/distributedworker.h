@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef DISTRIBUTEDWORKER_H
+#define DISTRIBUTEDWORKER_H
+
+#include <qnn-global.h>
+
+#include "../network/abstractneuralnetwork.h"
+#include "../simulation/abstractsimulation.h"
+#include <QString>
+
+/*!
+ * \brief The DistributedWorker class evaluates genes for a DistributedEvaluator in a separate process.
+ *
+ * The worker program must create the same network and simulation configuration as the evaluator and call run with the server name
+ * the evaluator passed as last argument, e.g.:
+ *
+ * \code
+ * DistributedWorker worker(&network, &simulation);
+ * return worker.run(QCoreApplication::arguments().last()) ? 0 : 1;
+ * \endcode
+ *
+ * The genes of a batch are evaluated one after another and the results of the batch are sent back together.
+ * Parallelism comes from running several workers.
+ */
+class QNNSHARED_EXPORT DistributedWorker
+{
+public:
+    /*!
+     * \brief Constructor
+     *
+     * The worker saves a deep copy of the network/simulation so the caller can delete both at any time.
+     *
+     * \param network The network used for the evaluation. Might not be NULL
+     * \param simulation The simulation used for the evaluation. Might not be NULL
+     */
+    DistributedWorker(AbstractNeuralNetwork *network, AbstractSimulation *simulation);
+
+    /*!
+     * \brief Destructor
+     */
+    ~DistributedWorker();
+
+    /*!
+     * \brief Listens on a local server, accepts the connection of the evaluator and evaluates genes until the evaluator shuts the worker down
+     * \param server_name Name of the local server
+     * \return True if the worker was shut down by the evaluator, false on errors
+     */
+    bool run(QString server_name);
+
+private:
+    /*!
+     * \brief Evaluates a single gene
+     * \param gene Gene to evaluate
+     * \return Fitness of the gene
+     */
+    double evaluateGene(GenericGene *gene);
+
+    /*!
+     * \brief The network used for the evaluation
+     */
+    AbstractNeuralNetwork *_network;
+
+    /*!
+     * \brief The simulation used for the evaluation
+     */
+    AbstractSimulation *_simulation;
+
+    /*!
+     * \brief True if _simulation has been initialised
+     */
+    bool _simulation_initialised;
+};
+
+#endif // DISTRIBUTEDWORKER_H
@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "evaluationcostmodel.h"
+
+#include <QMutexLocker>
+
+EvaluationCostModel::EvaluationCostModel() :
+    _mutex(),
+    _samples(0),
+    _sum_x(0.0),
+    _sum_y(0.0),
+    _sum_xx(0.0),
+    _sum_xy(0.0)
+{
+}
+
+void EvaluationCostModel::addMeasurement(qint32 segments, qint64 nsecs)
+{
+    double x = (double) segments * segments;
+    double y = nsecs;
+
+    QMutexLocker locker(&_mutex);
+    ++_samples;
+    _sum_x += x;
+    _sum_y += y;
+    _sum_xx += x * x;
+    _sum_xy += x * y;
+}
+
+double EvaluationCostModel::estimateCost(qint32 segments)
+{
+    double x = (double) segments * segments;
+
+    QMutexLocker locker(&_mutex);
+    if(_samples == 0)
+    {
+        return x;
+    }
+
+    double n = _samples;
+    double variance = n * _sum_xx - _sum_x * _sum_x;
+    if(_samples < 2 || variance <= 1e-12 * n * _sum_xx)
+    {
+        // All measured genes had the same size, the best guess is the average time scaled by the size
+        return _sum_x > 0.0 ? _sum_y * x / _sum_x : _sum_y / n;
+    }
+
+    double factor = (n * _sum_xy - _sum_x * _sum_y) / variance;
+    if(factor <= 0.0)
+    {
+        // The measurements do not show any growth with the size (e.g. noise on small networks)
+        return _sum_y / n;
+    }
+    double offset = qMax(0.0, (_sum_y - factor * _sum_x) / n);
+    return offset + factor * x;
+}
+
+double EvaluationCostModel::estimateCost(GenericGene *gene)
+{
+    if(Q_UNLIKELY(gene == NULL))
+    {
+        QNN_FATAL_MSG("Gene might not be NULL");
+    }
+    return estimateCost(gene->numSegments());
+}
+
+void EvaluationCostModel::reset()
+{
+    QMutexLocker locker(&_mutex);
+    _samples = 0;
+    _sum_x = 0.0;
+    _sum_y = 0.0;
+    _sum_xx = 0.0;
+    _sum_xy = 0.0;
+}
@@ -0,0 +1,102 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EVALUATIONCOSTMODEL_H
+#define EVALUATIONCOSTMODEL_H
+
+#include <qnn-global.h>
+
+#include "../network/genericgene.h"
+#include <QMutex>
+
+/*!
+ * \brief The EvaluationCostModel class estimates how long the evaluation of a gene takes.
+ *
+ * The cost of a network grows quadratically with the number of neurons, so the cost is modelled as offset + factor * segments^2.
+ * Until measurements are available the cost is simply segments^2. Each measured evaluation refines offset and factor by a least squares fit.
+ *
+ * All methods are thread safe.
+ */
+class QNNSHARED_EXPORT EvaluationCostModel
+{
+public:
+    /*!
+     * \brief Constructor
+     */
+    EvaluationCostModel();
+
+    /*!
+     * \brief Adds the measured time of an evaluation to the model
+     * \param segments Number of segments of the evaluated gene
+     * \param nsecs Time the evaluation took in nanoseconds
+     */
+    void addMeasurement(qint32 segments, qint64 nsecs);
+
+    /*!
+     * \brief Estimates the cost of evaluating a gene
+     * \param segments Number of segments of the gene
+     * \return Estimated cost. Once measurements are available this is the time in nanoseconds
+     */
+    double estimateCost(qint32 segments);
+
+    /*!
+     * \brief Estimates the cost of evaluating a gene
+     * \param gene Gene to evaluate. Might not be NULL
+     * \return Estimated cost. Once measurements are available this is the time in nanoseconds
+     */
+    double estimateCost(GenericGene *gene);
+
+    /*!
+     * \brief Removes all measurements
+     */
+    void reset();
+
+private:
+    /*!
+     * \brief Mutex protecting all sums
+     */
+    QMutex _mutex;
+
+    /*!
+     * \brief Number of measurements
+     */
+    qint64 _samples;
+
+    /*!
+     * \brief Sum of segments^2 of all measurements
+     */
+    double _sum_x;
+
+    /*!
+     * \brief Sum of the measured times
+     */
+    double _sum_y;
+
+    /*!
+     * \brief Sum of segments^4 of all measurements
+     */
+    double _sum_xx;
+
+    /*!
+     * \brief Sum of segments^2 * time of all measurements
+     */
+    double _sum_xy;
+};
+
+#endif // EVALUATIONCOSTMODEL_H
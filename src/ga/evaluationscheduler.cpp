@@ -0,0 +1,326 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "evaluationscheduler.h"
+
+#include <QThread>
+#include <QMutexLocker>
+#include <QPair>
+#include <QtAlgorithms>
+
+namespace {
+bool higherCost(const QPair<double, qint32> &a, const QPair<double, qint32> &b)
+{
+    return a.first > b.first;
+}
+}
+
+/*!
+ * \brief Number of unfinished jobs of a running batch
+ */
+struct EvaluationScheduler::BatchState
+{
+    qint32 remaining;
+    QMutex mutex;
+    QWaitCondition finished;
+};
+
+/*!
+ * \brief A single queued job
+ */
+struct EvaluationScheduler::Job
+{
+    Batch *batch;
+    BatchState *state;
+    qint32 index;
+};
+
+/*!
+ * \brief Job queue of a worker
+ */
+struct EvaluationScheduler::Queue
+{
+    QMutex mutex;
+    QList<Job> jobs;
+};
+
+/*!
+ * \brief Thread running EvaluationScheduler::workerLoop
+ */
+class EvaluationScheduler::Worker : public QThread
+{
+public:
+    Worker(EvaluationScheduler *scheduler, qint32 id) :
+        QThread(),
+        _scheduler(scheduler),
+        _id(id)
+    {
+    }
+
+protected:
+    void run()
+    {
+        _scheduler->workerLoop(_id);
+    }
+
+private:
+    EvaluationScheduler *_scheduler;
+    qint32 _id;
+};
+
+EvaluationScheduler::Batch::~Batch()
+{
+}
+
+EvaluationScheduler::EvaluationScheduler(qint32 threads) :
+    _queues(),
+    _workers(),
+    _pending(0),
+    _next_queue(0),
+    _sleep_mutex(),
+    _work_available(),
+    _stop(false)
+{
+    if(threads == -1)
+    {
+        threads = qMax(1, QThread::idealThreadCount());
+    }
+    if(Q_UNLIKELY(threads <= 0))
+    {
+        QNN_FATAL_MSG("Number of threads must be greater then 0");
+    }
+
+    _queues.reserve(threads);
+    for(qint32 i = 0; i < threads; ++i)
+    {
+        _queues.append(new Queue);
+    }
+    for(qint32 i = 0; i < threads; ++i)
+    {
+        Worker *worker = new Worker(this, i);
+        _workers.append(worker);
+        worker->start();
+    }
+}
+
+EvaluationScheduler::~EvaluationScheduler()
+{
+    {
+        QMutexLocker locker(&_sleep_mutex);
+        _stop = true;
+        _work_available.wakeAll();
+    }
+    foreach(Worker *worker, _workers)
+    {
+        worker->wait();
+    }
+    qDeleteAll(_workers);
+    qDeleteAll(_queues);
+}
+
+void EvaluationScheduler::run(Batch *batch, qint32 jobs)
+{
+    if(Q_UNLIKELY(batch == NULL))
+    {
+        QNN_FATAL_MSG("Batch might not be NULL");
+    }
+    if(jobs <= 0)
+    {
+        return;
+    }
+
+    // Distribute jobs round-robin. Consecutive batches start at different queues so small batches do not all end up in the first queue
+    qint32 number_queues = _queues.size();
+    qint32 first_queue = qAbs(_next_queue.fetchAndAddRelaxed(1) % number_queues);
+    QVector< QVector<qint32> > assignment(number_queues);
+    for(qint32 index = 0; index < jobs; ++index)
+    {
+        assignment[(first_queue + index) % number_queues].append(index);
+    }
+    runAssigned(batch, assignment, jobs);
+}
+
+void EvaluationScheduler::run(Batch *batch, const QVector<double> &costs)
+{
+    if(Q_UNLIKELY(batch == NULL))
+    {
+        QNN_FATAL_MSG("Batch might not be NULL");
+    }
+    qint32 jobs = costs.size();
+    if(jobs <= 0)
+    {
+        return;
+    }
+
+    QVector< QPair<double, qint32> > order;
+    order.reserve(jobs);
+    for(qint32 index = 0; index < jobs; ++index)
+    {
+        order.append(qMakePair(costs[index], index));
+    }
+    qStableSort(order.begin(), order.end(), higherCost);
+
+    // Give the most expensive remaining job to the queue with the lowest load. Ties are broken starting at a different queue for each batch
+    qint32 number_queues = _queues.size();
+    qint32 first_queue = qAbs(_next_queue.fetchAndAddRelaxed(1) % number_queues);
+    QVector< QVector<qint32> > assignment(number_queues);
+    QVector<double> load(number_queues, 0.0);
+    for(qint32 i = 0; i < jobs; ++i)
+    {
+        qint32 best = first_queue;
+        for(qint32 j = 1; j < number_queues; ++j)
+        {
+            qint32 queue = (first_queue + j) % number_queues;
+            if(load[queue] < load[best])
+            {
+                best = queue;
+            }
+        }
+        assignment[best].append(order[i].second);
+        load[best] += order[i].first;
+    }
+    runAssigned(batch, assignment, jobs);
+}
+
+void EvaluationScheduler::runAssigned(Batch *batch, const QVector< QVector<qint32> > &assignment, qint32 jobs)
+{
+    BatchState state;
+    state.remaining = jobs;
+
+    // _pending must be increased before the jobs are visible in the queues. Otherwise a worker draining another batch
+    // could take one of the jobs first and push _pending below 0, so idle workers would spin instead of going to sleep
+    _pending.fetchAndAddOrdered(jobs);
+
+    for(qint32 i = 0; i < assignment.size(); ++i)
+    {
+        if(assignment[i].isEmpty())
+        {
+            continue;
+        }
+        Queue *queue = _queues[i];
+        QMutexLocker locker(&queue->mutex);
+        foreach(qint32 index, assignment[i])
+        {
+            Job job;
+            job.batch = batch;
+            job.state = &state;
+            job.index = index;
+            queue->jobs.append(job);
+        }
+    }
+
+    {
+        QMutexLocker locker(&_sleep_mutex);
+        _work_available.wakeAll();
+    }
+
+    // Help with the queued jobs until all jobs of this batch are started
+    Job job;
+    while(takeJob(-1, &job))
+    {
+        runJob(job);
+        QMutexLocker locker(&state.mutex);
+        if(state.remaining == 0)
+        {
+            return;
+        }
+    }
+
+    QMutexLocker locker(&state.mutex);
+    while(state.remaining > 0)
+    {
+        state.finished.wait(&state.mutex);
+    }
+}
+
+qint32 EvaluationScheduler::numberThreads()
+{
+    return _workers.size();
+}
+
+void EvaluationScheduler::workerLoop(qint32 id)
+{
+    while(true)
+    {
+        Job job;
+        if(takeJob(id, &job))
+        {
+            runJob(job);
+            continue;
+        }
+
+        QMutexLocker locker(&_sleep_mutex);
+        while(_pending.loadAcquire() == 0 && !_stop)
+        {
+            _work_available.wait(&_sleep_mutex);
+        }
+        if(_stop)
+        {
+            return;
+        }
+    }
+}
+
+bool EvaluationScheduler::takeJob(qint32 id, Job *job)
+{
+    if(_pending.loadAcquire() == 0)
+    {
+        return false;
+    }
+
+    qint32 number_queues = _queues.size();
+    if(id >= 0)
+    {
+        Queue *queue = _queues[id];
+        QMutexLocker locker(&queue->mutex);
+        if(!queue->jobs.isEmpty())
+        {
+            *job = queue->jobs.takeFirst();
+            _pending.fetchAndAddOrdered(-1);
+            return true;
+        }
+    }
+
+    // Steal from the front of the other queues. The front holds the jobs which should have been started first, for longest job first dispatch the most expensive ones
+    qint32 start = id >= 0 ? id + 1 : 0;
+    for(qint32 i = 0; i < number_queues; ++i)
+    {
+        Queue *queue = _queues[(start + i) % number_queues];
+        QMutexLocker locker(&queue->mutex);
+        if(!queue->jobs.isEmpty())
+        {
+            *job = queue->jobs.takeFirst();
+            _pending.fetchAndAddOrdered(-1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void EvaluationScheduler::runJob(const Job &job)
+{
+    job.batch->runJob(job.index);
+
+    // The state belongs to the thread waiting in run() and is destroyed as soon as it sees remaining == 0, so it is only accessed while locked
+    QMutexLocker locker(&job.state->mutex);
+    if(--job.state->remaining == 0)
+    {
+        job.state->finished.wakeAll();
+    }
+}
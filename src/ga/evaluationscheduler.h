@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef EVALUATIONSCHEDULER_H
+#define EVALUATIONSCHEDULER_H
+
+#include <qnn-global.h>
+
+#include <QList>
+#include <QVector>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QAtomicInt>
+
+/*!
+ * \brief The EvaluationScheduler class runs batches of independent jobs on a set of persistent threads.
+ *
+ * Each thread owns a queue of jobs. The jobs of a batch are distributed round-robin over the queues in the order of their index.
+ * A thread takes jobs from the front of its own queue and steals from the front of the other queues once its own queue is empty,
+ * so threads which got cheap jobs help out threads which got expensive ones.
+ *
+ * If the cost of each job is known in advance the jobs can be distributed longest job first: the most expensive job is given to the queue with the lowest
+ * total cost until all jobs are distributed. This way the expensive jobs are started first and do not determine the end of the batch.
+ *
+ * The thread calling run() works on the queued jobs as well until its batch is finished. Several threads may run batches at the same time.
+ */
+class QNNSHARED_EXPORT EvaluationScheduler
+{
+public:
+    /*!
+     * \brief A batch of jobs run by the scheduler. Subclasses implement the single jobs.
+     */
+    class QNNSHARED_EXPORT Batch
+    {
+    public:
+        /*!
+         * \brief Destructor
+         */
+        virtual ~Batch();
+
+        /*!
+         * \brief Runs a single job of the batch.
+         *
+         * This method is called from different threads at the same time, so it has to be thread safe for different indices.
+         * The results should be stored at a position determined by index.
+         *
+         * \param index Index of the job (0 <= index < number of jobs)
+         */
+        virtual void runJob(qint32 index) = 0;
+    };
+
+    /*!
+     * \brief Constructor
+     * \param threads Number of worker threads. If set to -1 QThread::idealThreadCount() threads are used
+     */
+    explicit EvaluationScheduler(qint32 threads = -1);
+
+    /*!
+     * \brief Destructor. Must not be called while a batch is running
+     */
+    ~EvaluationScheduler();
+
+    /*!
+     * \brief Runs all jobs of a batch and returns once all of them are finished.
+     * \param batch Batch to run. Might not be NULL
+     * \param jobs Number of jobs in the batch
+     */
+    void run(Batch *batch, qint32 jobs);
+
+    /*!
+     * \brief Runs all jobs of a batch longest job first and returns once all of them are finished.
+     * \param batch Batch to run. Might not be NULL
+     * \param costs Estimated cost of each job. The number of jobs is the length of the vector. Only the relation between the costs is important
+     */
+    void run(Batch *batch, const QVector<double> &costs);
+
+    /*!
+     * \brief Returns the number of worker threads
+     * \return Number of worker threads
+     */
+    qint32 numberThreads();
+
+private:
+    struct BatchState;
+    struct Job;
+    struct Queue;
+    class Worker;
+
+    /*!
+     * \brief Queues the jobs of a batch and returns once all of them are finished.
+     * \param batch Batch to run
+     * \param assignment Indices of the jobs for each queue in the order they should be run
+     * \param jobs Number of jobs in the batch
+     */
+    void runAssigned(Batch *batch, const QVector< QVector<qint32> > &assignment, qint32 jobs);
+
+    /*!
+     * \brief Main loop of a worker thread
+     * \param id Number of the worker
+     */
+    void workerLoop(qint32 id);
+
+    /*!
+     * \brief Takes a job from the queues.
+     * \param id Number of the worker whose queue is searched first. -1 if the caller is no worker
+     * \param job Pointer to which the job is written
+     * \return True if a job was found
+     */
+    bool takeJob(qint32 id, Job *job);
+
+    /*!
+     * \brief Runs a job and marks it as finished in its batch
+     * \param job Job to run
+     */
+    void runJob(const Job &job);
+
+    /*!
+     * \brief Queue of each worker thread
+     */
+    QVector<Queue *> _queues;
+
+    /*!
+     * \brief The worker threads
+     */
+    QList<Worker *> _workers;
+
+    /*!
+     * \brief Number of jobs in all queues. It is increased before new jobs are queued, so it is never smaller than the real number
+     */
+    QAtomicInt _pending;
+
+    /*!
+     * \brief Queue the next batch starts distributing its jobs to
+     */
+    QAtomicInt _next_queue;
+
+    /*!
+     * \brief Mutex used by sleeping workers
+     */
+    QMutex _sleep_mutex;
+
+    /*!
+     * \brief Wakes up the workers when new jobs are available. Protected by _sleep_mutex
+     */
+    QWaitCondition _work_available;
+
+    /*!
+     * \brief True if the workers should stop. Protected by _sleep_mutex
+     */
+    bool _stop;
+};
+
+#endif // EVALUATIONSCHEDULER_H
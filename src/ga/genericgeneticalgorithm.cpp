@@ -17,26 +17,77 @@
  */
 
 #include "genericgeneticalgorithm.h"
+#include "populationarchive.h"
+#include "distributedevaluator.h"
+#include "../network/feedforwardnetwork.h"
+#include "../network/feedforwardnetworkensemble.h"
 
 #include <QThread>
 #include <QtAlgorithms>
 #include <QTime>
-#include <QtConcurrentRun>
-#include <QFuture>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QMutexLocker>
 #include <randomhelper.h>
 
 namespace {
 
 static const qint32 MAX_FORWARD_RANDOM = 256;
 
-double runOneSimulation(AbstractSimulation *simulation)
-{
-    double result = simulation->getScore();
-    delete simulation;
-    return result;
-}
+static const quint32 CHECKPOINT_MAGIC = 0x434e4e51; // "QNNC"
+static const quint32 CHECKPOINT_VERSION = 1;
 }
 
+/*!
+ * \brief Evaluates each gene with evaluateGene
+ */
+class GenericGeneticAlgorithm::GeneBatch : public EvaluationScheduler::Batch
+{
+public:
+    GeneBatch(GenericGeneticAlgorithm *ga, const QList<GenericGene *> &genes, double *fitness) :
+        _ga(ga),
+        _genes(genes),
+        _fitness(fitness)
+    {
+    }
+
+    void runJob(qint32 index)
+    {
+        _fitness[index] = _ga->evaluateGene(_genes[index]);
+    }
+
+private:
+    GenericGeneticAlgorithm *_ga;
+    const QList<GenericGene *> &_genes;
+    double *_fitness;
+};
+
+/*!
+ * \brief Evaluates groups of _lockstep_size genes with evaluateGenesLockstep
+ */
+class GenericGeneticAlgorithm::LockstepBatch : public EvaluationScheduler::Batch
+{
+public:
+    LockstepBatch(GenericGeneticAlgorithm *ga, const QList<GenericGene *> &genes, QList<double> *fitness) :
+        _ga(ga),
+        _genes(genes),
+        _fitness(fitness)
+    {
+    }
+
+    void runJob(qint32 index)
+    {
+        _fitness[index] = _ga->evaluateGenesLockstep(_genes.mid(index * _ga->_lockstep_size, _ga->_lockstep_size));
+    }
+
+private:
+    GenericGeneticAlgorithm *_ga;
+    const QList<GenericGene *> &_genes;
+    QList<double> *_fitness;
+};
+
 GenericGeneticAlgorithm::GenericGeneticAlgorithm(AbstractNeuralNetwork *network, AbstractSimulation *simulation, qint32 population_size, double fitness_to_reach, qint32 max_rounds, QObject *parent) :
     QObject(parent),
     _population(),
@@ -47,7 +98,17 @@ GenericGeneticAlgorithm::GenericGeneticAlgorithm(AbstractNeuralNetwork *network,
     _fitness_to_reach(fitness_to_reach),
     _max_rounds(max_rounds),
     _average_fitness(-1.0),
-    _rounds_to_finish(-1)
+    _rounds_to_finish(-1),
+    _evaluation_pool(),
+    _evaluation_pool_mutex(),
+    _checkpoint_file(),
+    _checkpoint_interval(1),
+    _lockstep_size(0),
+    _lockstep_pool(),
+    _scheduler(NULL),
+    _evaluation_threads(-1),
+    _distributed_evaluator(NULL),
+    _cost_model()
 {
     if(Q_UNLIKELY(network == NULL))
     {
@@ -70,7 +131,6 @@ GenericGeneticAlgorithm::GenericGeneticAlgorithm(AbstractNeuralNetwork *network,
 
     _best.fitness = -1.0;
     _best.gene = NULL;
-    _best.network = NULL;
 }
 
 GenericGeneticAlgorithm::GenericGeneticAlgorithm(QObject *parent) :
@@ -83,19 +143,40 @@ GenericGeneticAlgorithm::GenericGeneticAlgorithm(QObject *parent) :
     _fitness_to_reach(0.0),
     _max_rounds(0),
     _average_fitness(0),
-    _rounds_to_finish(0)
+    _rounds_to_finish(0),
+    _evaluation_pool(),
+    _evaluation_pool_mutex(),
+    _checkpoint_file(),
+    _checkpoint_interval(1),
+    _lockstep_size(0),
+    _lockstep_pool(),
+    _scheduler(NULL),
+    _evaluation_threads(-1),
+    _distributed_evaluator(NULL),
+    _cost_model()
 {
     _best.fitness = -1.0;
     _best.gene = NULL;
-    _best.network = NULL;
 }
 
 GenericGeneticAlgorithm::~GenericGeneticAlgorithm()
 {
-    delete _best.network;
     delete _best.gene;
     delete _network;
     delete _simulation;
+    delete _scheduler;
+    qDeleteAll(_evaluation_pool);
+    deleteLockstepPool();
+}
+
+void GenericGeneticAlgorithm::deleteLockstepPool()
+{
+    for(qint32 i = 0; i < _lockstep_pool.length(); ++i)
+    {
+        delete _lockstep_pool[i].ensemble;
+        delete _lockstep_pool[i].simulation;
+    }
+    _lockstep_pool.clear();
 }
 
 void GenericGeneticAlgorithm::runGa()
@@ -109,8 +190,6 @@ void GenericGeneticAlgorithm::runGa()
         QNN_FATAL_MSG("Simulation might not be NULL");
     }
 
-    delete _best.network;
-    _best.network = NULL;
     delete _best.gene;
     _best.gene = NULL;
 
@@ -124,33 +203,98 @@ void GenericGeneticAlgorithm::runGa()
 
     emit ga_current_round(0, _max_rounds, _population.last().fitness, calculateAverageFitness());
 
-    // Main loop    
-    qint32 currentRound = 0;
-    while(currentRound++ < _max_rounds && _population.last().fitness < _fitness_to_reach)
+    if(!_checkpoint_file.isEmpty())
     {
-        createChildren();
-        survivorSelection();
-        Q_ASSERT_X(_population.length() == _population_size, "GenericGeneticAlgorithm::run_ga after create_children(), survivor_selection()", "size of population does not match _population_size");
-        qSort(_population);
-        emit ga_current_round(currentRound, _max_rounds, _population.last().fitness, calculateAverageFitness());
+        saveCheckpoint(_checkpoint_file, 0);
     }
 
-    // Find the best individuum
-    _best.fitness = _population.last().fitness;
-    _best.gene = _population.last().gene;
-    _best.network = _population.last().network;
-
-    _average_fitness = calculateAverageFitness();
-    _rounds_to_finish = currentRound-1;
+    runRounds(0);
+}
 
-    // Clean-up
-    for(qint32 i = 0; i < _population.length()-1; ++i)
+bool GenericGeneticAlgorithm::resumeGa(QString filename)
+{
+    if(Q_UNLIKELY(_network == NULL))
     {
-        delete _population[i].network;
-        delete _population[i].gene;
+        QNN_FATAL_MSG("Network might not be NULL");
+    }
+    if(Q_UNLIKELY(_simulation == NULL))
+    {
+        QNN_FATAL_MSG("Simulation might not be NULL");
     }
+
     _population.clear();
-    emit ga_finished(_best.fitness, _average_fitness, _rounds_to_finish);
+
+    qint32 round;
+    if(!loadCheckpoint(filename, &round))
+    {
+        return false;
+    }
+
+    // Adjust population to the current population size
+    while(_population.length() < _population_size)
+    {
+        GeneContainer container;
+        container.fitness = -1.0;
+        container.gene = _network->getRandomGene();
+        _population.append(container);
+    }
+
+    evaluatePopulation();
+    qSort(_population);
+
+    while(_population.length() > _population_size)
+    {
+        GeneContainer container = _population.takeFirst();
+        delete container.gene;
+    }
+
+    emit ga_current_round(round, _max_rounds, _population.last().fitness, calculateAverageFitness());
+
+    runRounds(round);
+    return true;
+}
+
+bool GenericGeneticAlgorithm::setLockstepEvaluation(qint32 individuals)
+{
+    if(Q_UNLIKELY(_network == NULL || _simulation == NULL))
+    {
+        QNN_FATAL_MSG("Network and simulation might not be NULL");
+    }
+    if(Q_UNLIKELY(individuals < 0))
+    {
+        QNN_FATAL_MSG("Number of individuals must not be negative");
+    }
+    FeedForwardNetwork *network = dynamic_cast<FeedForwardNetwork *>(_network);
+    if(individuals > 0 && (network == NULL || !_simulation->supportsLockstep()))
+    {
+        QNN_WARNING_MSG("Lockstep evaluation is not supported by the network or simulation");
+        return false;
+    }
+    if(individuals > 0 && network->precision() != FeedForwardNetwork::double_precision)
+    {
+        QNN_WARNING_MSG("Lockstep evaluation is only supported for networks with double precision");
+        return false;
+    }
+
+    QMutexLocker locker(&_evaluation_pool_mutex);
+    deleteLockstepPool();
+    _lockstep_size = individuals;
+    return true;
+}
+
+void GenericGeneticAlgorithm::setCheckpoint(QString filename, qint32 interval)
+{
+    if(Q_UNLIKELY(interval <= 0))
+    {
+        QNN_FATAL_MSG("Checkpoint interval must be greater then 0");
+    }
+    _checkpoint_file = filename;
+    _checkpoint_interval = interval;
+}
+
+void GenericGeneticAlgorithm::setDistributedEvaluator(DistributedEvaluator *evaluator)
+{
+    _distributed_evaluator = evaluator;
 }
 
 double GenericGeneticAlgorithm::bestFitness()
@@ -189,28 +333,337 @@ AbstractSimulation *GenericGeneticAlgorithm::getSimulationCopy()
 
 void GenericGeneticAlgorithm::createInitialPopulation()
 {
-    QList< QFuture<double> > threadList;
-
     for(qint32 i = 0; i < _population_size; ++i)
     {
         GeneContainer container;
         container.fitness = -1.0;
         container.gene = _network->getRandomGene();
-        container.network = _network->createConfigCopy();
         _population.append(container);
     }
 
-    for(qint32 i = 0; i < _population_size; ++i)
+    evaluatePopulation();
+}
+
+void GenericGeneticAlgorithm::evaluatePopulation()
+{
+    QList<GenericGene *> geneList;
+    QList<qint32> indexList;
+
+    for(qint32 i = 0; i < _population.length(); ++i)
     {
-        AbstractSimulation *simulation = _simulation->createConfigCopy();
-        simulation->initialise(_population[i].network, _population[i].gene);
-        threadList.append(QtConcurrent::run(runOneSimulation, simulation));
+        if(_population[i].fitness < 0.0)
+        {
+            geneList.append(_population[i].gene);
+            indexList.append(i);
+        }
     }
 
-    for(qint32 i = 0; i < _population_size; ++i)
+    QList<double> fitnessList = evaluateGenes(geneList);
+    for(qint32 i = 0; i < indexList.length(); ++i)
+    {
+        _population[indexList[i]].fitness = fitnessList[i];
+    }
+}
+
+QList<double> GenericGeneticAlgorithm::evaluateGenes(QList<GenericGene *> genes)
+{
+    if(_distributed_evaluator != NULL)
+    {
+        return _distributed_evaluator->evaluate(genes);
+    }
+
+    QList<double> fitnessList;
+    fitnessList.reserve(genes.length());
+
+    if(_lockstep_size > 0)
+    {
+        qint32 groups = (genes.length() + _lockstep_size - 1) / _lockstep_size;
+        QVector<double> costs(groups, 0.0);
+        for(qint32 i = 0; i < genes.length(); ++i)
+        {
+            costs[i / _lockstep_size] += _cost_model.estimateCost(genes[i]);
+        }
+        QVector< QList<double> > groupFitness(groups);
+        LockstepBatch batch(this, genes, groupFitness.data());
+        evaluationScheduler()->run(&batch, costs);
+        for(qint32 i = 0; i < groups; ++i)
+        {
+            fitnessList.append(groupFitness[i]);
+        }
+    }
+    else
+    {
+        QVector<double> costs;
+        costs.reserve(genes.length());
+        foreach(GenericGene *gene, genes)
+        {
+            costs.append(_cost_model.estimateCost(gene));
+        }
+        QVector<double> fitness(genes.length());
+        GeneBatch batch(this, genes, fitness.data());
+        evaluationScheduler()->run(&batch, costs);
+        for(qint32 i = 0; i < fitness.size(); ++i)
+        {
+            fitnessList.append(fitness[i]);
+        }
+    }
+    return fitnessList;
+}
+
+QList<double> GenericGeneticAlgorithm::evaluateGenesInThread(QList<GenericGene *> genes)
+{
+    if(_distributed_evaluator != NULL)
     {
-        _population[i].fitness = threadList[i].result();
+        return _distributed_evaluator->evaluate(genes);
     }
+
+    QList<double> fitnessList;
+    fitnessList.reserve(genes.length());
+    if(_lockstep_size > 0)
+    {
+        for(qint32 i = 0; i < genes.length(); i += _lockstep_size)
+        {
+            fitnessList.append(evaluateGenesLockstep(genes.mid(i, _lockstep_size)));
+        }
+    }
+    else
+    {
+        foreach(GenericGene *gene, genes)
+        {
+            fitnessList.append(evaluateGene(gene));
+        }
+    }
+    return fitnessList;
+}
+
+EvaluationScheduler *GenericGeneticAlgorithm::evaluationScheduler()
+{
+    if(_scheduler == NULL)
+    {
+        _scheduler = new EvaluationScheduler(_evaluation_threads);
+    }
+    return _scheduler;
+}
+
+QList<double> GenericGeneticAlgorithm::evaluateGenesLockstep(QList<GenericGene *> genes)
+{
+    LockstepContext context;
+    context.ensemble = NULL;
+    context.simulation = NULL;
+    {
+        QMutexLocker locker(&_evaluation_pool_mutex);
+        if(!_lockstep_pool.isEmpty())
+        {
+            context = _lockstep_pool.takeLast();
+        }
+    }
+
+    if(context.ensemble == NULL)
+    {
+        context.ensemble = static_cast<FeedForwardNetwork *>(_network)->createEnsemble(_lockstep_size);
+        context.simulation = _simulation->createConfigCopy();
+    }
+
+    context.ensemble->initialise(genes);
+    QList<double> result = context.simulation->getLockstepScores(context.ensemble);
+    if(Q_UNLIKELY(result.length() != genes.length()))
+    {
+        QNN_FATAL_MSG("Simulation returned wrong number of scores");
+    }
+
+    QMutexLocker locker(&_evaluation_pool_mutex);
+    _lockstep_pool.append(context);
+    return result;
+}
+
+double GenericGeneticAlgorithm::evaluateGene(GenericGene *gene)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    AbstractSimulation *simulation = NULL;
+    {
+        QMutexLocker locker(&_evaluation_pool_mutex);
+        if(!_evaluation_pool.isEmpty())
+        {
+            simulation = _evaluation_pool.takeLast();
+        }
+    }
+
+    if(simulation == NULL)
+    {
+        simulation = _simulation->createConfigCopy();
+        simulation->initialise(_network, gene);
+    }
+    else
+    {
+        simulation->reinitialise(gene);
+    }
+    double result = simulation->getScore();
+
+    _cost_model.addMeasurement(gene->numSegments(), timer.nsecsElapsed());
+
+    QMutexLocker locker(&_evaluation_pool_mutex);
+    _evaluation_pool.append(simulation);
+    return result;
+}
+
+void GenericGeneticAlgorithm::runRounds(qint32 round)
+{
+    // Main loop
+    qint32 currentRound = round;
+    while(currentRound++ < _max_rounds && _population.last().fitness < _fitness_to_reach)
+    {
+        createChildren();
+        survivorSelection();
+        Q_ASSERT_X(_population.length() == _population_size, "GenericGeneticAlgorithm::run_ga after create_children(), survivor_selection()", "size of population does not match _population_size");
+        qSort(_population);
+        emit ga_current_round(currentRound, _max_rounds, _population.last().fitness, calculateAverageFitness());
+
+        if(!_checkpoint_file.isEmpty() && currentRound % _checkpoint_interval == 0)
+        {
+            saveCheckpoint(_checkpoint_file, currentRound);
+        }
+    }
+
+    finishRounds(currentRound-1);
+}
+
+void GenericGeneticAlgorithm::finishRounds(qint32 rounds)
+{
+    // Find the best individuum
+    delete _best.gene;
+    _best.fitness = _population.last().fitness;
+    _best.gene = _population.last().gene;
+
+    _average_fitness = calculateAverageFitness();
+    _rounds_to_finish = rounds;
+
+    if(!_checkpoint_file.isEmpty() && _rounds_to_finish % _checkpoint_interval != 0)
+    {
+        saveCheckpoint(_checkpoint_file, _rounds_to_finish);
+    }
+
+    // Clean-up
+    for(qint32 i = 0; i < _population.length()-1; ++i)
+    {
+        delete _population[i].gene;
+    }
+    _population.clear();
+    emit ga_finished(_best.fitness, _average_fitness, _rounds_to_finish);
+}
+
+bool GenericGeneticAlgorithm::saveCheckpoint(QString filename, qint32 round)
+{
+    QList<GenericGene *> genes;
+    QList<double> fitness;
+    foreach(GeneContainer container, _population)
+    {
+        genes.append(container.gene);
+        fitness.append(container.fitness);
+    }
+    return writeCheckpoint(filename, round, RandomHelper::saveState(), genes, fitness);
+}
+
+bool GenericGeneticAlgorithm::writeCheckpoint(QString filename, qint32 round, QString random_state, QList<GenericGene *> genes, QList<double> fitness)
+{
+    QSaveFile file(filename);
+    if(!file.open(QIODevice::WriteOnly))
+    {
+        QNN_CRITICAL_MSG("Can not open checkpoint file");
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    stream << CHECKPOINT_MAGIC;
+    stream << CHECKPOINT_VERSION;
+    stream << round;
+    stream << random_state;
+    stream << (_best.gene != NULL);
+    stream << _best.fitness;
+
+    bool result = stream.status() == QDataStream::Ok && PopulationArchive::savePopulation(genes, fitness, &file);
+    if(result && _best.gene != NULL)
+    {
+        result = _best.gene->saveGeneBinary(&file);
+    }
+
+    if(!result)
+    {
+        QNN_CRITICAL_MSG("Can not write checkpoint");
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+bool GenericGeneticAlgorithm::loadCheckpoint(QString filename, qint32 *round)
+{
+    QFile file(filename);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+        QNN_CRITICAL_MSG("Can not open checkpoint file");
+        return false;
+    }
+
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+    quint32 magic;
+    quint32 version;
+    qint32 saved_round;
+    QString random_state;
+    bool has_best;
+    double best_fitness;
+    stream >> magic;
+    stream >> version;
+    stream >> saved_round;
+    stream >> random_state;
+    stream >> has_best;
+    stream >> best_fitness;
+    if(stream.status() != QDataStream::Ok || magic != CHECKPOINT_MAGIC || version != CHECKPOINT_VERSION || saved_round < 0)
+    {
+        QNN_CRITICAL_MSG("Invalid checkpoint");
+        return false;
+    }
+
+    // A random gene is used as prototype because it has the type the network expects
+    GenericGene *prototype = _network->getRandomGene();
+    QList<GenericGene *> genes;
+    QList<double> fitness;
+    GenericGene *best = NULL;
+    bool result = PopulationArchive::loadPopulation(prototype, &genes, &fitness, &file);
+    if(result && has_best)
+    {
+        best = prototype->loadGene(&file);
+        result = best != NULL;
+    }
+    delete prototype;
+
+    if(!result || !RandomHelper::restoreState(random_state))
+    {
+        QNN_CRITICAL_MSG("Can not load checkpoint");
+        qDeleteAll(genes);
+        delete best;
+        return false;
+    }
+
+    for(qint32 i = 0; i < genes.length(); ++i)
+    {
+        GeneContainer container;
+        container.fitness = fitness[i];
+        container.gene = genes[i];
+        _population.append(container);
+    }
+
+    delete _best.gene;
+    _best.fitness = has_best ? best_fitness : -1.0;
+    _best.gene = best;
+
+    *round = saved_round;
+    return true;
 }
 
 void GenericGeneticAlgorithm::createChildren()
@@ -218,7 +671,7 @@ void GenericGeneticAlgorithm::createChildren()
     QList< QList<GeneContainer> > temp;
     QList< QList<GeneContainer> > newChildren;
     QList<GenericGene *> childrenGene;
-    QList< QList< QFuture<double> > > threadList;
+    QList<GenericGene *> evaluationList;
     QList<GeneContainer> saveSmallPopulation;
     qint32 number_list = 0;
 
@@ -235,18 +688,14 @@ void GenericGeneticAlgorithm::createChildren()
         {
             childrenGene = temp[number_list][temp[number_list].length()-1].gene->combine(temp[number_list][temp[number_list].length()-1].gene, temp[number_list][temp[number_list].length()-2].gene);
             newChildren.append(QList<GeneContainer>());
-            threadList.append(QList< QFuture<double> >());
             for(qint32 i = 0; i < childrenGene.length(); ++i)
             {
                 childrenGene[i]->mutate();
                 GeneContainer container;
                 container.gene = childrenGene[i];
-                container.network = _network->createConfigCopy();
                 container.fitness = -1.0;
                 newChildren[number_list].append(container);
-                AbstractSimulation *simulation = _simulation->createConfigCopy();
-                simulation->initialise(container.network, container.gene);
-                threadList[number_list].append(QtConcurrent::run(runOneSimulation, simulation));
+                evaluationList.append(container.gene);
             }
             ++number_list;
         }
@@ -264,18 +713,20 @@ void GenericGeneticAlgorithm::createChildren()
 
     }
 
+    QList<double> fitnessList = evaluateGenes(evaluationList);
+    qint32 current_fitness = 0;
+
     for(qint32 j = 0; j < number_list; ++j)
     {
         for(qint32 i = 0; i < newChildren[j].length(); ++i)
         {
-            newChildren[j][i].fitness = threadList[j][i].result();
+            newChildren[j][i].fitness = fitnessList[current_fitness++];
         }
         temp[j].append(newChildren[j]);
         qSort(temp[j]);
         for(qint32 i = 0; i < newChildren[j].length(); ++i)
         {
             GeneContainer container = temp[j].takeFirst();
-            delete container.network;
             delete container.gene;
         }
         _population.append(temp[j]);
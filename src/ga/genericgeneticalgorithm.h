@@ -23,8 +23,14 @@
 
 #include "../network/abstractneuralnetwork.h"
 #include "../simulation/abstractsimulation.h"
+#include "evaluationscheduler.h"
+#include "evaluationcostmodel.h"
 #include <QVector>
 #include <QObject>
+#include <QMutex>
+
+class FeedForwardNetworkEnsemble;
+class DistributedEvaluator;
 
 /*!
  * \brief The GenericGeneticAlgorithm class is the base class of all genetic algorithms.
@@ -35,6 +41,8 @@
  * You must always overwrite the following functions together:
  *  - createChildren()
  *  - survivorSelection()
+ *
+ * A run can be saved in regular intervals using setCheckpoint and continued later with resumeGa.
  */
 class QNNSHARED_EXPORT GenericGeneticAlgorithm : public QObject
 {
@@ -65,6 +73,54 @@ public:
      */
     virtual void runGa();
 
+    /*!
+     * \brief This method continues a genetic algorithm from a checkpoint.
+     *
+     * The population, the current round, the best result and the random engine state of the calling thread are restored from the checkpoint.
+     * Only individuals without a known fitness are evaluated again. If the population size is larger than the saved population new random individuals are added,
+     * if it is smaller the worst individuals are removed.
+     *
+     * The maximum amount of rounds of this object is used, so a finished run can be continued after raising max_rounds.
+     *
+     * \param filename Checkpoint created with setCheckpoint
+     * \return True if the checkpoint could be loaded. If false the genetic algorithm is not run
+     */
+    virtual bool resumeGa(QString filename);
+
+    /*!
+     * \brief Enables saving checkpoints during runGa / resumeGa.
+     *
+     * A checkpoint is saved after the initial population has been evaluated, every interval rounds and after the last round.
+     * The file is replaced atomically, so a crash while saving does not destroy the previous checkpoint.
+     *
+     * \param filename Path of the checkpoint. An empty filename disables checkpoints
+     * \param interval Number of rounds between two checkpoints. Must be greater then 0
+     */
+    void setCheckpoint(QString filename, qint32 interval = 1);
+
+    /*!
+     * \brief Enables lockstep evaluation.
+     *
+     * With lockstep evaluation the genes are evaluated in groups. The networks of a group are run together in a FeedForwardNetworkEnsemble,
+     * which is much faster for small networks. Only one thread is used per group.
+     * Lockstep evaluation is only possible if the network is a FeedForwardNetwork using double precision and the simulation supports it (see AbstractSimulation::supportsLockstep).
+     * Ensembles always calculate with double precision, so with a reduced precision lockstep evaluation would change the fitness values.
+     *
+     * \param individuals Number of individuals evaluated together. 0 disables lockstep evaluation
+     * \return True if lockstep evaluation is supported. If false the evaluation mode is not changed
+     */
+    bool setLockstepEvaluation(qint32 individuals);
+
+    /*!
+     * \brief Sets an evaluator which evaluates the genes in worker processes.
+     *
+     * If an evaluator is set all genes evaluated with evaluateGenes or evaluateGenesInThread are sent to it. Lockstep evaluation is not used in this case.
+     * The evaluator must use the same network and simulation configuration and must not be deleted while it is set.
+     *
+     * \param evaluator Evaluator to use. NULL evaluates the genes in this process
+     */
+    void setDistributedEvaluator(DistributedEvaluator *evaluator);
+
     /*!
      * \brief Return the best fitness of the last run.
      *
@@ -146,6 +202,115 @@ protected:
      */
     virtual void createInitialPopulation();
 
+    /*!
+     * \brief Calculates the fitness of all individuals in the population with an unknown fitness (fitness < 0).
+     */
+    virtual void evaluatePopulation();
+
+    /*!
+     * \brief Calculates the fitness of a gene.
+     *
+     * This method is thread safe. The simulation is taken from a pool of initialised simulations and returned afterwards,
+     * so the networks and simulations are reused instead of being created for every evaluation.
+     * The time of the evaluation is added to _cost_model.
+     *
+     * \param gene Gene to evaluate
+     * \return Fitness of the gene
+     */
+    double evaluateGene(GenericGene *gene);
+
+    /*!
+     * \brief Calculates the fitness of a number of genes in parallel.
+     *
+     * If a distributed evaluator is set the genes are evaluated by it.
+     * If lockstep evaluation is enabled the genes are evaluated in groups using evaluateGenesLockstep, otherwise each gene is evaluated using evaluateGene.
+     * The evaluations are run as one batch on the scheduler returned by evaluationScheduler. The most expensive genes according to _cost_model are started first.
+     *
+     * \param genes Genes to evaluate
+     * \return Fitness of each gene
+     */
+    QList<double> evaluateGenes(QList<GenericGene *> genes);
+
+    /*!
+     * \brief Calculates the fitness of a number of genes in the calling thread.
+     *
+     * This method is thread safe and uses the same evaluation as evaluateGenes (distributed evaluator, lockstep groups or evaluateGene),
+     * but does not use the scheduler. It is meant for algorithms which already evaluate from several threads.
+     *
+     * \param genes Genes to evaluate
+     * \return Fitness of each gene
+     */
+    QList<double> evaluateGenesInThread(QList<GenericGene *> genes);
+
+    /*!
+     * \brief Calculates the fitness of a group of genes in lockstep.
+     *
+     * This method is thread safe. Ensembles and simulations are taken from a pool and returned afterwards.
+     *
+     * \param genes Genes to evaluate. Must not contain more genes then set with setLockstepEvaluation
+     * \return Fitness of each gene
+     */
+    QList<double> evaluateGenesLockstep(QList<GenericGene *> genes);
+
+    /*!
+     * \brief Returns the scheduler used to run evaluations. The scheduler is created with _evaluation_threads threads on first use and kept until the object is deleted
+     * \return Evaluation scheduler
+     */
+    EvaluationScheduler *evaluationScheduler();
+
+    /*!
+     * \brief Deletes all ensembles and simulations in _lockstep_pool
+     */
+    void deleteLockstepPool();
+
+    /*!
+     * \brief Runs the main loop of the genetic algorithm on the current population.
+     *
+     * The population must be sorted and completely evaluated. At the end finishRounds is called.
+     *
+     * \param round Number of rounds which have already been run
+     */
+    virtual void runRounds(qint32 round);
+
+    /*!
+     * \brief Stores the best individual and the statistics of the run, saves the last checkpoint and frees the population.
+     *
+     * The population must be sorted and completely evaluated.
+     *
+     * \param rounds Number of rounds the genetic algorithm run
+     */
+    void finishRounds(qint32 rounds);
+
+    /*!
+     * \brief Saves the current state of the genetic algorithm as a checkpoint.
+     * \param filename File the checkpoint is saved to
+     * \param round Number of rounds which have already been run
+     * \return True if save was successful
+     */
+    bool saveCheckpoint(QString filename, qint32 round);
+
+    /*!
+     * \brief Writes a checkpoint with the given population.
+     *
+     * This is used by saveCheckpoint. Subclasses can use it to write a copy of the population, e.g. without holding a lock.
+     *
+     * \param filename File the checkpoint is saved to
+     * \param round Number of rounds which have already been run
+     * \param random_state State of the random engine which is restored when the checkpoint is loaded (see RandomHelper::saveState)
+     * \param genes Genes of the population
+     * \param fitness Fitness of each gene
+     * \return True if save was successful
+     */
+    bool writeCheckpoint(QString filename, qint32 round, QString random_state, QList<GenericGene *> genes, QList<double> fitness);
+
+    /*!
+     * \brief Loads a checkpoint into the population.
+     * \param filename File the checkpoint is loaded from
+     * \param round Pointer to which the number of saved rounds is written
+     * \return True if load was successful. If false the population is not modified
+     */
+    bool loadCheckpoint(QString filename, qint32 *round);
+
     /*!
      * \brief In this function the children in the genetic algorithm are created.
      */
@@ -177,11 +342,6 @@ protected:
          */
         GenericGene* gene;
 
-        /*!
-         * \brief network
-         */
-        AbstractNeuralNetwork *network;
-
         /*!
          * \brief A container is greater if the fitness is smaller
          * \param other Other container
@@ -237,6 +397,75 @@ protected:
      * \brief The rounds needed for the last run
      */
     qint32 _rounds_to_finish;
+
+    /*!
+     * \brief Initialised simulations which are currently not used by evaluateGene
+     */
+    QList<AbstractSimulation *> _evaluation_pool;
+
+    /*!
+     * \brief Mutex protecting _evaluation_pool
+     */
+    QMutex _evaluation_pool_mutex;
+
+    /*!
+     * \brief Path of the checkpoint. Empty if checkpoints are disabled
+     */
+    QString _checkpoint_file;
+
+    /*!
+     * \brief Number of rounds between two checkpoints
+     */
+    qint32 _checkpoint_interval;
+
+    /*!
+     * \brief A container for the objects needed by evaluateGenesLockstep
+     */
+    struct LockstepContext {
+        /*!
+         * \brief ensemble
+         */
+        FeedForwardNetworkEnsemble *ensemble;
+
+        /*!
+         * \brief simulation
+         */
+        AbstractSimulation *simulation;
+    };
+
+    /*!
+     * \brief Number of individuals evaluated together. 0 if lockstep evaluation is disabled
+     */
+    qint32 _lockstep_size;
+
+    /*!
+     * \brief Lockstep contexts which are currently not used by evaluateGenesLockstep. Protected by _evaluation_pool_mutex
+     */
+    QList<LockstepContext> _lockstep_pool;
+
+    /*!
+     * \brief Scheduler running the evaluations. NULL until evaluationScheduler is called for the first time
+     */
+    EvaluationScheduler *_scheduler;
+
+    /*!
+     * \brief Number of threads of the evaluation scheduler. -1 uses QThread::idealThreadCount(). Must be set before the scheduler is created
+     */
+    qint32 _evaluation_threads;
+
+    /*!
+     * \brief Evaluator for worker processes set with setDistributedEvaluator. NULL if genes are evaluated in this process
+     */
+    DistributedEvaluator *_distributed_evaluator;
+
+    /*!
+     * \brief Estimates the evaluation cost of genes. Used to start expensive evaluations first
+     */
+    EvaluationCostModel _cost_model;
+
+private:
+    class GeneBatch;
+    class LockstepBatch;
 };
 
 #endif // GENERICGENETICALGORITHM_H
@@ -0,0 +1,336 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "islandgeneticalgorithm.h"
+
+#include <QThread>
+#include <QAtomicPointer>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+
+/*!
+ * \brief A sub-population of IslandGeneticAlgorithm
+ */
+class IslandGeneticAlgorithm::Island : public GenericGeneticAlgorithm
+{
+    friend class IslandGeneticAlgorithm;
+
+public:
+    Island(IslandGeneticAlgorithm *owner, qint32 index, qint32 population_size) :
+        GenericGeneticAlgorithm(owner->_network, owner->_simulation, population_size, owner->_fitness_to_reach, owner->_max_rounds),
+        _owner(owner),
+        _index(index),
+        _mailbox(NULL),
+        _round(0)
+    {
+    }
+
+    ~Island()
+    {
+        Migrant *migrant = _mailbox.fetchAndStoreAcquire(NULL);
+        while(migrant != NULL)
+        {
+            Migrant *next = migrant->next;
+            delete migrant->gene;
+            delete migrant;
+            migrant = next;
+        }
+    }
+
+    /*!
+     * \brief Runs rounds until max_rounds is reached or the owner stops the run. _round must contain the rounds already run
+     */
+    void evolve()
+    {
+        while(_round < _max_rounds && _owner->_stop.loadAcquire() == 0)
+        {
+            ++_round;
+            createChildren();
+            survivorSelection();
+            qSort(_population);
+
+            if(receiveMigrants())
+            {
+                qSort(_population);
+            }
+            if(_round % _owner->_config.migration_interval == 0)
+            {
+                sendMigrants();
+            }
+
+            double fitness_sum = 0.0;
+            foreach(GeneContainer container, _population)
+            {
+                fitness_sum += container.fitness;
+            }
+            _owner->reportRound(_round, _population.last().fitness, fitness_sum, _population.length());
+        }
+    }
+
+private:
+    /*!
+     * \brief An individual sent to another island. The migrants of a mailbox form a linked list
+     */
+    struct Migrant {
+        GenericGene *gene;
+        double fitness;
+        Migrant *next;
+    };
+
+    /*!
+     * \brief Sends copies of the best individuals to the mailbox of the next island. The population must be sorted
+     */
+    void sendMigrants()
+    {
+        Island *target = _owner->_islands[(_index + 1) % _owner->_islands.length()];
+        if(target == this)
+        {
+            return;
+        }
+
+        for(qint32 i = 0; i < _owner->_config.migrants && i < _population.length(); ++i)
+        {
+            const GeneContainer &container = _population[_population.length()-1-i];
+            Migrant *migrant = new Migrant;
+            migrant->gene = container.gene->createCopy();
+            migrant->fitness = container.fitness;
+
+            // Lock-free push onto the mailbox (Treiber stack). The receiver always takes the whole list, so there is no ABA problem
+            Migrant *head;
+            do
+            {
+                head = target->_mailbox.load();
+                migrant->next = head;
+            } while(!target->_mailbox.testAndSetRelease(head, migrant));
+        }
+    }
+
+    /*!
+     * \brief Replaces the worst individuals with all received migrants which are better. The population must be sorted
+     * \return True if the population was changed
+     */
+    bool receiveMigrants()
+    {
+        Migrant *migrant = _mailbox.fetchAndStoreAcquire(NULL);
+        qint32 replace = 0;
+        while(migrant != NULL)
+        {
+            if(replace < _population.length() && migrant->fitness > _population[replace].fitness)
+            {
+                delete _population[replace].gene;
+                _population[replace].gene = migrant->gene;
+                _population[replace].fitness = migrant->fitness;
+                ++replace;
+            }
+            else
+            {
+                delete migrant->gene;
+            }
+            Migrant *next = migrant->next;
+            delete migrant;
+            migrant = next;
+        }
+        return replace > 0;
+    }
+
+    /*!
+     * \brief The island genetic algorithm this island belongs to
+     */
+    IslandGeneticAlgorithm *_owner;
+
+    /*!
+     * \brief Number of the island
+     */
+    qint32 _index;
+
+    /*!
+     * \brief Migrants sent to this island which have not been received yet
+     */
+    QAtomicPointer<Migrant> _mailbox;
+
+    /*!
+     * \brief Number of rounds run
+     */
+    qint32 _round;
+};
+
+/*!
+ * \brief Thread running IslandGeneticAlgorithm::Island::evolve
+ */
+class IslandGeneticAlgorithm::IslandThread : public QThread
+{
+public:
+    IslandThread(Island *island) :
+        QThread(),
+        _island(island)
+    {
+    }
+
+protected:
+    void run()
+    {
+        _island->evolve();
+    }
+
+private:
+    Island *_island;
+};
+
+IslandGeneticAlgorithm::IslandGeneticAlgorithm(AbstractNeuralNetwork *network, AbstractSimulation *simulation, qint32 population_size, double fitness_to_reach, qint32 max_rounds, config config, QObject *parent) :
+    GenericGeneticAlgorithm(network, simulation, population_size, fitness_to_reach, max_rounds, parent),
+    _config(config),
+    _stop(0),
+    _reports(),
+    _report_mutex(),
+    _islands()
+{
+    if(Q_UNLIKELY(_config.islands <= 0))
+    {
+        QNN_FATAL_MSG("Number of islands must be greater then 0");
+    }
+    if(Q_UNLIKELY(_config.migration_interval <= 0))
+    {
+        QNN_FATAL_MSG("Migration interval must be greater then 0");
+    }
+    if(Q_UNLIKELY(_config.migrants < 0))
+    {
+        QNN_FATAL_MSG("Number of migrants must not be negative");
+    }
+    if(Q_UNLIKELY(population_size < _config.islands))
+    {
+        QNN_FATAL_MSG("Population size must be at least the number of islands");
+    }
+}
+
+IslandGeneticAlgorithm::~IslandGeneticAlgorithm()
+{
+}
+
+IslandGeneticAlgorithm::IslandGeneticAlgorithm(config config, QObject *parent) :
+    GenericGeneticAlgorithm(parent),
+    _config(config),
+    _stop(0),
+    _reports(),
+    _report_mutex(),
+    _islands()
+{
+    if(Q_UNLIKELY(_config.islands <= 0))
+    {
+        QNN_FATAL_MSG("Number of islands must be greater then 0");
+    }
+    if(Q_UNLIKELY(_config.migration_interval <= 0))
+    {
+        QNN_FATAL_MSG("Migration interval must be greater then 0");
+    }
+    if(Q_UNLIKELY(_config.migrants < 0))
+    {
+        QNN_FATAL_MSG("Number of migrants must not be negative");
+    }
+}
+
+void IslandGeneticAlgorithm::runRounds(qint32 round)
+{
+    // The population is sorted, so the run might already be finished
+    _stop.storeRelease(_population.last().fitness >= _fitness_to_reach ? 1 : 0);
+    _reports.clear();
+
+    // Deal the sorted population to the islands so every island gets good and bad individuals
+    qint32 number_islands = qMin(_config.islands, _population.length());
+    QVector< QList<GeneContainer> > populations(number_islands);
+    for(qint32 i = 0; i < _population.length(); ++i)
+    {
+        populations[i % number_islands].append(_population[_population.length()-1-i]);
+    }
+    _population.clear();
+
+    qint32 threads = qMax(1, (_evaluation_threads > 0 ? _evaluation_threads : QThread::idealThreadCount()) / number_islands);
+    for(qint32 i = 0; i < number_islands; ++i)
+    {
+        Island *island = new Island(this, i, populations[i].length());
+        island->_evaluation_threads = threads;
+        if(_lockstep_size > 0)
+        {
+            island->setLockstepEvaluation(_lockstep_size);
+        }
+        island->setDistributedEvaluator(_distributed_evaluator);
+        island->_population = populations[i];
+        island->_round = round;
+        _islands.append(island);
+    }
+
+    QList<IslandThread *> islandThreads;
+    foreach(Island *island, _islands)
+    {
+        IslandThread *thread = new IslandThread(island);
+        islandThreads.append(thread);
+        thread->start();
+    }
+    foreach(IslandThread *thread, islandThreads)
+    {
+        thread->wait();
+    }
+    qDeleteAll(islandThreads);
+
+    // Merge the islands
+    qint32 rounds = round;
+    foreach(Island *island, _islands)
+    {
+        rounds = qMax(rounds, island->_round);
+        _population.append(island->_population);
+        island->_population.clear();
+    }
+    qDeleteAll(_islands);
+    _islands.clear();
+    _reports.clear();
+
+    qSort(_population);
+    if(!_checkpoint_file.isEmpty() && rounds % _checkpoint_interval == 0)
+    {
+        saveCheckpoint(_checkpoint_file, rounds);
+    }
+    finishRounds(rounds);
+}
+
+void IslandGeneticAlgorithm::reportRound(qint32 round, double best_fitness, double fitness_sum, qint32 individuals)
+{
+    if(best_fitness >= _fitness_to_reach)
+    {
+        _stop.storeRelease(1);
+    }
+
+    QMutexLocker locker(&_report_mutex);
+    if(!_reports.contains(round))
+    {
+        RoundReport new_report;
+        new_report.best_fitness = best_fitness;
+        new_report.fitness_sum = 0.0;
+        new_report.individuals = 0;
+        new_report.islands = 0;
+        _reports.insert(round, new_report);
+    }
+    RoundReport &report = _reports[round];
+    report.best_fitness = qMax(report.best_fitness, best_fitness);
+    report.fitness_sum += fitness_sum;
+    report.individuals += individuals;
+    if(++report.islands == _islands.length())
+    {
+        emit ga_current_round(round, _max_rounds, report.best_fitness, report.fitness_sum / report.individuals);
+        _reports.remove(round);
+    }
+}
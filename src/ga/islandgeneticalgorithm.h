@@ -0,0 +1,173 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef ISLANDGENETICALGORITHM_H
+#define ISLANDGENETICALGORITHM_H
+
+#include <qnn-global.h>
+
+#include "genericgeneticalgorithm.h"
+#include <QAtomicInt>
+#include <QMap>
+#include <QMutex>
+
+/*!
+ * \brief The IslandGeneticAlgorithm class runs several sub-populations (islands) of the genetic algorithm in parallel.
+ *
+ * Each island evolves independently using the operators of GenericGeneticAlgorithm in its own thread with its own evaluation scheduler,
+ * so the islands never wait for each other. The threads are split evenly between the islands.
+ * Lockstep evaluation and the distributed evaluator are used by all islands.
+ * Every migration_interval rounds each island sends copies of its best individuals to the next island (ring topology).
+ * Migrants are passed through lock-free mailboxes and replace the worst individuals of the receiving island if they are better.
+ *
+ * ga_current_round is emitted with the best and average fitness of all islands once every island has finished a round.
+ * It is emitted from the thread of the last island finishing the round. The run ends once all islands have run max_rounds rounds
+ * or one island has reached fitness_to_reach.
+ *
+ * Checkpoints are only saved after the initial population has been evaluated and at the end of the run.
+ */
+class QNNSHARED_EXPORT IslandGeneticAlgorithm : public GenericGeneticAlgorithm
+{
+public:
+    /*!
+     * \brief This struct contains all configuration option of the island genetic algorithm
+     */
+    struct config {
+        /*!
+         * \brief islands holds the number of sub-populations. Must be greater then 0
+         */
+        qint32 islands;
+
+        /*!
+         * \brief migration_interval holds the number of rounds between two migrations. Must be greater then 0
+         */
+        qint32 migration_interval;
+
+        /*!
+         * \brief migrants holds the number of individuals each island sends at each migration
+         */
+        qint32 migrants;
+
+        /*!
+         * \brief Constructor for standard values
+         */
+        config() :
+            islands(4),
+            migration_interval(10),
+            migrants(2)
+        {
+        }
+    };
+
+    /*!
+     * \brief Constructor of IslandGeneticAlgorithm
+     * \param network The network which should be optimised. Might not be NULL
+     * \param simulation The simulation for which the network should be optimised. Might not be NULL
+     * \param population_size The population size of all islands together. Must be at least config.islands
+     * \param fitness_to_reach The fitness which should be reached. Once it has been reached by one island the genetic algorithm will finish
+     * \param max_rounds The maximum amount of rounds. The genetic algorithm will abort after the amount of rounds
+     * \param config Configuration for this genetic algorithm
+     * \param parent The parent of the object
+     */
+    IslandGeneticAlgorithm(AbstractNeuralNetwork *network, AbstractSimulation *simulation, qint32 population_size = 300, double fitness_to_reach = 0.99, qint32 max_rounds = 200, config config = config(), QObject *parent = 0);
+
+    /*!
+     * \brief Deconstructor
+     */
+    virtual ~IslandGeneticAlgorithm();
+
+protected:
+    /*!
+     * \brief Empty constructor
+     *
+     * This constructor may be useful for subclasses
+     */
+    IslandGeneticAlgorithm(config config = config(), QObject *parent = 0);
+
+    /*!
+     * \brief Overwritten main loop. Splits the population into the islands, runs them and merges the populations afterwards
+     * \param round Number of rounds which have already been run
+     */
+    void runRounds(qint32 round);
+
+    /*!
+     * \brief Collects the result of a round of one island. Emits ga_current_round once all islands have finished the round
+     * \param round Round the island has finished
+     * \param best_fitness Best fitness of the island
+     * \param fitness_sum Sum of the fitness of all individuals of the island
+     * \param individuals Number of individuals of the island
+     */
+    void reportRound(qint32 round, double best_fitness, double fitness_sum, qint32 individuals);
+
+    /*!
+     * \brief Configuration of the genetic algorithm
+     */
+    config _config;
+
+    /*!
+     * \brief Set to 1 once an island has reached the fitness to reach. All islands stop after their current round
+     */
+    QAtomicInt _stop;
+
+    /*!
+     * \brief Result of a round collected from all islands
+     */
+    struct RoundReport {
+        /*!
+         * \brief Best fitness of all reported islands
+         */
+        double best_fitness;
+
+        /*!
+         * \brief Sum of the fitness of all reported individuals
+         */
+        double fitness_sum;
+
+        /*!
+         * \brief Number of reported individuals
+         */
+        qint32 individuals;
+
+        /*!
+         * \brief Number of reported islands
+         */
+        qint32 islands;
+    };
+
+    /*!
+     * \brief Rounds which have not been reported by all islands yet. Protected by _report_mutex
+     */
+    QMap<qint32, RoundReport> _reports;
+
+    /*!
+     * \brief Mutex protecting _reports
+     */
+    QMutex _report_mutex;
+
+private:
+    class Island;
+    class IslandThread;
+
+    /*!
+     * \brief The islands of the current run. Empty if no run is active
+     */
+    QList<Island *> _islands;
+};
+
+#endif // ISLANDGENETICALGORITHM_H
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "populationarchive.h"
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <cstring>
+
+namespace {
+/*
+  Archive format (all values little endian):
+
+  magic "QNNPOPA\0" (8 byte) | quint32 version | quint32 amount of individuals | quint64 size of archive
+  index: per individual double fitness | quint64 offset of gene | quint64 length of gene
+  genes in the binary gene format, each one aligned to 8 byte
+
+  All offsets are relative to the start of the archive.
+*/
+
+const char ARCHIVE_MAGIC[] = "QNNPOPA";
+const qint32 ARCHIVE_MAGIC_SIZE = 8;
+const quint32 ARCHIVE_VERSION = 1;
+const qint64 ARCHIVE_HEADER_SIZE = 24;
+const qint64 ARCHIVE_INDEX_ENTRY_SIZE = 24;
+
+struct IndexEntry {
+    double fitness;
+    quint64 offset;
+    quint64 length;
+};
+
+void prepareArchiveStream(QDataStream *stream)
+{
+    stream->setVersion(QDataStream::Qt_5_0);
+    stream->setByteOrder(QDataStream::LittleEndian);
+}
+
+bool readHeader(QIODevice *device, quint32 *count, quint64 *size)
+{
+    QByteArray header = device->peek(ARCHIVE_HEADER_SIZE);
+    if(header.size() != ARCHIVE_HEADER_SIZE || memcmp(header.constData(), ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE) != 0)
+    {
+        return false;
+    }
+
+    QDataStream stream(&header, QIODevice::ReadOnly);
+    prepareArchiveStream(&stream);
+    quint32 version;
+    stream.skipRawData(ARCHIVE_MAGIC_SIZE);
+    stream >> version;
+    stream >> *count;
+    stream >> *size;
+    return stream.status() == QDataStream::Ok && version == ARCHIVE_VERSION && *size >= (quint64) (ARCHIVE_HEADER_SIZE + *count * ARCHIVE_INDEX_ENTRY_SIZE);
+}
+
+bool readIndex(QIODevice *device, qint64 start, qint32 first, qint32 count, quint64 size, QList<IndexEntry> *index)
+{
+    if(!device->seek(start + ARCHIVE_HEADER_SIZE + first * ARCHIVE_INDEX_ENTRY_SIZE))
+    {
+        return false;
+    }
+    QByteArray data = device->read(count * ARCHIVE_INDEX_ENTRY_SIZE);
+    if(data.size() != count * ARCHIVE_INDEX_ENTRY_SIZE)
+    {
+        return false;
+    }
+
+    QDataStream stream(&data, QIODevice::ReadOnly);
+    prepareArchiveStream(&stream);
+    for(qint32 i = 0; i < count; ++i)
+    {
+        IndexEntry entry;
+        stream >> entry.fitness;
+        stream >> entry.offset;
+        stream >> entry.length;
+        if(entry.offset + entry.length > size)
+        {
+            return false;
+        }
+        index->append(entry);
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+GenericGene *readGene(GenericGene *prototype, QIODevice *device, qint64 start, IndexEntry entry, const uchar *mapping = NULL)
+{
+    if(mapping != NULL)
+    {
+        return prototype->loadGene(mapping + entry.offset, entry.length);
+    }
+    if(!device->seek(start + entry.offset))
+    {
+        return NULL;
+    }
+    return prototype->loadGene(device);
+}
+}
+
+namespace PopulationArchive {
+bool savePopulation(QList<GenericGene *> genes, QList<double> fitness, QIODevice *device)
+{
+    if(Q_UNLIKELY(device == NULL))
+    {
+        QNN_WARNING_MSG("device is NULL");
+        return false;
+    }
+    if(Q_UNLIKELY(genes.length() != fitness.length()))
+    {
+        QNN_CRITICAL_MSG("genes and fitness must have the same length");
+        return false;
+    }
+
+    // The whole archive is assembled in memory first so it can be written in one sequential write
+    QByteArray archive;
+    QBuffer buffer(&archive);
+    buffer.open(QIODevice::WriteOnly);
+
+    // Reserve space for header and index - they are written once all offsets are known
+    buffer.write(QByteArray(ARCHIVE_HEADER_SIZE + genes.length() * ARCHIVE_INDEX_ENTRY_SIZE, '\0'));
+
+    QList<IndexEntry> index;
+    for(qint32 i = 0; i < genes.length(); ++i)
+    {
+        if(Q_UNLIKELY(genes[i] == NULL))
+        {
+            QNN_CRITICAL_MSG("Gene might not be NULL");
+            return false;
+        }
+        IndexEntry entry;
+        entry.fitness = fitness[i];
+        entry.offset = buffer.pos();
+        if(!genes[i]->saveGeneBinary(&buffer))
+        {
+            QNN_CRITICAL_MSG("Can not save gene");
+            return false;
+        }
+        entry.length = buffer.pos() - entry.offset;
+        index.append(entry);
+
+        // Keep every gene aligned to 8 byte
+        buffer.write(QByteArray((8 - buffer.pos() % 8) % 8, '\0'));
+    }
+    quint64 size = buffer.pos();
+
+    buffer.seek(0);
+    QDataStream stream(&buffer);
+    prepareArchiveStream(&stream);
+    stream.writeRawData(ARCHIVE_MAGIC, ARCHIVE_MAGIC_SIZE);
+    stream << ARCHIVE_VERSION;
+    stream << (quint32) genes.length();
+    stream << size;
+    foreach(IndexEntry entry, index)
+    {
+        stream << entry.fitness;
+        stream << entry.offset;
+        stream << entry.length;
+    }
+    buffer.close();
+
+    bool opened_device = false;
+    if(!device->isOpen())
+    {
+        QNN_DEBUG_MSG("Opening device");
+        if(!device->open(QIODevice::WriteOnly))
+        {
+            QNN_CRITICAL_MSG("Can not open device");
+            return false;
+        }
+        opened_device = true;
+    }
+
+    bool result = device->write(archive) == archive.size();
+    if(!result)
+    {
+        QNN_CRITICAL_MSG("Can not write archive");
+    }
+
+    if(opened_device)
+    {
+        device->close();
+    }
+    return result;
+}
+
+bool loadPopulation(GenericGene *prototype, QList<GenericGene *> *genes, QList<double> *fitness, QIODevice *device)
+{
+    if(Q_UNLIKELY(prototype == NULL || genes == NULL || fitness == NULL || device == NULL))
+    {
+        QNN_WARNING_MSG("Arguments might not be NULL");
+        return false;
+    }
+
+    bool opened_device = false;
+    if(!device->isOpen())
+    {
+        QNN_DEBUG_MSG("Opening device");
+        if(!device->open(QIODevice::ReadOnly))
+        {
+            QNN_CRITICAL_MSG("Can not open device");
+            return false;
+        }
+        opened_device = true;
+    }
+
+    qint64 start = device->pos();
+    quint32 count;
+    quint64 size;
+    QList<IndexEntry> index;
+    QList<GenericGene *> loaded;
+    bool result = readHeader(device, &count, &size) && readIndex(device, start, 0, count, size, &index);
+    if(!result)
+    {
+        QNN_CRITICAL_MSG("No valid population archive");
+    }
+
+    // Map the whole archive once so all genes are copied straight from the mapping
+    QFile *file = qobject_cast<QFile *>(device);
+    uchar *mapping = result && file != NULL && size > 0 ? file->map(start, size) : NULL;
+
+    for(qint32 i = 0; result && i < index.length(); ++i)
+    {
+        GenericGene *gene = readGene(prototype, device, start, index[i], mapping);
+        if(gene == NULL)
+        {
+            QNN_CRITICAL_MSG("Can not load gene");
+            result = false;
+        }
+        else
+        {
+            loaded.append(gene);
+        }
+    }
+    if(mapping != NULL)
+    {
+        file->unmap(mapping);
+    }
+
+    if(result)
+    {
+        genes->append(loaded);
+        foreach(IndexEntry entry, index)
+        {
+            fitness->append(entry.fitness);
+        }
+        device->seek(start + size);
+    }
+    else
+    {
+        qDeleteAll(loaded);
+        device->seek(start);
+    }
+
+    if(opened_device)
+    {
+        device->close();
+    }
+    return result;
+}
+
+qint32 populationSize(QIODevice *device)
+{
+    if(Q_UNLIKELY(device == NULL))
+    {
+        QNN_WARNING_MSG("device is NULL");
+        return -1;
+    }
+
+    quint32 count;
+    quint64 size;
+    if(!readHeader(device, &count, &size))
+    {
+        return -1;
+    }
+    return count;
+}
+
+GenericGene *loadIndividual(GenericGene *prototype, qint32 index, QIODevice *device, double *fitness)
+{
+    if(Q_UNLIKELY(prototype == NULL || device == NULL))
+    {
+        QNN_WARNING_MSG("Arguments might not be NULL");
+        return NULL;
+    }
+
+    qint64 start = device->pos();
+    quint32 count;
+    quint64 size;
+    if(!readHeader(device, &count, &size))
+    {
+        QNN_CRITICAL_MSG("No valid population archive");
+        return NULL;
+    }
+    if(Q_UNLIKELY(index < 0 || (quint32) index >= count))
+    {
+        QNN_CRITICAL_MSG("Index out of range");
+        return NULL;
+    }
+
+    QList<IndexEntry> entry;
+    GenericGene *gene = NULL;
+    if(readIndex(device, start, index, 1, size, &entry))
+    {
+        gene = readGene(prototype, device, start, entry.first());
+        if(gene != NULL && fitness != NULL)
+        {
+            *fitness = entry.first().fitness;
+        }
+    }
+    else
+    {
+        QNN_CRITICAL_MSG("Invalid index entry");
+    }
+    device->seek(start);
+    return gene;
+}
+
+bool isPopulationArchive(QIODevice *device)
+{
+    if(Q_UNLIKELY(device == NULL))
+    {
+        QNN_WARNING_MSG("device is NULL");
+        return false;
+    }
+
+    quint32 count;
+    quint64 size;
+    return readHeader(device, &count, &size);
+}
+}
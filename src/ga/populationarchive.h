@@ -0,0 +1,99 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef POPULATIONARCHIVE_H
+#define POPULATIONARCHIVE_H
+
+#include <qnn-global.h>
+
+#include "../network/genericgene.h"
+#include <QIODevice>
+#include <QList>
+
+/*!
+ * \brief This namespace contains functions to save and load a whole population into a single archive.
+ *
+ * An archive consists of a header, an index holding the fitness, offset and length of each individual and the genes in the binary gene format.
+ * All offsets are relative to the start of the archive, so an archive may be embedded into another file.
+ * The archive is written with one sequential write and every individual can be loaded without parsing the rest of the archive.
+ */
+namespace PopulationArchive {
+
+/*!
+ * \brief Saves a population as an archive.
+ *
+ * The archive is written at the current position of the device. If the device is not open it will be opened and closed after the archive was written.
+ *
+ * \param genes The genes of the population. None of the genes might be NULL
+ * \param fitness The fitness of each gene. Must have the same length as genes
+ * \param device The QIODevice to which the archive is saved
+ * \return True if save was successful
+ */
+bool savePopulation(QList<GenericGene *> genes, QList<double> fitness, QIODevice *device);
+
+/*!
+ * \brief Loads a whole population from an archive.
+ *
+ * The archive is read from the current position of the device. After loading the device is positioned behind the archive.
+ * If the device is not open it will be opened and closed after the archive was read.
+ * If the device is a QFile the archive is mapped once and every gene is copied straight from the mapping.
+ *
+ * \param prototype A gene of the type stored in the archive. It is only used to load the genes and is not modified
+ * \param genes List to which the loaded genes are appended. The caller must delete the genes
+ * \param fitness List to which the fitness values are appended
+ * \param device The QIODevice from which the archive is loaded
+ * \return True if load was successful. If the load was not successful genes and fitness are not modified
+ */
+bool loadPopulation(GenericGene *prototype, QList<GenericGene *> *genes, QList<double> *fitness, QIODevice *device);
+
+/*!
+ * \brief Returns the number of individuals in an archive.
+ *
+ * The device must be open and positioned at the start of the archive. The position is not changed.
+ *
+ * \param device The QIODevice containing the archive
+ * \return Number of individuals or -1 if the device does not contain an archive
+ */
+qint32 populationSize(QIODevice *device);
+
+/*!
+ * \brief Loads a single individual from an archive.
+ *
+ * The device must be open and positioned at the start of the archive. Only the index entry and the gene itself are read.
+ * After loading the device is positioned at the start of the archive again.
+ *
+ * \param prototype A gene of the type stored in the archive. It is only used to load the gene and is not modified
+ * \param index Index of the individual
+ * \param device The QIODevice containing the archive
+ * \param fitness If not NULL the fitness of the individual is written to this pointer
+ * \return Loaded gene (NULL if unsuccessful). The caller must delete the gene
+ */
+GenericGene *loadIndividual(GenericGene *prototype, qint32 index, QIODevice *device, double *fitness = NULL);
+
+/*!
+ * \brief Tests if the device contains an archive at the current position.
+ *
+ * The position of the device is not changed.
+ *
+ * \param device The QIODevice to test. Must be open
+ * \return True if the device contains an archive
+ */
+bool isPopulationArchive(QIODevice *device);
+}
+
+#endif // POPULATIONARCHIVE_H
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "steadystategeneticalgorithm.h"
+
+#include <QtAlgorithms>
+#include <QMutexLocker>
+#include <randomhelper.h>
+
+/*!
+ * \brief Runs SteadyStateGeneticAlgorithm::breed once per job
+ */
+class SteadyStateGeneticAlgorithm::BreedingBatch : public EvaluationScheduler::Batch
+{
+public:
+    BreedingBatch(SteadyStateGeneticAlgorithm *ga) :
+        _ga(ga)
+    {
+    }
+
+    void runJob(qint32)
+    {
+        _ga->breed();
+    }
+
+private:
+    SteadyStateGeneticAlgorithm *_ga;
+};
+
+SteadyStateGeneticAlgorithm::SteadyStateGeneticAlgorithm(AbstractNeuralNetwork *network, AbstractSimulation *simulation, qint32 population_size, double fitness_to_reach, qint32 max_rounds, config config, QObject *parent) :
+    GenericGeneticAlgorithm(network, simulation, population_size, fitness_to_reach, max_rounds, parent),
+    _config(config),
+    _population_mutex(),
+    _round(0),
+    _evaluations(0),
+    _best_fitness(-1.0),
+    _finished(true),
+    _checkpoint_mutex(),
+    _checkpoint_round(-1),
+    _random_state()
+{
+    if(Q_UNLIKELY(population_size < 2))
+    {
+        QNN_FATAL_MSG("Population size must be at least 2");
+    }
+    if(Q_UNLIKELY(_config.tournament_size < 2))
+    {
+        QNN_FATAL_MSG("Tournament size must be at least 2");
+    }
+}
+
+SteadyStateGeneticAlgorithm::~SteadyStateGeneticAlgorithm()
+{
+}
+
+SteadyStateGeneticAlgorithm::SteadyStateGeneticAlgorithm(config config, QObject *parent) :
+    GenericGeneticAlgorithm(parent),
+    _config(config),
+    _population_mutex(),
+    _round(0),
+    _evaluations(0),
+    _best_fitness(-1.0),
+    _finished(true),
+    _checkpoint_mutex(),
+    _checkpoint_round(-1),
+    _random_state()
+{
+    if(Q_UNLIKELY(_config.tournament_size < 2))
+    {
+        QNN_FATAL_MSG("Tournament size must be at least 2");
+    }
+}
+
+void SteadyStateGeneticAlgorithm::runRounds(qint32 round)
+{
+    if(Q_UNLIKELY(_population.length() < 2))
+    {
+        QNN_FATAL_MSG("Population must contain at least 2 individuals");
+    }
+
+    _round = round;
+    _evaluations = 0;
+    _best_fitness = _population.last().fitness;
+    _finished = _round >= _max_rounds || _best_fitness >= _fitness_to_reach;
+    _checkpoint_round = round;
+    _random_state = RandomHelper::saveState();
+
+    if(!_finished)
+    {
+        EvaluationScheduler *scheduler = evaluationScheduler();
+        BreedingBatch batch(this);
+        scheduler->run(&batch, scheduler->numberThreads());
+    }
+
+    qSort(_population);
+    finishRounds(_round);
+}
+
+void SteadyStateGeneticAlgorithm::breed()
+{
+    while(true)
+    {
+        QList<GenericGene *> childrenGene;
+        {
+            QMutexLocker locker(&_population_mutex);
+            if(_finished)
+            {
+                return;
+            }
+
+            // Use the two best individuals of the tournament as parents
+            QVector<qint32> selection = tournament();
+            qint32 first = selection[0];
+            qint32 second = selection[1];
+            if(_population[second].fitness > _population[first].fitness)
+            {
+                qSwap(first, second);
+            }
+            for(qint32 i = 2; i < selection.size(); ++i)
+            {
+                if(_population[selection[i]].fitness > _population[first].fitness)
+                {
+                    second = first;
+                    first = selection[i];
+                }
+                else if(_population[selection[i]].fitness > _population[second].fitness)
+                {
+                    second = selection[i];
+                }
+            }
+            childrenGene = _population[first].gene->combine(_population[first].gene, _population[second].gene);
+        }
+
+        foreach(GenericGene *gene, childrenGene)
+        {
+            gene->mutate();
+        }
+        QList<double> fitnessList = evaluateGenesInThread(childrenGene);
+
+        QList<GeneContainer> children;
+        for(qint32 i = 0; i < childrenGene.length(); ++i)
+        {
+            GeneContainer container;
+            container.gene = childrenGene[i];
+            container.fitness = fitnessList[i];
+            children.append(container);
+        }
+
+        QList<GenericGene *> checkpoint_genes;
+        QList<double> checkpoint_fitness;
+        qint32 checkpoint_round = -1;
+        {
+            QMutexLocker locker(&_population_mutex);
+            foreach(GeneContainer child, children)
+            {
+                if(_finished)
+                {
+                    delete child.gene;
+                    continue;
+                }
+                if(insertChild(child))
+                {
+                    // Copy the population so the checkpoint can be written without blocking the other threads
+                    qDeleteAll(checkpoint_genes);
+                    checkpoint_genes.clear();
+                    checkpoint_fitness.clear();
+                    foreach(GeneContainer container, _population)
+                    {
+                        checkpoint_genes.append(container.gene->createCopy());
+                        checkpoint_fitness.append(container.fitness);
+                    }
+                    checkpoint_round = _round;
+                }
+            }
+        }
+
+        if(checkpoint_round >= 0)
+        {
+            writeCheckpointCopy(checkpoint_round, checkpoint_genes, checkpoint_fitness);
+        }
+    }
+}
+
+QVector<qint32> SteadyStateGeneticAlgorithm::tournament()
+{
+    qint32 size = qMin(_config.tournament_size, _population.length());
+    QVector<qint32> selection;
+    selection.reserve(size);
+    while(selection.size() < size)
+    {
+        qint32 index = RandomHelper::getRandomInt(0, _population.length()-1);
+        if(!selection.contains(index))
+        {
+            selection.append(index);
+        }
+    }
+    return selection;
+}
+
+bool SteadyStateGeneticAlgorithm::insertChild(GeneContainer child)
+{
+    QVector<qint32> selection = tournament();
+    qint32 worst = selection[0];
+    for(qint32 i = 1; i < selection.size(); ++i)
+    {
+        if(_population[selection[i]].fitness < _population[worst].fitness)
+        {
+            worst = selection[i];
+        }
+    }
+
+    if(child.fitness > _population[worst].fitness)
+    {
+        delete _population[worst].gene;
+        _population[worst] = child;
+        _best_fitness = qMax(_best_fitness, child.fitness);
+    }
+    else
+    {
+        delete child.gene;
+    }
+
+    if(++_evaluations < _population_size)
+    {
+        return false;
+    }
+
+    // A virtual generation is finished
+    _evaluations = 0;
+    ++_round;
+    emit ga_current_round(_round, _max_rounds, _best_fitness, calculateAverageFitness());
+
+    if(_round >= _max_rounds || _best_fitness >= _fitness_to_reach)
+    {
+        _finished = true;
+    }
+
+    return !_checkpoint_file.isEmpty() && _round % _checkpoint_interval == 0;
+}
+
+void SteadyStateGeneticAlgorithm::writeCheckpointCopy(qint32 round, QList<GenericGene *> genes, QList<double> fitness)
+{
+    QMutexLocker locker(&_checkpoint_mutex);
+    if(round > _checkpoint_round)
+    {
+        writeCheckpoint(_checkpoint_file, round, _random_state, genes, fitness);
+        _checkpoint_round = round;
+    }
+    qDeleteAll(genes);
+}
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef STEADYSTATEGENETICALGORITHM_H
+#define STEADYSTATEGENETICALGORITHM_H
+
+#include <qnn-global.h>
+
+#include "genericgeneticalgorithm.h"
+#include <QMutex>
+
+/*!
+ * \brief The SteadyStateGeneticAlgorithm class is an asynchronous steady state version of the genetic algorithm.
+ *
+ * Instead of waiting for a whole generation each thread of the evaluation scheduler repeatedly selects two parents by a tournament,
+ * creates children using combine and mutate, evaluates them with evaluateGenesInThread and inserts them into the shared population.
+ * A child replaces the worst individual of a second tournament if it is better. This way no thread has to wait for slow evaluations of other threads.
+ *
+ * Selection and replacement of all threads are serialised by a single mutex (_population_mutex).
+ * The locked sections only select indices, combine two genes and swap pointers. Evaluations and checkpoint writes run without the lock,
+ * so a fine-grained or lock-free replacement scheme is not used.
+ *
+ * A round is a virtual generation of population_size evaluations. ga_current_round is emitted from the evaluating threads after each virtual generation.
+ * Because the threads are running asynchronously a run is not reproducible even if the random engines are seeded.
+ */
+class QNNSHARED_EXPORT SteadyStateGeneticAlgorithm : public GenericGeneticAlgorithm
+{
+public:
+    /*!
+     * \brief This struct contains all configuration option of the steady state genetic algorithm
+     */
+    struct config {
+        /*!
+         * \brief tournament_size holds the number of individuals in each tournament for selection and replacement
+         *
+         * Must be at least 2. If the population is smaller the whole population is used
+         */
+        qint32 tournament_size;
+
+        /*!
+         * \brief Constructor for standard values
+         */
+        config() :
+            tournament_size(8)
+        {
+        }
+    };
+
+    /*!
+     * \brief Constructor of SteadyStateGeneticAlgorithm
+     * \param network The network which should be optimised. Might not be NULL
+     * \param simulation The simulation for which the network should be optimised. Might not be NULL
+     * \param population_size The population size. Must be at least 2
+     * \param fitness_to_reach The fitness which should be reached. Once it has been reached the genetic algorithm will finish
+     * \param max_rounds The maximum amount of virtual generations. The genetic algorithm will abort after the amount of rounds
+     * \param config Configuration for this genetic algorithm
+     * \param parent The parent of the object
+     */
+    SteadyStateGeneticAlgorithm(AbstractNeuralNetwork *network, AbstractSimulation *simulation, qint32 population_size = 300, double fitness_to_reach = 0.99, qint32 max_rounds = 200, config config = config(), QObject *parent = 0);
+
+    /*!
+     * \brief Deconstructor
+     */
+    virtual ~SteadyStateGeneticAlgorithm();
+
+protected:
+    /*!
+     * \brief Empty constructor
+     *
+     * This constructor may be useful for subclasses
+     */
+    SteadyStateGeneticAlgorithm(config config = config(), QObject *parent = 0);
+
+    /*!
+     * \brief Overwritten main loop. Runs the breeding loop on all threads of the evaluation scheduler until the run is finished
+     * \param round Number of rounds which have already been run
+     */
+    void runRounds(qint32 round);
+
+    /*!
+     * \brief Creates, evaluates and inserts children until the run is finished. This method is run by each thread
+     */
+    void breed();
+
+    /*!
+     * \brief Selects a random tournament from the population. _population_mutex must be locked
+     * \return Indices of the individuals in the tournament
+     */
+    QVector<qint32> tournament();
+
+    /*!
+     * \brief Inserts an evaluated child into the population or deletes it. _population_mutex must be locked
+     * \param child Child to insert. The genetic algorithm takes ownership of the gene
+     * \return True if a virtual generation has finished and a checkpoint should be saved
+     */
+    bool insertChild(GeneContainer child);
+
+    /*!
+     * \brief Writes a copy of the population as a checkpoint. _population_mutex must not be locked
+     *
+     * Checkpoints of older rounds than the last written one are discarded.
+     *
+     * \param round Number of finished virtual generations
+     * \param genes Copy of the genes of the population. The genes are deleted
+     * \param fitness Fitness of each gene
+     */
+    void writeCheckpointCopy(qint32 round, QList<GenericGene *> genes, QList<double> fitness);
+
+    /*!
+     * \brief Configuration of the genetic algorithm
+     */
+    config _config;
+
+    /*!
+     * \brief Mutex protecting the population and all state of the running loop
+     */
+    QMutex _population_mutex;
+
+    /*!
+     * \brief Number of finished virtual generations
+     */
+    qint32 _round;
+
+    /*!
+     * \brief Number of evaluated children in the current virtual generation
+     */
+    qint32 _evaluations;
+
+    /*!
+     * \brief Best fitness in the population
+     */
+    double _best_fitness;
+
+    /*!
+     * \brief True if the run has finished. Threads stop after the current child and discard it
+     */
+    bool _finished;
+
+    /*!
+     * \brief Mutex serialising checkpoint writes
+     */
+    QMutex _checkpoint_mutex;
+
+    /*!
+     * \brief Round of the last written checkpoint
+     */
+    qint32 _checkpoint_round;
+
+    /*!
+     * \brief State of the random engine of the thread which started the run. It is saved in the checkpoints
+     *
+     * The breeding threads run asynchronously, so the state of any of them would not help to continue the run.
+     */
+    QString _random_state;
+
+private:
+    class BreedingBatch;
+};
+
+#endif // STEADYSTATEGENETICALGORITHM_H
@@ -18,24 +18,30 @@
 
 #include "abstractneuralnetwork.h"
 #include <QString>
+#include <QVector>
 
 AbstractNeuralNetwork::AbstractNeuralNetwork(qint32 len_input, qint32 len_output) :
     _len_input(len_input),
     _len_output(len_output),
-    _gene(NULL)
+    _gene(NULL),
+    _shared_gene(false)
 {
 }
 
 AbstractNeuralNetwork::AbstractNeuralNetwork() :
     _len_input(0),
     _len_output(0),
-    _gene(NULL)
+    _gene(NULL),
+    _shared_gene(false)
 {
 }
 
 AbstractNeuralNetwork::~AbstractNeuralNetwork()
 {
-    delete _gene;
+    if(!_shared_gene)
+    {
+        delete _gene;
+    }
 }
 
 void AbstractNeuralNetwork::initialise(GenericGene *gene)
@@ -53,6 +59,47 @@ void AbstractNeuralNetwork::initialise(GenericGene *gene)
     _initialise();
 }
 
+void AbstractNeuralNetwork::reinitialise(GenericGene *gene)
+{
+    if(Q_UNLIKELY(gene == NULL))
+    {
+        QNN_CRITICAL_MSG("Can not initialise with NULL gene");
+        return;
+    }
+    if(!_shared_gene)
+    {
+        delete _gene;
+    }
+    _gene = gene->createCopy();
+    _shared_gene = false;
+    _initialise();
+}
+
+void AbstractNeuralNetwork::reinitialiseShared(GenericGene *gene)
+{
+    if(Q_UNLIKELY(gene == NULL))
+    {
+        QNN_CRITICAL_MSG("Can not initialise with NULL gene");
+        return;
+    }
+    if(!_shared_gene)
+    {
+        delete _gene;
+    }
+    _gene = gene;
+    _shared_gene = true;
+    _initialise();
+}
+
+void AbstractNeuralNetwork::resetState()
+{
+    if(Q_UNLIKELY(_gene == NULL))
+    {
+        QNN_FATAL_MSG("Network not initialised");
+    }
+    _resetState();
+}
+
 void AbstractNeuralNetwork::processInput(QList<double> input)
 {
     if(Q_UNLIKELY(_gene == NULL))
@@ -63,6 +110,20 @@ void AbstractNeuralNetwork::processInput(QList<double> input)
     {
         QNN_FATAL_MSG("input length != _len_input");
     }
+    QVector<double> buffer = input.toVector();
+    _processInput(buffer.constData());
+}
+
+void AbstractNeuralNetwork::processInput(const double *input, qint32 length)
+{
+    if(Q_UNLIKELY(_gene == NULL))
+    {
+        QNN_FATAL_MSG("Network not initialised");
+    }
+    if(Q_UNLIKELY(input == NULL || length != _len_input))
+    {
+        QNN_FATAL_MSG("input length != _len_input");
+    }
     _processInput(input);
 }
 
@@ -75,6 +136,20 @@ double AbstractNeuralNetwork::getNeuronOutput(qint32 i)
     return _getNeuronOutput(i);
 }
 
+void AbstractNeuralNetwork::getOutputs(double *output)
+{
+    if(Q_UNLIKELY(_gene == NULL))
+    {
+        QNN_FATAL_MSG("Network not initialised");
+    }
+    if(Q_UNLIKELY(output == NULL))
+    {
+        QNN_CRITICAL_MSG("output is NULL");
+        return;
+    }
+    _getOutputs(output);
+}
+
 bool AbstractNeuralNetwork::saveNetworkConfig(QIODevice *device)
 {
     if(Q_UNLIKELY(device == NULL))
@@ -62,6 +62,34 @@ public:
      */
     void initialise(GenericGene *gene);
 
+    /*!
+     * \brief Initialises the network with a new gene.
+     *
+     * Unlike initialise this method may also be called on an already initialised network.
+     * The network reuses its buffers if the size of the network does not change, so this is much faster than creating a new network for each gene.
+     *
+     * \param gene Gene of the network. The caller must delete the gene
+     */
+    void reinitialise(GenericGene *gene);
+
+    /*!
+     * \brief Initialises the network with a new gene without copying the gene.
+     *
+     * This works like reinitialise but the network only keeps a pointer to the gene.
+     * It is meant for owners of a gene copy (e.g. AbstractSimulation) which evaluate a network on the gene and want to avoid a second copy.
+     *
+     * \param gene Gene of the network. The gene must stay valid and unchanged until the network is reinitialised or deleted. The caller must delete the gene
+     */
+    void reinitialiseShared(GenericGene *gene);
+
+    /*!
+     * \brief Resets the dynamic state of the network.
+     *
+     * After the reset the network behaves like a newly initialised network with the same gene.
+     * The decoded topology is kept, so this is much faster than initialising a new network.
+     */
+    void resetState();
+
     /*!
      * \brief Processes the input in the neural network.
      *
@@ -71,6 +99,16 @@ public:
      */
     void processInput(QList<double> input);
 
+    /*!
+     * \brief Processes the input in the neural network.
+     *
+     * This overload avoids creating a list for each input. The result of the processing can be retrieved using getNeuronOutput or getOutputs.
+     *
+     * \param input Pointer to the input values. Must hold 'len_input' values
+     * \param length Number of input values. Must be 'len_input'
+     */
+    void processInput(const double *input, qint32 length);
+
     /*!
      * \brief Gets the output of the last 'processInput' call.
      *
@@ -81,6 +119,33 @@ public:
      */
     double getNeuronOutput(qint32 i);
 
+    /*!
+     * \brief Gets the output of all output neurons of the last 'processInput' call.
+     *
+     * The result is the same as calling getNeuronOutput for all output neurons.
+     *
+     * \param output Pointer to which the output is written. Must have space for 'len_output' values
+     */
+    void getOutputs(double *output);
+
+    /*!
+     * \brief Returns the length of the input
+     * \return Length of input
+     */
+    inline qint32 lenInput() const
+    {
+        return _len_input;
+    }
+
+    /*!
+     * \brief Returns the length of the output
+     * \return Length of output
+     */
+    inline qint32 lenOutput() const
+    {
+        return _len_output;
+    }
+
     /*!
      * \brief Saves the internal configuration of the network.
      *
@@ -116,18 +181,28 @@ protected:
      *
      * This method is the method where subclasses should implement their initialisation.
      * _gene is guaranteed to be valid.
+     *
+     * This method might be called multiple times (see reinitialise). Subclasses must reuse or free the buffers of the previous initialisation.
      */
     virtual void _initialise() = 0;
 
+    /*!
+     * \brief Resets the dynamic state of the network
+     *
+     * This method is the method where subclasses should reset all values changed by processing input.
+     * _gene is guaranteed to be valid and the network is guaranteed to be initialised.
+     */
+    virtual void _resetState() = 0;
+
     /*!
      * \brief Processes the input in the neural network.
      *
      * This method is the method where subclasses should implement their processing.
      * _gene is guaranteed to be valid.
      *
-     * \param input Input to process
+     * \param input Input to process. Holds exactly 'len_input' values
      */
-    virtual void _processInput(QList<double> input) = 0;
+    virtual void _processInput(const double *input) = 0;
 
     /*!
      * \brief Gets the output of the last 'processInput' call.
@@ -140,6 +215,16 @@ protected:
      */
     virtual double _getNeuronOutput(qint32 i) = 0;
 
+    /*!
+     * \brief Gets the output of all output neurons of the last 'processInput' call.
+     *
+     * This method is the method where subclasses should implement their bulk output method.
+     * _gene is guaranteed to be valid.
+     *
+     * \param output Pointer to which the output is written. Has space for 'len_output' values
+     */
+    virtual void _getOutputs(double *output) = 0;
+
     /*!
      * \brief  Saves the internal configuration of the network.
      *
@@ -162,9 +247,14 @@ protected:
     qint32 _len_output;
 
     /*!
-     * \brief Contains a deep copy of the gene.
+     * \brief Contains a deep copy of the gene (or the gene passed to reinitialiseShared).
      */
     GenericGene *_gene;
+
+    /*!
+     * \brief True if _gene is owned by the caller of reinitialiseShared and must not be deleted by the network
+     */
+    bool _shared_gene;
 };
 
 #endif // ABSTRACTNEURALNETWORK_H
@@ -92,4 +92,62 @@ double cut01(double d)
     }
     return d;
 }
+
+QVector<qint32> liveNeurons(qint32 size, qint32 len_output, const QVector<qint32> &dependency_source, const QVector<qint32> &dependency_target)
+{
+    if(Q_UNLIKELY(dependency_source.size() != dependency_target.size()))
+    {
+        QNN_FATAL_MSG("Dependency lists must have the same length");
+    }
+
+    // Sort the dependencies by target so that the influencing neurons can be found
+    QVector<qint32> start(size + 1, 0);
+    for(qint32 i = 0; i < dependency_target.size(); ++i)
+    {
+        ++start[dependency_target[i]+1];
+    }
+    for(qint32 i = 0; i < size; ++i)
+    {
+        start[i+1] += start[i];
+    }
+    QVector<qint32> source(dependency_source.size());
+    QVector<qint32> insert_position(start);
+    for(qint32 i = 0; i < dependency_target.size(); ++i)
+    {
+        source[insert_position[dependency_target[i]]++] = dependency_source[i];
+    }
+
+    // Search backwards from the outputs
+    QVector<bool> live(size, false);
+    QVector<qint32> open;
+    open.reserve(size);
+    for(qint32 i = 0; i < len_output && i < size; ++i)
+    {
+        live[i] = true;
+        open.append(i);
+    }
+    while(!open.isEmpty())
+    {
+        qint32 neuron = open.last();
+        open.removeLast();
+        for(qint32 i = start[neuron]; i < start[neuron+1]; ++i)
+        {
+            if(!live[source[i]])
+            {
+                live[source[i]] = true;
+                open.append(source[i]);
+            }
+        }
+    }
+
+    QVector<qint32> neurons;
+    for(qint32 i = 0; i < size; ++i)
+    {
+        if(live[i])
+        {
+            neurons.append(i);
+        }
+    }
+    return neurons;
+}
 }
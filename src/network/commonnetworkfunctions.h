@@ -21,6 +21,8 @@
 
 #include <qnn-global.h>
 
+#include <QVector>
+
 /*!
  * \brief This namespace contains some functions which are commonly used by networks.
  */
@@ -87,6 +89,19 @@ bool areNodesConnected(double x_source, double y_source, double x_target, double
  * \return Cutted value
  */
 double cut01(double d);
+
+/*!
+ * \brief Finds all neurons which can influence the output of a network
+ *
+ * A neuron is live if it is an output neuron or if it influences a live neuron. The output neurons are the first len_output neurons.
+ *
+ * \param size Number of neurons
+ * \param len_output Number of output neurons
+ * \param dependency_source Neuron which influences the neuron in dependency_target at the same position
+ * \param dependency_target Neuron which is influenced by the neuron in dependency_source at the same position
+ * \return All live neurons in ascending order
+ */
+QVector<qint32> liveNeurons(qint32 size, qint32 len_output, const QVector<qint32> &dependency_source, const QVector<qint32> &dependency_target);
 }
 
 #endif // COMMONNETWORKFUNCTIONS_H
@@ -21,6 +21,7 @@
 #include "commonnetworkfunctions.h"
 #include "lengthchanginggene.h"
 #include "networktoxml.h"
+#include "vectorfunctions.h"
 
 #include <math.h>
 
@@ -30,15 +31,30 @@
 
 using CommonNetworkFunctions::sigmoid;
 using CommonNetworkFunctions::weight;
+using CommonNetworkFunctions::liveNeurons;
 
 using NetworkToXML::writeConfigStart;
 using NetworkToXML::writeConfigNeuron;
 using NetworkToXML::writeConfigEnd;
 
+using VectorFunctions::paddedLength;
+using VectorFunctions::allocateDoubles;
+using VectorFunctions::freeDoubles;
+using VectorFunctions::matrixVectorAccumulate;
+
 ContinuousTimeRecurrenNeuralNetwork::ContinuousTimeRecurrenNeuralNetwork(qint32 len_input, qint32 len_output, config config) :
     AbstractNeuralNetwork(len_input, len_output),
     _config(config),
-    _network(NULL)
+    _network(NULL),
+    _network_size(0),
+    _stride(0),
+    _weights(NULL),
+    _bias(NULL),
+    _time_constant(NULL),
+    _input(NULL),
+    _activation(NULL),
+    _new_network(NULL),
+    _neuron_ids()
 {
     if(Q_UNLIKELY(_config.network_default_size_grow <= 0))
     {
@@ -73,13 +89,22 @@ ContinuousTimeRecurrenNeuralNetwork::ContinuousTimeRecurrenNeuralNetwork(qint32
 ContinuousTimeRecurrenNeuralNetwork::ContinuousTimeRecurrenNeuralNetwork() :
     AbstractNeuralNetwork(),
     _config(),
-    _network(NULL)
+    _network(NULL),
+    _network_size(0),
+    _stride(0),
+    _weights(NULL),
+    _bias(NULL),
+    _time_constant(NULL),
+    _input(NULL),
+    _activation(NULL),
+    _new_network(NULL),
+    _neuron_ids()
 {
 }
 
 ContinuousTimeRecurrenNeuralNetwork::~ContinuousTimeRecurrenNeuralNetwork()
 {
-    delete [] _network;
+    deleteBuffers();
     if(_config.neuron_save != NULL && _config.neuron_save_opened)
     {
         _config.neuron_save->close();
@@ -108,19 +133,71 @@ AbstractNeuralNetwork *ContinuousTimeRecurrenNeuralNetwork::createConfigCopy()
 
 void ContinuousTimeRecurrenNeuralNetwork::_initialise()
 {
-    if(Q_UNLIKELY(_gene->segments().size() < _config.size_network || _gene->segments()[0].size() < (3 + _config.size_network)))
+    if(Q_UNLIKELY(_gene->numSegments() < _config.size_network || _gene->segmentSize() < (3 + _config.size_network)))
     {
         QNN_FATAL_MSG("Gene lenght does not fit");
     }
-    if(Q_UNLIKELY(_config.size_changing && _gene->segments()[0].size() < (3 + _config.max_size_network)))
+    if(Q_UNLIKELY(_config.size_changing && _gene->segmentSize() < (3 + _config.max_size_network)))
     {
         QNN_FATAL_MSG("Gene lenght does not fit max_size_network");
     }
-    _network = new double[_gene->segments().size()];
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+
+    // Select the simulated neurons
+    qint32 size = _gene->numSegments();
+    if(_config.prune_neurons)
     {
-        _network[i] = 0;
+        QVector<qint32> dependency_source;
+        QVector<qint32> dependency_target;
+        for(qint32 i = 0; i < size; ++i)
+        {
+            for(qint32 j = 0; j < size; ++j)
+            {
+                if(weight(_gene->segment(i)[gene_W_start+j], _config.weight_scalar) != 0.0)
+                {
+                    dependency_source.append(j);
+                    dependency_target.append(i);
+                }
+            }
+        }
+        _neuron_ids = liveNeurons(size, _len_output, dependency_source, dependency_target);
     }
+    else
+    {
+        _neuron_ids.resize(size);
+        for(qint32 i = 0; i < size; ++i)
+        {
+            _neuron_ids[i] = i;
+        }
+    }
+
+    // Reuse the buffers of a previous initialisation if possible
+    if(_network == NULL || _network_size != _neuron_ids.size())
+    {
+        deleteBuffers();
+        _network_size = _neuron_ids.size();
+        _stride = paddedLength(_network_size);
+        _network = allocateDoubles(_network_size);
+        _new_network = allocateDoubles(_network_size);
+        _activation = allocateDoubles(_network_size);
+        _weights = allocateDoubles(_stride * _network_size);
+        _bias = new double[_network_size];
+        _time_constant = new double[_network_size];
+        _input = new qint32[_network_size];
+    }
+
+    // Decode the gene
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        const qint32 *segment = _gene->segment(_neuron_ids[i]);
+        _bias[i] = weight(segment[gene_bias], _config.bias_scalar);
+        _time_constant[i] = (segment[gene_time_constraint]%_config.max_time_constant)+1;
+        _input[i] = segment[gene_input]%(_len_input+1)-1;
+        for(qint32 j = 0; j < _network_size; ++j)
+        {
+            _weights[j * _stride + i] = weight(segment[gene_W_start+_neuron_ids[j]], _config.weight_scalar);
+        }
+    }
+    _resetState();
 
     // Prepare output
     if(_config.neuron_save != NULL)
@@ -139,60 +216,66 @@ void ContinuousTimeRecurrenNeuralNetwork::_initialise()
                 _config.neuron_save_opened = true;
             }
         }
-        else
-        {
-            _config.neuron_save_opened = false;
-        }
         if(_config.neuron_save != NULL)
         {
             // write header
             QTextStream stream(_config.neuron_save);
-            stream << "Neuron 0";
-            for(qint32 i = 1; i < _gene->segments().size(); ++i)
+            stream << "Neuron " << _neuron_ids[0];
+            for(qint32 i = 1; i < _network_size; ++i)
             {
                 stream << ";";
-                stream << "Neuron " << i;
+                stream << "Neuron " << _neuron_ids[i];
             }
             stream << "\n";
         }
     }
 }
 
-void ContinuousTimeRecurrenNeuralNetwork::_processInput(QList<double> input)
+void ContinuousTimeRecurrenNeuralNetwork::_resetState()
 {
-    double *newNetwork = new double[_gene->segments().size()];
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _network[i] = 0;
+    }
+}
 
-    // do calculation
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+void ContinuousTimeRecurrenNeuralNetwork::_processInput(const double *input)
+{
+    // σ(θj + yj) is the same for all neurons, so it is calculated once per step
+    for(qint32 j = 0; j < _network_size; ++j)
     {
-        double newValue = -1 * _network[i]; // -y
+        _activation[j] = _config.activision_function(_bias[j] + _network[j]);
+    }
 
-        if(_gene->segments()[i][gene_input]%(_len_input+1) != 0)
+    // -y + input
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _new_network[i] = -1 * _network[i];
+        if(_input[i] != -1)
         {
-            newValue += input[_gene->segments()[i][gene_input]%(_len_input+1)-1];; // input
+            _new_network[i] += input[_input[i]];
         }
+    }
 
-        for(qint32 j = 0; j < _gene->segments().size(); ++j)
-        {
-            double d = 0.0;
-            d += weight(_gene->segments()[j][gene_bias], _config.bias_scalar); // θj
-            d += _network[j]; // yj
-            d = _config.activision_function(d);
-            newValue += d * weight(_gene->segments()[i][gene_W_start+j], _config.weight_scalar); // wij
-        }
-        newNetwork[i] = newValue / ((_gene->segments()[i][gene_time_constraint]%_config.max_time_constant)+1); // τ
-        newNetwork[i] += _network[i];
+    // + Σ wij σ(θj + yj)
+    matrixVectorAccumulate(_weights, _stride, _network_size, _network_size, _activation, _new_network);
+
+    // τ
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _new_network[i] = _new_network[i] / _time_constant[i] + _network[i];
     }
 
-    delete [] _network;
-    _network = newNetwork;
+    double *swap = _network;
+    _network = _new_network;
+    _new_network = swap;
 
     // write output
     if(_config.neuron_save != NULL)
     {
         QTextStream stream(_config.neuron_save);
         stream << _network[0];
-        for(qint32 i = 1; i < _gene->segments().size(); ++i)
+        for(qint32 i = 1; i < _network_size; ++i)
         {
             stream << ";";
             stream << _network[i];
@@ -205,7 +288,7 @@ double ContinuousTimeRecurrenNeuralNetwork::_getNeuronOutput(qint32 i)
 {
     if(Q_LIKELY(_network != NULL && i < _len_output))
     {
-        return _config.activision_function(_network[i] + weight(_gene->segments()[i][gene_bias], _config.bias_scalar));
+        return _config.activision_function(_network[i] + _bias[i]);
     }
     else
     {
@@ -214,6 +297,14 @@ double ContinuousTimeRecurrenNeuralNetwork::_getNeuronOutput(qint32 i)
     }
 }
 
+void ContinuousTimeRecurrenNeuralNetwork::_getOutputs(double *output)
+{
+    for(qint32 i = 0; i < _len_output; ++i)
+    {
+        output[i] = _config.activision_function(_network[i] + _bias[i]);
+    }
+}
+
 bool ContinuousTimeRecurrenNeuralNetwork::_saveNetworkConfig(QXmlStreamWriter *stream)
 {
     QMap<QString, QVariant> config_network;
@@ -224,38 +315,57 @@ bool ContinuousTimeRecurrenNeuralNetwork::_saveNetworkConfig(QXmlStreamWriter *s
     config_network["weight_scalar"] = _config.weight_scalar;
     config_network["bias_scalar"] = _config.bias_scalar;
     config_network["network_default_size_grow"] = _config.network_default_size_grow;
+    config_network["prune_neurons"] = _config.prune_neurons;
     config_network["activision_function"] = _config.activision_function == &standard_activision_function ? "standard" : "non-standard";
     config_network["len_input"] = _len_input;
     config_network["len_output"] = _len_output;
 
     writeConfigStart("ContinuousTimeRecurrenNeuralNetwork", config_network, stream);
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
         QMap<QString, QVariant> config_neuron;
         QMap<qint32, double> connection_neuron;
 
         config_neuron["qint32ernal_value"] = _network[i];
-        config_neuron["bias"] = weight(_gene->segments()[i][gene_bias], _config.bias_scalar);
-        config_neuron["time_constant"] = (_gene->segments()[i][gene_time_constraint]%_config.max_time_constant)+1;
+        config_neuron["bias"] = weight(_gene->segment(_neuron_ids[i])[gene_bias], _config.bias_scalar);
+        config_neuron["time_constant"] = (_gene->segment(_neuron_ids[i])[gene_time_constraint]%_config.max_time_constant)+1;
 
-        if(_gene->segments()[i][gene_input]%(_len_input+1) != 0)
+        if(_gene->segment(_neuron_ids[i])[gene_input]%(_len_input+1) != 0)
         {
-            config_neuron["input"] =_gene->segments()[i][gene_input]%(_len_input+1)-1;
+            config_neuron["input"] =_gene->segment(_neuron_ids[i])[gene_input]%(_len_input+1)-1;
         }
 
-        for(qint32 j = 0; j < _gene->segments().size(); ++j)
+        for(qint32 j = 0; j < _network_size; ++j)
         {
-            connection_neuron[j] = weight(_gene->segments()[i][gene_W_start+j], _config.weight_scalar);
+            connection_neuron[_neuron_ids[j]] = weight(_gene->segment(_neuron_ids[i])[gene_W_start+_neuron_ids[j]], _config.weight_scalar);
         }
 
-        writeConfigNeuron(i, config_neuron, connection_neuron, stream);
+        writeConfigNeuron(_neuron_ids[i], config_neuron, connection_neuron, stream);
     }
 
     writeConfigEnd(stream);
     return true;
 }
 
+void ContinuousTimeRecurrenNeuralNetwork::deleteBuffers()
+{
+    freeDoubles(_network);
+    _network = NULL;
+    freeDoubles(_new_network);
+    _new_network = NULL;
+    freeDoubles(_activation);
+    _activation = NULL;
+    freeDoubles(_weights);
+    _weights = NULL;
+    delete [] _bias;
+    _bias = NULL;
+    delete [] _time_constant;
+    _time_constant = NULL;
+    delete [] _input;
+    _input = NULL;
+}
+
 double ContinuousTimeRecurrenNeuralNetwork::standard_activision_function(double input)
 {
     return sigmoid(input);
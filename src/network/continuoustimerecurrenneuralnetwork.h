@@ -23,6 +23,8 @@
 
 #include "abstractneuralnetwork.h"
 
+#include <QVector>
+
 /*!
  * \brief The ContinuousTimeRecurrenNeuralNetwork class implements a continuous-time recurren neural network.
  *
@@ -88,6 +90,13 @@ public:
          * \brief activision_function holds the activation function used by the CTRNN
          */
         double (*activision_function)(double);
+        /*!
+         * \brief If prune_neurons is true only neurons which can influence the output are simulated.
+         *
+         * Pruning does not change the output of the network. As most connections have a weight different from 0, only few neurons can be pruned in most networks.
+         * Traces and saved configurations only contain the simulated neurons, identified by their position in the gene.
+         */
+        bool prune_neurons;
 
         /*!
          * \brief If neuron_save is not NULL the value of the neurons will be saved to the QIODevice
@@ -116,6 +125,7 @@ public:
             bias_scalar(5),
             network_default_size_grow(7),
             activision_function(&standard_activision_function),
+            prune_neurons(false),
             neuron_save(NULL),
             neuron_save_opened(false)
         {
@@ -168,11 +178,16 @@ protected:
      */
     void _initialise();
 
+    /*!
+     * \brief Overwritten function to reset the dynamic state of the network.
+     */
+    void _resetState();
+
     /*!
      * \brief Overwritten method to process input
      * \param input Input to process
      */
-    void _processInput(QList<double> input);
+    void _processInput(const double *input);
 
     /*!
      * \brief Overwritten function to get output
@@ -181,6 +196,12 @@ protected:
      */
     double _getNeuronOutput(qint32 i);
 
+    /*!
+     * \brief Overwritten function to get the output of all output neurons
+     * \param output Pointer to which the output is written
+     */
+    void _getOutputs(double *output);
+
     /*!
      * \brief Overwritten function to save network config
      * \param stream Stream to save config to. Stream is guaranteed to be a valid pointer
@@ -188,6 +209,11 @@ protected:
      */
     bool _saveNetworkConfig(QXmlStreamWriter *stream);
 
+    /*!
+     * \brief Frees all buffers allocated in _initialise.
+     */
+    void deleteBuffers();
+
 private:
     /*!
      * \brief Configuration of the CTRNN
@@ -198,6 +224,54 @@ private:
      * \brief This pointer containes the network
      */
     double *_network;
+
+    /*!
+     * \brief Number of simulated neurons _network has been allocated for
+     */
+    qint32 _network_size;
+
+    /*!
+     * \brief Distance between two columns of _weights
+     */
+    qint32 _stride;
+
+    /*!
+     * \brief Decoded column-major weight matrix. Column j contains the weights of all connections from neuron j
+     */
+    double *_weights;
+
+    /*!
+     * \brief Decoded bias of all neurons
+     */
+    double *_bias;
+
+    /*!
+     * \brief Decoded time constant of all neurons
+     */
+    double *_time_constant;
+
+    /*!
+     * \brief Decoded input of all neurons. -1 if the neuron gets no input
+     */
+    qint32 *_input;
+
+    /*!
+     * \brief Buffer for the activation of all neurons
+     */
+    double *_activation;
+
+    /*!
+     * \brief Buffer for the next state of the network. Swapped with _network after each step
+     */
+    double *_new_network;
+
+    /*!
+     * \brief Position in the gene of each simulated neuron.
+     *
+     * All other members use the index of the simulated neuron. Without pruning all neurons are simulated in gene order.
+     * The output neurons are always the first simulated neurons.
+     */
+    QVector<qint32> _neuron_ids;
 };
 
 #endif // CONTINUOUSTIMERECURRENNEURALNETWORK_H
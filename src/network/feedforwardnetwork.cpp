@@ -19,7 +19,9 @@
 #include "feedforwardnetwork.h"
 
 #include "commonnetworkfunctions.h"
+#include "feedforwardnetworkensemble.h"
 #include "networktoxml.h"
+#include "vectorfunctions.h"
 
 #include <QtCore/qmath.h>
 
@@ -30,9 +32,35 @@ using NetworkToXML::writeConfigStart;
 using NetworkToXML::writeConfigNeuron;
 using NetworkToXML::writeConfigEnd;
 
+using VectorFunctions::paddedLength;
+using VectorFunctions::allocateDoubles;
+using VectorFunctions::freeDoubles;
+using VectorFunctions::allocateFloats;
+using VectorFunctions::freeFloats;
+using VectorFunctions::matrixVectorProduct;
+using VectorFunctions::matrixMatrixProduct;
+using VectorFunctions::quantizedMatrixVectorProduct;
+using VectorFunctions::quantize;
+using VectorFunctions::FLOAT_LANES;
+
+namespace {
+/*!
+ * \brief Number of samples processed together by processBatch. Chosen so that the intermediate results stay in the cache
+ */
+static const qint32 BATCH_BLOCK_SIZE = 64;
+}
+
 FeedForwardNetwork::FeedForwardNetwork(qint32 len_input, qint32 len_output, config config) :
     AbstractNeuralNetwork(len_input, len_output),
     _config(config),
+    _layers(),
+    _weights(NULL),
+    _float_weights(NULL),
+    _int8_weights(),
+    _int8_scale(),
+    _float_input(NULL),
+    _float_output(NULL),
+    _int8_input(),
     _hidden_layers(NULL),
     _output(NULL)
 {
@@ -41,6 +69,14 @@ FeedForwardNetwork::FeedForwardNetwork(qint32 len_input, qint32 len_output, conf
 FeedForwardNetwork::FeedForwardNetwork() :
     AbstractNeuralNetwork(),
     _config(),
+    _layers(),
+    _weights(NULL),
+    _float_weights(NULL),
+    _int8_weights(),
+    _int8_scale(),
+    _float_input(NULL),
+    _float_output(NULL),
+    _int8_input(),
     _hidden_layers(NULL),
     _output(NULL)
 {
@@ -52,16 +88,20 @@ FeedForwardNetwork::~FeedForwardNetwork()
     {
         for(qint32 i = 0; i < _config.num_hidden_layer; ++i)
         {
-            delete [] _hidden_layers[i];
+            freeDoubles(_hidden_layers[i]);
         }
         delete [] _hidden_layers;
     }
-    delete [] _output;
+    freeDoubles(_output);
+    freeDoubles(_weights);
+    freeFloats(_float_weights);
+    freeFloats(_float_input);
+    freeFloats(_float_output);
 }
 
 void FeedForwardNetwork::_initialise()
 {
-    if(Q_UNLIKELY(_gene->segments().size() < num_segments(_len_input, _len_output, _config.num_hidden_layer, _config.len_hidden)))
+    if(Q_UNLIKELY(_gene->numSegments() < num_segments(_len_input, _len_output, _config.num_hidden_layer, _config.len_hidden)))
     {
         QNN_FATAL_MSG("Wrong gene length");
     }
@@ -70,76 +110,315 @@ void FeedForwardNetwork::_initialise()
         QNN_FATAL_MSG("Invalid hidden layer size");
     }
 
-    if(_config.len_hidden > 0)
+    // The size of the buffers only depends on the configuration, so they can be reused on reinitialisation
+    if(_weights == NULL)
+    {
+        QVector<qint32> sizes;
+        sizes << _len_input;
+        for(qint32 i = 0; i < _config.num_hidden_layer; ++i)
+        {
+            sizes << _config.len_hidden;
+        }
+        sizes << _len_output;
+
+        qint32 size = 0;
+        for(qint32 i = 1; i < sizes.size(); ++i)
+        {
+            size += paddedLength(sizes[i]) * (sizes[i-1] + 1);
+        }
+        _weights = allocateDoubles(size);
+
+        qint32 float_size = 0;
+        qint32 int8_size = 0;
+        qint32 max_columns = 0;
+        qint32 max_float_stride = 0;
+        for(qint32 i = 1; i < sizes.size(); ++i)
+        {
+            float_size += paddedLength(sizes[i], FLOAT_LANES) * (sizes[i-1] + 1);
+            int8_size += sizes[i] * sizes[i-1];
+            max_columns = qMax(max_columns, sizes[i-1]);
+            max_float_stride = qMax(max_float_stride, paddedLength(sizes[i], FLOAT_LANES));
+        }
+        if(_config.precision == float_precision)
+        {
+            _float_weights = allocateFloats(float_size);
+            _float_input = allocateFloats(max_columns);
+            _float_output = allocateFloats(max_float_stride);
+        }
+        else if(_config.precision == int8_precision)
+        {
+            _int8_weights.resize(int8_size);
+            _int8_scale.resize(size);
+            _int8_input.resize(max_columns);
+        }
+
+        double *current = _weights;
+        float *current_float = _float_weights;
+        qint8 *current_int8 = _int8_weights.data();
+        double *current_scale = _int8_scale.data();
+        _layers.clear();
+        _layers.reserve(sizes.size() - 1);
+        for(qint32 i = 1; i < sizes.size(); ++i)
+        {
+            Layer layer;
+            layer.rows = sizes[i];
+            layer.columns = sizes[i-1];
+            layer.stride = paddedLength(layer.rows);
+            layer.weights = current;
+            layer.bias = current + layer.stride * layer.columns;
+            current = layer.bias + layer.stride;
+
+            layer.float_stride = paddedLength(layer.rows, FLOAT_LANES);
+            layer.float_weights = NULL;
+            layer.float_bias = NULL;
+            layer.int8_weights = NULL;
+            layer.int8_scale = NULL;
+            if(_config.precision == float_precision)
+            {
+                layer.float_weights = current_float;
+                layer.float_bias = current_float + layer.float_stride * layer.columns;
+                current_float = layer.float_bias + layer.float_stride;
+            }
+            else if(_config.precision == int8_precision)
+            {
+                layer.int8_weights = current_int8;
+                layer.int8_scale = current_scale;
+                current_int8 += layer.rows * layer.columns;
+                current_scale += layer.rows;
+            }
+            _layers << layer;
+        }
+    }
+    if(_config.num_hidden_layer > 0 && _hidden_layers == NULL)
     {
         _hidden_layers = new double*[_config.num_hidden_layer];
         for(qint32 i = 0; i < _config.num_hidden_layer; ++i)
         {
-            _hidden_layers[i] = new double[_config.len_hidden];
+            _hidden_layers[i] = allocateDoubles(_config.len_hidden);
         }
     }
-    _output = new double[_len_output];
+    if(_output == NULL)
+    {
+        _output = allocateDoubles(_len_output);
+    }
+    decodeWeights();
+    _resetState();
 }
 
-void FeedForwardNetwork::_processInput(QList<double> input)
+void FeedForwardNetwork::decodeWeights()
 {
-    if(_config.num_hidden_layer == 0)
+    // The gene contains the incoming weights of each neuron followed by its bias, layer by layer
+    qint32 current_segment = 0;
+    for(QVector<Layer>::iterator layer = _layers.begin(); layer != _layers.end(); ++layer)
     {
-        qint32 current_segment = 0;
-        for(qint32 i_output = 0; i_output < _len_output; ++i_output)
+        for(qint32 row = 0; row < layer->rows; ++row)
         {
-            double sum = 0.0;
-            for(qint32 i_input = 0; i_input < _len_input; ++i_input)
+            for(qint32 column = 0; column < layer->columns; ++column)
             {
-                sum += input[i_input] * weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
+                layer->weights[column * layer->stride + row] = weight(_gene->segment(current_segment++)[0], _config.weight_scalar);
+            }
+            layer->bias[row] = weight(_gene->segment(current_segment++)[0], _config.weight_scalar);
+        }
+
+        // Reduced precision weights are derived from the double weights
+        if(_config.precision == float_precision)
+        {
+            for(qint32 row = 0; row < layer->rows; ++row)
+            {
+                for(qint32 column = 0; column < layer->columns; ++column)
+                {
+                    layer->float_weights[column * layer->float_stride + row] = float(layer->weights[column * layer->stride + row]);
+                }
+                layer->float_bias[row] = float(layer->bias[row]);
+            }
+        }
+        else if(_config.precision == int8_precision)
+        {
+            QVector<double> row_weights(layer->columns);
+            for(qint32 row = 0; row < layer->rows; ++row)
+            {
+                for(qint32 column = 0; column < layer->columns; ++column)
+                {
+                    row_weights[column] = layer->weights[column * layer->stride + row];
+                }
+                layer->int8_scale[row] = quantize(row_weights.constData(), layer->columns, layer->int8_weights + row * layer->columns);
             }
-            sum += 1.0 * weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
-            _output[i_output] = _config.activision_function(sum);
         }
     }
-    else
+}
+
+void FeedForwardNetwork::_resetState()
+{
+    for(qint32 i = 0; i < _config.num_hidden_layer && _config.len_hidden > 0; ++i)
     {
-        qint32 current_segment = 0;
+        for(qint32 j = 0; j < _config.len_hidden; ++j)
+        {
+            _hidden_layers[i][j] = 0;
+        }
+    }
+    for(qint32 i = 0; i < _len_output; ++i)
+    {
+        _output[i] = 0;
+    }
+}
 
-        // Input to hidden
-        for(qint32 i_hidden = 0; i_hidden < _config.len_hidden; ++i_hidden)
+void FeedForwardNetwork::_processInput(const double *input)
+{
+    runLayers(input, _config.precision);
+}
+
+void FeedForwardNetwork::runLayers(const double *input, Precision precision)
+{
+    const double *current_input = input;
+    for(qint32 i = 0; i < _layers.size(); ++i)
+    {
+        const Layer &layer = _layers[i];
+        double *current_output = i < _config.num_hidden_layer ? _hidden_layers[i] : _output;
+
+        switch(precision)
         {
-            double sum = 0.0;
-            for(qint32 i_input = 0; i_input < _len_input; ++i_input)
+        case float_precision:
+            for(qint32 j = 0; j < layer.columns; ++j)
+            {
+                _float_input[j] = float(current_input[j]);
+            }
+            matrixVectorProduct(layer.float_weights, layer.float_stride, layer.rows, layer.columns, _float_input, layer.float_bias, _float_output);
+            for(qint32 j = 0; j < layer.rows; ++j)
             {
-                sum += input[i_input] * weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
+                current_output[j] = _float_output[j];
             }
-            sum += 1.0 * weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
-            _hidden_layers[0][i_hidden] = _config.activision_function(sum);
+            break;
+
+        case int8_precision:
+        {
+            double input_scale = quantize(current_input, layer.columns, _int8_input.data());
+            quantizedMatrixVectorProduct(layer.int8_weights, layer.int8_scale, layer.rows, layer.columns, _int8_input.constData(), input_scale, layer.bias, current_output);
+            break;
         }
 
-        // Hidden to hidden
-        for(qint32 current_hidden = 1; current_hidden < _config.num_hidden_layer; ++current_hidden)
+        case double_precision:
+        default:
+            matrixVectorProduct(layer.weights, layer.stride, layer.rows, layer.columns, current_input, layer.bias, current_output);
+            break;
+        }
+
+        for(qint32 j = 0; j < layer.rows; ++j)
         {
-            for(qint32 i_output = 0; i_output < _config.len_hidden; ++i_output)
+            current_output[j] = _config.activision_function(current_output[j]);
+        }
+        current_input = current_output;
+    }
+}
+
+double FeedForwardNetwork::precisionError(const double *inputs, qint32 samples)
+{
+    if(Q_UNLIKELY(_gene == NULL))
+    {
+        QNN_FATAL_MSG("Network not initialised");
+    }
+    if(Q_UNLIKELY(inputs == NULL || samples < 0))
+    {
+        QNN_CRITICAL_MSG("Invalid samples");
+        return -1.0;
+    }
+
+    QVector<double> reference(_len_output);
+    double max_error = 0.0;
+    for(qint32 sample = 0; sample < samples; ++sample)
+    {
+        runLayers(inputs + sample * _len_input, double_precision);
+        for(qint32 i = 0; i < _len_output; ++i)
+        {
+            reference[i] = _output[i];
+        }
+        runLayers(inputs + sample * _len_input, _config.precision);
+        for(qint32 i = 0; i < _len_output; ++i)
+        {
+            max_error = qMax(max_error, qAbs(_output[i] - reference[i]));
+        }
+    }
+    _resetState();
+    return max_error;
+}
+
+void FeedForwardNetwork::processBatch(const double *inputs, qint32 samples, double *outputs)
+{
+    if(Q_UNLIKELY(_gene == NULL))
+    {
+        QNN_FATAL_MSG("Network not initialised");
+    }
+    if(Q_UNLIKELY(inputs == NULL || outputs == NULL || samples < 0))
+    {
+        QNN_CRITICAL_MSG("Invalid batch");
+        return;
+    }
+
+    if(_config.precision != double_precision)
+    {
+        // Reduced precision is calculated sample by sample
+        QVector<double> saved_output(_len_output);
+        for(qint32 i = 0; i < _len_output; ++i)
+        {
+            saved_output[i] = _output[i];
+        }
+        for(qint32 sample = 0; sample < samples; ++sample)
+        {
+            runLayers(inputs + sample * _len_input, _config.precision);
+            for(qint32 i = 0; i < _len_output; ++i)
             {
-                double sum = 0.0;
-                for(qint32 i_input = 0; i_input < _config.len_hidden; ++i_input)
+                outputs[sample * _len_output + i] = _output[i];
+            }
+        }
+        for(qint32 i = 0; i < _len_output; ++i)
+        {
+            _output[i] = saved_output[i];
+        }
+        return;
+    }
+
+    qint32 max_stride = 0;
+    for(qint32 i = 0; i < _layers.size(); ++i)
+    {
+        max_stride = qMax(max_stride, _layers[i].stride);
+    }
+    double *buffer_a = allocateDoubles(BATCH_BLOCK_SIZE * max_stride);
+    double *buffer_b = allocateDoubles(BATCH_BLOCK_SIZE * max_stride);
+
+    for(qint32 first_sample = 0; first_sample < samples; first_sample += BATCH_BLOCK_SIZE)
+    {
+        qint32 block = qMin(BATCH_BLOCK_SIZE, samples - first_sample);
+        const double *current_input = inputs + first_sample * _len_input;
+        qint32 input_stride = _len_input;
+        double *current_output = buffer_a;
+
+        for(qint32 i = 0; i < _layers.size(); ++i)
+        {
+            const Layer &layer = _layers[i];
+            matrixMatrixProduct(layer.weights, layer.stride, layer.rows, layer.columns, current_input, input_stride, block, layer.bias, current_output);
+            for(qint32 sample = 0; sample < block; ++sample)
+            {
+                double *row = current_output + sample * layer.stride;
+                for(qint32 j = 0; j < layer.rows; ++j)
                 {
-                    sum += _hidden_layers[current_hidden-1][i_input] * weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
+                    row[j] = _config.activision_function(row[j]);
                 }
-                sum += 1.0 * weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
-                _hidden_layers[current_hidden][i_output] = _config.activision_function(sum);
             }
+            current_input = current_output;
+            input_stride = layer.stride;
+            current_output = current_output == buffer_a ? buffer_b : buffer_a;
         }
 
-        // Hidden to output
-        for(qint32 i_output = 0; i_output < _len_output; ++i_output)
+        for(qint32 sample = 0; sample < block; ++sample)
         {
-            double sum = 0.0;
-            for(qint32 i_hidden = 0; i_hidden < _config.len_hidden; ++i_hidden)
+            for(qint32 j = 0; j < _len_output; ++j)
             {
-                sum += _hidden_layers[_config.num_hidden_layer-1][i_hidden] * weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
+                outputs[(first_sample + sample) * _len_output + j] = current_input[sample * input_stride + j];
             }
-            sum += 1.0 * weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
-            _output[i_output] = _config.activision_function(sum);
         }
     }
+
+    freeDoubles(buffer_a);
+    freeDoubles(buffer_b);
 }
 
 double FeedForwardNetwork::_getNeuronOutput(qint32 i)
@@ -155,6 +434,14 @@ double FeedForwardNetwork::_getNeuronOutput(qint32 i)
     }
 }
 
+void FeedForwardNetwork::_getOutputs(double *output)
+{
+    for(qint32 i = 0; i < _len_output; ++i)
+    {
+        output[i] = _output[i];
+    }
+}
+
 bool FeedForwardNetwork::_saveNetworkConfig(QXmlStreamWriter *stream)
 {
     QMap<QString, QVariant> config_network;
@@ -162,6 +449,7 @@ bool FeedForwardNetwork::_saveNetworkConfig(QXmlStreamWriter *stream)
     config_network["len_hidden"] = _config.len_hidden;
     config_network["activision_function"] = _config.activision_function == &standard_activision_function ? "standard" : "non-standard";
     config_network["weight_scalar"] = _config.weight_scalar;
+    config_network["precision"] = _config.precision == float_precision ? "float" : _config.precision == int8_precision ? "int8" : "double";
     config_network["len_input"] = _len_input;
     config_network["len_output"] = _len_output;
 
@@ -184,7 +472,7 @@ bool FeedForwardNetwork::_saveNetworkConfig(QXmlStreamWriter *stream)
             QMap<qint32, double> connections_neuron;
             for(qint32 i_input = 0; i_input < _len_input; ++i_input)
             {
-                connections_neuron[i_input] = weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
+                connections_neuron[i_input] = weight(_gene->segment(current_segment++)[0], _config.weight_scalar);
             }
             writeConfigNeuron(_len_input+i_output, config_neuron, connections_neuron, stream);
         }
@@ -200,7 +488,7 @@ bool FeedForwardNetwork::_saveNetworkConfig(QXmlStreamWriter *stream)
             QMap<qint32, double> connections_neuron;
             for(qint32 i_input = 0; i_input < _len_input; ++i_input)
             {
-                connections_neuron[i_input] = weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
+                connections_neuron[i_input] = weight(_gene->segment(current_segment++)[0], _config.weight_scalar);
             }
             writeConfigNeuron(_len_input+i_hidden, config_neuron, connections_neuron, stream);
         }
@@ -214,7 +502,7 @@ bool FeedForwardNetwork::_saveNetworkConfig(QXmlStreamWriter *stream)
                 QMap<qint32, double> connections_neuron;
                 for(qint32 i_input = 0; i_input < _config.len_hidden; ++i_input)
                 {
-                    connections_neuron[_config.len_hidden*(current_hidden-1)+_len_input+i_input] = weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
+                    connections_neuron[_config.len_hidden*(current_hidden-1)+_len_input+i_input] = weight(_gene->segment(current_segment++)[0], _config.weight_scalar);
                 }
                 writeConfigNeuron(_config.len_hidden*current_hidden+_len_input+i_output, config_neuron, connections_neuron, stream);
             }
@@ -227,7 +515,7 @@ bool FeedForwardNetwork::_saveNetworkConfig(QXmlStreamWriter *stream)
             QMap<qint32, double> connections_neuron;
             for(qint32 i_hidden = 0; i_hidden < _config.len_hidden; ++i_hidden)
             {
-                connections_neuron[_config.len_hidden*(_config.num_hidden_layer-1)+_len_input+i_hidden] = weight(_gene->segments()[current_segment++][0], _config.weight_scalar);
+                connections_neuron[_config.len_hidden*(_config.num_hidden_layer-1)+_len_input+i_hidden] = weight(_gene->segment(current_segment++)[0], _config.weight_scalar);
             }
             writeConfigNeuron(_config.len_hidden*_config.num_hidden_layer+_len_input+i_output, config_neuron, connections_neuron, stream);
         }
@@ -263,3 +551,8 @@ AbstractNeuralNetwork *FeedForwardNetwork::createConfigCopy()
 {
     return new FeedForwardNetwork(_len_input, _len_output, _config);
 }
+
+FeedForwardNetworkEnsemble *FeedForwardNetwork::createEnsemble(qint32 size)
+{
+    return new FeedForwardNetworkEnsemble(_len_input, _len_output, _config, size);
+}
@@ -23,10 +23,17 @@
 
 #include "abstractneuralnetwork.h"
 
+#include <QVector>
+
+class FeedForwardNetworkEnsemble;
+
 /*!
  * \brief The FeedForwardNetwork class represents a multi-layer feed forward network (multi-layer perceptron).
  *
  * This class may eighter have no hidden layers or a number of same-sized hidden layer.
+ *
+ * The weights are decoded from the gene once while initialising the network and stored as aligned matrices,
+ * so processing an input only consists of vectorized matrix-vector products (see VectorFunctions).
  */
 class QNNSHARED_EXPORT FeedForwardNetwork : public AbstractNeuralNetwork
 {
@@ -51,6 +58,27 @@ public:
      */
     static double standard_activision_function(double input);
 
+    /*!
+     * \brief Precision used to calculate the output of the network
+     */
+    enum Precision {
+        /*!
+         * \brief All calculations are done with double
+         */
+        double_precision,
+
+        /*!
+         * \brief The weights and the matrix-vector products use float. The activation function is calculated with double
+         */
+        float_precision,
+
+        /*!
+         * \brief The weights and the inputs of each layer are quantized to 8 bit integers, the products are accumulated as 32 bit integers.
+         * Bias and activation function are calculated with double
+         */
+        int8_precision
+    };
+
     /*!
      * \brief This struct contains all configuration option of FFNs
      */
@@ -73,6 +101,13 @@ public:
          * The weight will be in the range [-weight_scalar, weight_scalar]
          */
         double weight_scalar;
+        /*!
+         * \brief precision sets the precision used to calculate the network.
+         *
+         * Reduced precision needs less memory and allows more values per vector register, but the output differs slightly from double precision.
+         * Use precisionError to check if the precision is sufficient for a network.
+         */
+        Precision precision;
 
         /*!
          * \brief Constructor for standard values
@@ -81,7 +116,8 @@ public:
             num_hidden_layer(2),
             len_hidden(5),
             activision_function(&standard_activision_function),
-            weight_scalar(1.0)
+            weight_scalar(1.0),
+            precision(double_precision)
         {
         }
     };
@@ -111,17 +147,66 @@ public:
      */
     AbstractNeuralNetwork *createConfigCopy();
 
+    /*!
+     * \brief Processes a number of independent inputs at once.
+     *
+     * Each sample gives the same output as a call to processInput followed by getOutputs.
+     * The samples are processed in blocks, each layer is calculated as a matrix-matrix product for the whole block.
+     * With reduced precision the samples are processed one after another.
+     * The output of the network (getNeuronOutput / getOutputs) is not changed by this function.
+     *
+     * \param inputs Row-major input matrix with samples * len_input values
+     * \param samples Number of samples
+     * \param outputs Pointer to which the row-major output matrix with samples * len_output values is written
+     */
+    void processBatch(const double *inputs, qint32 samples, double *outputs);
+
+    /*!
+     * \brief Creates an uninitialised ensemble with the configuration of this network
+     * \param size Maximum number of individuals in the ensemble
+     * \return Ensemble. The caller must delete the ensemble
+     */
+    FeedForwardNetworkEnsemble *createEnsemble(qint32 size);
+
+    /*!
+     * \brief Returns the precision used to calculate the network
+     *
+     * Only networks with double precision can be run in a FeedForwardNetworkEnsemble without changing the outputs.
+     *
+     * \return Configured precision
+     */
+    inline Precision precision() const
+    {
+        return _config.precision;
+    }
+
+    /*!
+     * \brief Checks the agreement of the configured precision with double precision.
+     *
+     * All samples are calculated with both precisions. The state of the network is reset afterwards.
+     *
+     * \param inputs Row-major input matrix with samples * len_input values
+     * \param samples Number of samples
+     * \return Maximum absolute difference of an output between configured precision and double precision. -1 on error
+     */
+    double precisionError(const double *inputs, qint32 samples);
+
 protected:
     /*!
      * \brief Overwritten function to initialise the network.
      */
     void _initialise();
 
+    /*!
+     * \brief Overwritten function to reset the dynamic state of the network.
+     */
+    void _resetState();
+
     /*!
      * \brief Overwritten method to process input
      * \param input Input to process
      */
-    void _processInput(QList<double> input);
+    void _processInput(const double *input);
 
     /*!
      * \brief Overwritten function to get output
@@ -130,6 +215,12 @@ protected:
      */
     double _getNeuronOutput(qint32 i);
 
+    /*!
+     * \brief Overwritten function to get the output of all output neurons
+     * \param output Pointer to which the output is written
+     */
+    void _getOutputs(double *output);
+
     /*!
      * \brief Overwritten function to save network config
      * \param stream Stream to save config to. Stream is guaranteed to be a valid pointer
@@ -145,11 +236,118 @@ private:
      */
     FeedForwardNetwork();
 
+    /*!
+     * \brief Decodes the weights of all layers from the gene
+     */
+    void decodeWeights();
+
+    /*!
+     * \brief Calculates all layers for the input. The result is written to _hidden_layers and _output
+     * \param input Input to process
+     * \param precision Precision used for the calculation
+     */
+    void runLayers(const double *input, Precision precision);
+
+    /*!
+     * \brief A decoded layer of the FFN
+     */
+    struct Layer {
+        /*!
+         * \brief Number of neurons in the layer
+         */
+        qint32 rows;
+
+        /*!
+         * \brief Number of inputs of the layer
+         */
+        qint32 columns;
+
+        /*!
+         * \brief Distance between two columns in weights
+         */
+        qint32 stride;
+
+        /*!
+         * \brief Column-major weight matrix of the layer
+         */
+        double *weights;
+
+        /*!
+         * \brief Bias of all neurons of the layer
+         */
+        double *bias;
+
+        /*!
+         * \brief Distance between two columns in float_weights
+         */
+        qint32 float_stride;
+
+        /*!
+         * \brief Column-major weight matrix for float_precision
+         */
+        float *float_weights;
+
+        /*!
+         * \brief Bias for float_precision
+         */
+        float *float_bias;
+
+        /*!
+         * \brief Row-major quantized weight matrix for int8_precision
+         */
+        qint8 *int8_weights;
+
+        /*!
+         * \brief Scale of each row of int8_weights
+         */
+        double *int8_scale;
+    };
+
     /*!
      * \brief Configuration of the FFN
      */
     config _config;
 
+    /*!
+     * \brief Contains all layers from input to output
+     */
+    QVector<Layer> _layers;
+
+    /*!
+     * \brief Memory block holding the weights and bias of all layers
+     */
+    double *_weights;
+
+    /*!
+     * \brief Memory block holding the float weights and bias of all layers. NULL if not used
+     */
+    float *_float_weights;
+
+    /*!
+     * \brief Holds the quantized weights of all layers
+     */
+    QVector<qint8> _int8_weights;
+
+    /*!
+     * \brief Holds the scale of all rows of the quantized weights
+     */
+    QVector<double> _int8_scale;
+
+    /*!
+     * \brief Buffer for the input of a layer in float_precision
+     */
+    float *_float_input;
+
+    /*!
+     * \brief Buffer for the output of a layer in float_precision
+     */
+    float *_float_output;
+
+    /*!
+     * \brief Buffer for the quantized input of a layer in int8_precision
+     */
+    QVector<qint8> _int8_input;
+
     /*!
      * \brief Contains the hidden layers
      */
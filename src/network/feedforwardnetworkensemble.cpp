@@ -0,0 +1,248 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "feedforwardnetworkensemble.h"
+
+#include "commonnetworkfunctions.h"
+#include "vectorfunctions.h"
+
+using CommonNetworkFunctions::weight;
+
+using VectorFunctions::paddedLength;
+using VectorFunctions::allocateDoubles;
+using VectorFunctions::freeDoubles;
+using VectorFunctions::lanewiseMatrixVectorProduct;
+
+FeedForwardNetworkEnsemble::FeedForwardNetworkEnsemble(qint32 len_input, qint32 len_output, FeedForwardNetwork::config config, qint32 size) :
+    _len_input(len_input),
+    _len_output(len_output),
+    _config(config),
+    _size(size),
+    _individuals(0),
+    _lanes(paddedLength(size)),
+    _layers(),
+    _memory(NULL),
+    _input(NULL)
+{
+    if(Q_UNLIKELY(len_input <= 0 || len_output <= 0))
+    {
+        QNN_FATAL_MSG("Invalid input or output length");
+    }
+    if(Q_UNLIKELY(size <= 0))
+    {
+        QNN_FATAL_MSG("Size must be greater then 0");
+    }
+    if(Q_UNLIKELY(_config.len_hidden <= 0 || _config.num_hidden_layer < 0))
+    {
+        QNN_FATAL_MSG("Invalid hidden layer size");
+    }
+
+    QVector<qint32> sizes;
+    sizes << _len_input;
+    for(qint32 i = 0; i < _config.num_hidden_layer; ++i)
+    {
+        sizes << _config.len_hidden;
+    }
+    sizes << _len_output;
+
+    qint32 memory_size = 0;
+    for(qint32 i = 1; i < sizes.size(); ++i)
+    {
+        memory_size += sizes[i] * (sizes[i-1] + 2) * _lanes;
+    }
+    _memory = allocateDoubles(memory_size);
+    _input = allocateDoubles(_len_input * _lanes);
+
+    double *current = _memory;
+    _layers.reserve(sizes.size() - 1);
+    for(qint32 i = 1; i < sizes.size(); ++i)
+    {
+        Layer layer;
+        layer.rows = sizes[i];
+        layer.columns = sizes[i-1];
+        layer.weights = current;
+        layer.bias = layer.weights + layer.rows * layer.columns * _lanes;
+        layer.output = layer.bias + layer.rows * _lanes;
+        current = layer.output + layer.rows * _lanes;
+        _layers << layer;
+    }
+}
+
+FeedForwardNetworkEnsemble::FeedForwardNetworkEnsemble() :
+    _len_input(0),
+    _len_output(0),
+    _config(),
+    _size(0),
+    _individuals(0),
+    _lanes(0),
+    _layers(),
+    _memory(NULL),
+    _input(NULL)
+{
+}
+
+FeedForwardNetworkEnsemble::~FeedForwardNetworkEnsemble()
+{
+    freeDoubles(_memory);
+    freeDoubles(_input);
+}
+
+void FeedForwardNetworkEnsemble::initialise(QList<GenericGene *> genes)
+{
+    if(Q_UNLIKELY(genes.isEmpty() || genes.length() > _size))
+    {
+        QNN_FATAL_MSG("Invalid number of genes");
+    }
+
+    qint32 needed_segments = FeedForwardNetwork::num_segments(_len_input, _len_output, _config.num_hidden_layer, _config.len_hidden);
+    for(qint32 individual = 0; individual < genes.length(); ++individual)
+    {
+        GenericGene *gene = genes[individual];
+        if(Q_UNLIKELY(gene == NULL || gene->numSegments() < needed_segments))
+        {
+            QNN_FATAL_MSG("Wrong gene length");
+        }
+
+        // Same gene layout as FeedForwardNetwork
+        qint32 current_segment = 0;
+        for(QVector<Layer>::iterator layer = _layers.begin(); layer != _layers.end(); ++layer)
+        {
+            for(qint32 row = 0; row < layer->rows; ++row)
+            {
+                for(qint32 column = 0; column < layer->columns; ++column)
+                {
+                    layer->weights[(column * layer->rows + row) * _lanes + individual] = weight(gene->segment(current_segment++)[0], _config.weight_scalar);
+                }
+                layer->bias[row * _lanes + individual] = weight(gene->segment(current_segment++)[0], _config.weight_scalar);
+            }
+        }
+    }
+
+    // Unused lanes get zero weights
+    for(qint32 individual = genes.length(); individual < _individuals; ++individual)
+    {
+        for(QVector<Layer>::iterator layer = _layers.begin(); layer != _layers.end(); ++layer)
+        {
+            for(qint32 i = 0; i < layer->rows * layer->columns; ++i)
+            {
+                layer->weights[i * _lanes + individual] = 0.0;
+            }
+            for(qint32 i = 0; i < layer->rows; ++i)
+            {
+                layer->bias[i * _lanes + individual] = 0.0;
+            }
+        }
+    }
+
+    _individuals = genes.length();
+
+    for(QVector<Layer>::iterator layer = _layers.begin(); layer != _layers.end(); ++layer)
+    {
+        for(qint32 i = 0; i < layer->rows * _lanes; ++i)
+        {
+            layer->output[i] = 0.0;
+        }
+    }
+}
+
+void FeedForwardNetworkEnsemble::processInput(const double *input)
+{
+    if(Q_UNLIKELY(_individuals == 0))
+    {
+        QNN_FATAL_MSG("Ensemble not initialised");
+    }
+    if(Q_UNLIKELY(input == NULL))
+    {
+        QNN_FATAL_MSG("input is NULL");
+    }
+
+    for(qint32 individual = 0; individual < _individuals; ++individual)
+    {
+        for(qint32 i = 0; i < _len_input; ++i)
+        {
+            _input[i * _lanes + individual] = input[individual * _len_input + i];
+        }
+    }
+
+    const double *current_input = _input;
+    for(qint32 i = 0; i < _layers.size(); ++i)
+    {
+        const Layer &layer = _layers[i];
+        lanewiseMatrixVectorProduct(layer.weights, layer.rows, layer.columns, _lanes, current_input, layer.bias, layer.output);
+        for(qint32 row = 0; row < layer.rows; ++row)
+        {
+            double *output = layer.output + row * _lanes;
+            for(qint32 individual = 0; individual < _individuals; ++individual)
+            {
+                output[individual] = _config.activision_function(output[individual]);
+            }
+        }
+        current_input = layer.output;
+    }
+}
+
+void FeedForwardNetworkEnsemble::getOutputs(double *output)
+{
+    if(Q_UNLIKELY(output == NULL))
+    {
+        QNN_CRITICAL_MSG("output is NULL");
+        return;
+    }
+
+    const double *last_output = _layers.last().output;
+    for(qint32 individual = 0; individual < _individuals; ++individual)
+    {
+        for(qint32 i = 0; i < _len_output; ++i)
+        {
+            output[individual * _len_output + i] = last_output[i * _lanes + individual];
+        }
+    }
+}
+
+double FeedForwardNetworkEnsemble::getNeuronOutput(qint32 individual, qint32 i)
+{
+    if(Q_LIKELY(individual >= 0 && individual < _individuals && i >= 0 && i < _len_output))
+    {
+        return _layers.last().output[i * _lanes + individual];
+    }
+    else
+    {
+        QNN_CRITICAL_MSG("individual or i out of bounds");
+        return -1.0;
+    }
+}
+
+qint32 FeedForwardNetworkEnsemble::numberIndividuals()
+{
+    return _individuals;
+}
+
+qint32 FeedForwardNetworkEnsemble::size()
+{
+    return _size;
+}
+
+qint32 FeedForwardNetworkEnsemble::lenInput()
+{
+    return _len_input;
+}
+
+qint32 FeedForwardNetworkEnsemble::lenOutput()
+{
+    return _len_output;
+}
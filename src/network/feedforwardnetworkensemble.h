@@ -0,0 +1,196 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FEEDFORWARDNETWORKENSEMBLE_H
+#define FEEDFORWARDNETWORKENSEMBLE_H
+
+#include <qnn-global.h>
+
+#include "feedforwardnetwork.h"
+#include "genericgene.h"
+
+#include <QList>
+#include <QVector>
+
+/*!
+ * \brief The FeedForwardNetworkEnsemble class runs a number of FeedForwardNetworks with the same configuration in lockstep.
+ *
+ * All networks share the same topology, so the weights of all individuals are stored interleaved (individual innermost).
+ * Each processing step then is a single vectorized calculation for all individuals. This is much faster than processing
+ * small networks one after another. Each individual may get its own input.
+ *
+ * The outputs of each individual are exactly the same as the outputs of a FeedForwardNetwork initialised with the same gene.
+ * The ensemble always calculates with double precision, the precision set in the configuration is ignored.
+ *
+ * An ensemble is usually created with FeedForwardNetwork::createEnsemble.
+ */
+class QNNSHARED_EXPORT FeedForwardNetworkEnsemble
+{
+public:
+    /*!
+     * \brief Constructor
+     * \param len_input Length of the input
+     * \param len_output Length of the output
+     * \param config Configuration of all FFNs
+     * \param size Maximum number of individuals. Must be greater then 0
+     */
+    FeedForwardNetworkEnsemble(qint32 len_input, qint32 len_output, FeedForwardNetwork::config config, qint32 size);
+
+    /*!
+     * \brief Destructor
+     */
+    ~FeedForwardNetworkEnsemble();
+
+    /*!
+     * \brief Initialises the ensemble with the given genes.
+     *
+     * The ensemble can be initialised again with new genes at any time. No memory is allocated on reinitialisation.
+     *
+     * \param genes Genes of the individuals. Must contain between 1 and size genes. The caller has to delete the genes
+     */
+    void initialise(QList<GenericGene *> genes);
+
+    /*!
+     * \brief Processes the input of all individuals
+     * \param input Row-major input with len_input values for each individual
+     */
+    void processInput(const double *input);
+
+    /*!
+     * \brief Returns the output of all individuals
+     * \param output Pointer to which the row-major output with len_output values for each individual is written
+     */
+    void getOutputs(double *output);
+
+    /*!
+     * \brief Returns the output of a single neuron
+     * \param individual Number of individual (0 <= individual < numberIndividuals())
+     * \param i Number of neuron (0 <= i < len_output)
+     * \return Output of neuron i of individual
+     */
+    double getNeuronOutput(qint32 individual, qint32 i);
+
+    /*!
+     * \brief Returns the number of individuals used in the last initialisation
+     * \return Number of individuals
+     */
+    qint32 numberIndividuals();
+
+    /*!
+     * \brief Returns the maximum number of individuals
+     * \return Maximum number of individuals
+     */
+    qint32 size();
+
+    /*!
+     * \brief Returns the length of the input of each individual
+     * \return Length of input
+     */
+    qint32 lenInput();
+
+    /*!
+     * \brief Returns the length of the output of each individual
+     * \return Length of output
+     */
+    qint32 lenOutput();
+
+private:
+    /*!
+     * \brief Empty constructor.
+     *
+     * FeedForwardNetworkEnsemble may not be used empty
+     */
+    FeedForwardNetworkEnsemble();
+
+    /*!
+     * \brief A layer of all individuals
+     */
+    struct Layer {
+        /*!
+         * \brief Number of neurons in the layer
+         */
+        qint32 rows;
+
+        /*!
+         * \brief Number of inputs of the layer
+         */
+        qint32 columns;
+
+        /*!
+         * \brief Interleaved weights of all individuals
+         */
+        double *weights;
+
+        /*!
+         * \brief Interleaved bias of all individuals
+         */
+        double *bias;
+
+        /*!
+         * \brief Interleaved output of the layer
+         */
+        double *output;
+    };
+
+    /*!
+     * \brief Length of the input
+     */
+    qint32 _len_input;
+
+    /*!
+     * \brief Length of the output
+     */
+    qint32 _len_output;
+
+    /*!
+     * \brief Configuration of all FFNs
+     */
+    FeedForwardNetwork::config _config;
+
+    /*!
+     * \brief Maximum number of individuals
+     */
+    qint32 _size;
+
+    /*!
+     * \brief Number of individuals of the last initialisation
+     */
+    qint32 _individuals;
+
+    /*!
+     * \brief Number of lanes. This is the padded size
+     */
+    qint32 _lanes;
+
+    /*!
+     * \brief Contains all layers from input to output
+     */
+    QVector<Layer> _layers;
+
+    /*!
+     * \brief Memory block holding the weights, bias and outputs of all layers
+     */
+    double *_memory;
+
+    /*!
+     * \brief Interleaved input
+     */
+    double *_input;
+};
+
+#endif // FEEDFORWARDNETWORKENSEMBLE_H
@@ -0,0 +1,362 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIXEDFEEDFORWARDNETWORK_H
+#define FIXEDFEEDFORWARDNETWORK_H
+
+#include <qnn-global.h>
+
+#include "abstractneuralnetwork.h"
+#include "feedforwardnetwork.h"
+#include "commonnetworkfunctions.h"
+#include "networktoxml.h"
+
+#include <QtCore/qmath.h>
+
+/*!
+ * \brief The standard activation of FixedFeedForwardNetwork.
+ *
+ * This is the sigmoid function, the same as FeedForwardNetwork::standard_activision_function.
+ * An activation for FixedFeedForwardNetwork is a type with a static function activate, so it can be inlined by the compiler.
+ */
+struct FixedSigmoidActivation {
+    /*!
+     * \brief Sigmoid function
+     * \param input Input value
+     * \return Sigmoid of input value
+     */
+    static inline double activate(double input)
+    {
+        return 1.0 / (1.0 + qExp(-1.0 * input));
+    }
+};
+
+/*!
+ * \brief The FixedFeedForwardNetwork class is a FeedForwardNetwork with a topology fixed at compile time.
+ *
+ * The network uses the same gene layout as a FeedForwardNetwork with the same topology and gives the same output.
+ * All sizes and the activation are compile-time constants and all weights are stored inside the object,
+ * so the compiler can unroll and vectorize the loops and no function is called through a pointer.
+ *
+ * Template parameters:
+ *  - In: Length of the input
+ *  - Hidden: Size of all hidden layers
+ *  - Layers: Number of hidden layers. May be 0
+ *  - Out: Length of the output
+ *  - Activation: Type with a static function 'double activate(double)'
+ */
+template<qint32 In, qint32 Hidden, qint32 Layers, qint32 Out, typename Activation = FixedSigmoidActivation>
+class FixedFeedForwardNetwork : public AbstractNeuralNetwork
+{
+    static_assert(In > 0 && Out > 0, "Input and output length must be greater then 0");
+    static_assert(Hidden > 0 && Layers >= 0, "Invalid hidden layer size");
+
+public:
+    /*!
+     * \brief Constructor
+     * \param weight_scalar Scalar for the weight. The weight will be in the range [-weight_scalar, weight_scalar]
+     */
+    FixedFeedForwardNetwork(double weight_scalar = 1.0) :
+        AbstractNeuralNetwork(In, Out),
+        _weight_scalar(weight_scalar)
+    {
+    }
+
+    /*!
+     * \brief Destructor
+     */
+    ~FixedFeedForwardNetwork()
+    {
+    }
+
+    /*!
+     * \brief Returns a random gene which may be used with the network
+     * \return Random gene. The caller must delete the gene
+     */
+    GenericGene *getRandomGene()
+    {
+        return new GenericGene(FeedForwardNetwork::num_segments(In, Out, Layers, Hidden));
+    }
+
+    /*!
+     * \brief Creates a uninitialised copy of the network
+     * \return Copy of the network. The caller must delete the gene
+     */
+    AbstractNeuralNetwork *createConfigCopy()
+    {
+        return new FixedFeedForwardNetwork(_weight_scalar);
+    }
+
+protected:
+    /*!
+     * \brief Overwritten function to initialise the network.
+     */
+    void _initialise()
+    {
+        if(Q_UNLIKELY(_gene->numSegments() < FeedForwardNetwork::num_segments(In, Out, Layers, Hidden)))
+        {
+            QNN_FATAL_MSG("Wrong gene length");
+        }
+
+        qint32 current_segment = 0;
+        decodeLayer(_input_weights, _input_bias, &current_segment);
+        for(qint32 i = 0; i < Layers-1; ++i)
+        {
+            decodeLayer(_hidden_weights[i], _hidden_bias[i], &current_segment);
+        }
+        if(Layers > 0)
+        {
+            decodeLayer(_output_weights, _output_bias, &current_segment);
+        }
+        _resetState();
+    }
+
+    /*!
+     * \brief Overwritten function to reset the dynamic state of the network.
+     */
+    void _resetState()
+    {
+        for(qint32 i = 0; i < HIDDEN_LAYER_BLOCKS; ++i)
+        {
+            for(qint32 j = 0; j < Hidden; ++j)
+            {
+                _hidden[i][j] = 0.0;
+            }
+        }
+        for(qint32 i = 0; i < Out; ++i)
+        {
+            _output[i] = 0.0;
+        }
+    }
+
+    /*!
+     * \brief Overwritten method to process input
+     * \param input Input to process
+     */
+    void _processInput(const double *input)
+    {
+        if(Layers == 0)
+        {
+            processLayer(_input_weights, _input_bias, input, _output);
+        }
+        else
+        {
+            processLayer(_input_weights, _input_bias, input, _hidden[0]);
+            for(qint32 i = 1; i < Layers; ++i)
+            {
+                processLayer(_hidden_weights[i-1], _hidden_bias[i-1], _hidden[i-1], _hidden[i]);
+            }
+            processLayer(_output_weights, _output_bias, _hidden[HIDDEN_LAYER_BLOCKS-1], _output);
+        }
+    }
+
+    /*!
+     * \brief Overwritten function to get output
+     * \param i Number of neuron (0 <= i < len_output)
+     * \return Output of neuron i
+     */
+    double _getNeuronOutput(qint32 i)
+    {
+        if(Q_LIKELY(i >= 0 && i < Out))
+        {
+            return _output[i];
+        }
+        else
+        {
+            QNN_CRITICAL_MSG("i out of bounds");
+            return -1.0;
+        }
+    }
+
+    /*!
+     * \brief Overwritten function to get the output of all output neurons
+     * \param output Pointer to which the output is written
+     */
+    void _getOutputs(double *output)
+    {
+        for(qint32 i = 0; i < Out; ++i)
+        {
+            output[i] = _output[i];
+        }
+    }
+
+    /*!
+     * \brief Overwritten function to save network config
+     * \param stream Stream to save config to. Stream is guaranteed to be a valid pointer
+     * \return True if save is successfull
+     */
+    bool _saveNetworkConfig(QXmlStreamWriter *stream)
+    {
+        QMap<QString, QVariant> config_network;
+        config_network["num_hidden_layer"] = Layers;
+        config_network["len_hidden"] = Hidden;
+        config_network["activision_function"] = "fixed";
+        config_network["weight_scalar"] = _weight_scalar;
+        config_network["len_input"] = In;
+        config_network["len_output"] = Out;
+
+        NetworkToXML::writeConfigStart("FixedFeedForwardNetwork", config_network, stream);
+
+        for(qint32 i = 0; i < In; ++i)
+        {
+            NetworkToXML::writeConfigNeuron(i, QMap<QString, QVariant>(), QMap<qint32, double>(), stream);
+        }
+
+        writeLayer(_input_weights, 0, In, stream);
+        for(qint32 i = 1; i < Layers; ++i)
+        {
+            writeLayer(_hidden_weights[i-1], In + Hidden*(i-1), In + Hidden*i, stream);
+        }
+        if(Layers > 0)
+        {
+            writeLayer(_output_weights, In + Hidden*(Layers-1), In + Hidden*Layers, stream);
+        }
+
+        NetworkToXML::writeConfigEnd(stream);
+        return true;
+    }
+
+private:
+    /*!
+     * \brief Number of neurons in the first layer after the input
+     */
+    static const qint32 FIRST_LAYER_SIZE = Layers > 0 ? Hidden : Out;
+
+    /*!
+     * \brief Number of hidden layers which are stored. At least 1 so that no array has size 0
+     */
+    static const qint32 HIDDEN_LAYER_BLOCKS = Layers > 0 ? Layers : 1;
+
+    /*!
+     * \brief Calculates a layer
+     *
+     * The sum of each neuron is calculated in the same order as in FeedForwardNetwork. The loop over the neurons is the inner loop, so it can be vectorized.
+     *
+     * \param weights Column-major weights of the layer
+     * \param bias Bias of the layer
+     * \param input Input of the layer
+     * \param output Pointer to which the output of the layer is written
+     */
+    template<qint32 Columns, qint32 Rows>
+    static inline void processLayer(const double (&weights)[Columns][Rows], const double (&bias)[Rows], const double *input, double *output)
+    {
+        double sum[Rows];
+        for(qint32 row = 0; row < Rows; ++row)
+        {
+            sum[row] = 0.0;
+        }
+        for(qint32 column = 0; column < Columns; ++column)
+        {
+            for(qint32 row = 0; row < Rows; ++row)
+            {
+                sum[row] += input[column] * weights[column][row];
+            }
+        }
+        for(qint32 row = 0; row < Rows; ++row)
+        {
+            output[row] = Activation::activate(sum[row] + bias[row]);
+        }
+    }
+
+    /*!
+     * \brief Decodes the weights of a layer from the gene
+     * \param weights Column-major weights of the layer
+     * \param bias Bias of the layer
+     * \param current_segment Pointer to the current segment. Is advanced by the number of used segments
+     */
+    template<qint32 Columns, qint32 Rows>
+    void decodeLayer(double (&weights)[Columns][Rows], double (&bias)[Rows], qint32 *current_segment)
+    {
+        for(qint32 row = 0; row < Rows; ++row)
+        {
+            for(qint32 column = 0; column < Columns; ++column)
+            {
+                weights[column][row] = CommonNetworkFunctions::weight(_gene->segment((*current_segment)++)[0], _weight_scalar);
+            }
+            bias[row] = CommonNetworkFunctions::weight(_gene->segment((*current_segment)++)[0], _weight_scalar);
+        }
+    }
+
+    /*!
+     * \brief Writes the neurons of a layer to the XML stream
+     * \param weights Column-major weights of the layer
+     * \param first_input Id of the first input neuron
+     * \param first_output Id of the first neuron of the layer
+     * \param stream Stream to write to
+     */
+    template<qint32 Columns, qint32 Rows>
+    static void writeLayer(const double (&weights)[Columns][Rows], qint32 first_input, qint32 first_output, QXmlStreamWriter *stream)
+    {
+        for(qint32 row = 0; row < Rows; ++row)
+        {
+            QMap<qint32, double> connections_neuron;
+            for(qint32 column = 0; column < Columns; ++column)
+            {
+                connections_neuron[first_input + column] = weights[column][row];
+            }
+            NetworkToXML::writeConfigNeuron(first_output + row, QMap<QString, QVariant>(), connections_neuron, stream);
+        }
+    }
+
+    /*!
+     * \brief Scalar of the weights
+     */
+    double _weight_scalar;
+
+    /*!
+     * \brief Weights from the input to the first layer
+     */
+    double _input_weights[In][FIRST_LAYER_SIZE];
+
+    /*!
+     * \brief Bias of the first layer
+     */
+    double _input_bias[FIRST_LAYER_SIZE];
+
+    /*!
+     * \brief Weights between the hidden layers
+     */
+    double _hidden_weights[HIDDEN_LAYER_BLOCKS][Hidden][Hidden];
+
+    /*!
+     * \brief Bias of the hidden layers after the first
+     */
+    double _hidden_bias[HIDDEN_LAYER_BLOCKS][Hidden];
+
+    /*!
+     * \brief Weights from the last hidden layer to the output
+     */
+    double _output_weights[Hidden][Out];
+
+    /*!
+     * \brief Bias of the output layer if there are hidden layers
+     */
+    double _output_bias[Out];
+
+    /*!
+     * \brief Contains the hidden layers
+     */
+    double _hidden[HIDDEN_LAYER_BLOCKS][Hidden];
+
+    /*!
+     * \brief Contains the output layer
+     */
+    double _output[Out];
+};
+
+#endif // FIXEDFEEDFORWARDNETWORK_H
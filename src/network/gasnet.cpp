@@ -20,6 +20,7 @@
 
 #include "lengthchanginggene.h"
 #include "commonnetworkfunctions.h"
+#include "spatialgrid.h"
 #include "networktoxml.h"
 #include <randomhelper.h>
 
@@ -36,6 +37,7 @@ using CommonNetworkFunctions::weight;
 using CommonNetworkFunctions::calculateDistance;
 using CommonNetworkFunctions::areNodesConnected;
 using CommonNetworkFunctions::cut01;
+using CommonNetworkFunctions::liveNeurons;
 
 using NetworkToXML::writeConfigStart;
 using NetworkToXML::writeConfigNeuron;
@@ -46,8 +48,14 @@ GasNet::GasNet(qint32 len_input, qint32 len_output, config config) :
     _config(config),
     _network(NULL),
     _gas_emitting(NULL),
-    _distances(NULL),
-    _weights(NULL),
+    _connection_start(),
+    _connection_source(),
+    _connection_weight(),
+    _gas_start(),
+    _gas_target(),
+    _gas_coefficient(),
+    _neuron_ids(),
+    _network_size(0),
     _P()
 {
     if(Q_UNLIKELY(_config.area_size <= 0))
@@ -84,8 +92,14 @@ GasNet::GasNet() :
     _config(),
     _network(NULL),
     _gas_emitting(NULL),
-    _distances(NULL),
-    _weights(NULL),
+    _connection_start(),
+    _connection_source(),
+    _connection_weight(),
+    _gas_start(),
+    _gas_target(),
+    _gas_coefficient(),
+    _neuron_ids(),
+    _network_size(0),
     _P()
 {
     _P.append(-4.0);
@@ -103,24 +117,7 @@ GasNet::GasNet() :
 
 GasNet::~GasNet()
 {
-    delete [] _network;
-    delete [] _gas_emitting;
-    if(_distances != NULL && _gene != NULL)
-    {
-        for(qint32 i = 0; i < _gene->segments().size(); ++i)
-        {
-            delete [] _distances[i];
-        }
-        delete [] _distances;
-    }
-    if(_weights != NULL && _gene != NULL)
-    {
-        for(qint32 i = 0; i < _gene->segments().size(); ++i)
-        {
-            delete [] _weights[i];
-        }
-        delete [] _weights;
-    }
+    deleteBuffers();
     if(_config.neuron_save != NULL && _config.neuron_save_opened)
     {
         _config.neuron_save->close();
@@ -172,85 +169,223 @@ AbstractNeuralNetwork *GasNet::createConfigCopy()
     return new GasNet(_len_input, _len_output, _config);
 }
 
+void GasNet::deleteBuffers()
+{
+    delete [] _network;
+    delete [] _gas_emitting;
+    _network = NULL;
+    _gas_emitting = NULL;
+    _network_size = 0;
+}
+
 void GasNet::_initialise()
 {
-    if(Q_UNLIKELY(_gene->segments().size() < _len_output))
+    if(Q_UNLIKELY(_gene->numSegments() < _len_output))
     {
         QNN_FATAL_MSG("Gene length must be bigger then len_output");
     }
-    if(Q_UNLIKELY(_gene->segments()[0].size() != 16))
+    if(Q_UNLIKELY(_gene->segmentSize() != 16))
     {
         QNN_FATAL_MSG("Wrong gene segment length");
     }
-    _network = new double[_gene->segments().size()];
-    _gas_emitting = new double[_gene->segments().size()];
-
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    qint32 size = _gene->numSegments();
+
+    // Decode positions, cones and gas radii once
+    QVector<double> x(size);
+    QVector<double> y(size);
+    QVector<double> positiv_radius(size);
+    QVector<double> positiv_extension(size);
+    QVector<double> positiv_orientation(size);
+    QVector<double> negativ_radius(size);
+    QVector<double> negativ_extension(size);
+    QVector<double> negativ_orientation(size);
+    QVector<double> gas_radius(size);
+    double max_radius = 0.0;
+    for(qint32 i = 0; i < size; ++i)
     {
-        _network[i] = 0;
-        _gas_emitting[i] = 0;
+        x[i] = floatFromGeneInput(_gene->segment(i)[gene_x], _config.area_size);
+        y[i] = floatFromGeneInput(_gene->segment(i)[gene_y], _config.area_size);
+        positiv_radius[i] = floatFromGeneInput(_gene->segment(i)[gene_PositivConeRadius], _config.area_size*_config.cone_ratio);
+        positiv_extension[i] = floatFromGeneInput(_gene->segment(i)[gene_PositivConeExt], 2*M_PI);
+        positiv_orientation[i] = floatFromGeneInput(_gene->segment(i)[gene_PositivConeOrientation], 2*M_PI);
+        negativ_radius[i] = floatFromGeneInput(_gene->segment(i)[gene_NegativConeRadius], _config.area_size*_config.cone_ratio);
+        negativ_extension[i] = floatFromGeneInput(_gene->segment(i)[gene_NegativConeExt], 2*M_PI);
+        negativ_orientation[i] = floatFromGeneInput(_gene->segment(i)[gene_NegativConeOrientation], 2*M_PI);
+        gas_radius[i] = _config.offset_gas_radius + floatFromGeneInput( _gene->segment(i)[gene_Gas_radius], _config.range_gas_radius);
+
+        max_radius = qMax(max_radius, qMax(positiv_radius[i], negativ_radius[i]));
+        if(_gene->segment(i)[gene_TypeGas]%3 != 0)
+        {
+            max_radius = qMax(max_radius, gas_radius[i]);
+        }
     }
 
+    // Only neurons near each other can be connected or reached by gas, so the pairs are found through a grid instead of testing all of them
+    SpatialGrid grid;
+    grid.build(x.constData(), y.constData(), size, max_radius);
+    QVector<qint32> neighbours;
 
-    // Cache distances and connection for faster calculation later
-    _distances = new double*[_gene->segments().size()];
-    _weights = new double*[_gene->segments().size()];
+    // Collect all outgoing connections ordered by source
+    QVector<qint32> edge_source;
+    QVector<qint32> edge_target;
+    QVector<double> edge_weight;
+    for(qint32 source = 0; source < size; ++source)
+    {
+        // recurrent connection
+        double recurrent_weight = 0.0;
+        switch(_gene->segment(source)[gene_recurrent]%3)
+        {
+        case 1:
+            recurrent_weight = 1.0;
+            break;
+        case 2:
+            recurrent_weight = -1.0;
+            break;
+        default:
+            recurrent_weight = 0.0;
+            break;
+        }
+        if(recurrent_weight != 0.0)
+        {
+            edge_source.append(source);
+            edge_target.append(source);
+            edge_weight.append(recurrent_weight);
+        }
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+        grid.neighbours(x[source], y[source], qMax(positiv_radius[source], negativ_radius[source]), &neighbours);
+        for(qint32 i = 0; i < neighbours.size(); ++i)
+        {
+            qint32 target = neighbours[i];
+            if(target == source)
+            {
+                continue;
+            }
+
+            double connection_weight = 0.0;
+            if(areNodesConnected(x[source], y[source], x[target], y[target], positiv_radius[source], positiv_extension[source], positiv_orientation[source]))
+            {
+                connection_weight += 1.0;
+            }
+            if(areNodesConnected(x[source], y[source], x[target], y[target], negativ_radius[source], negativ_extension[source], negativ_orientation[source]))
+            {
+                connection_weight += -1.0;
+            }
+
+            if(connection_weight != 0.0)
+            {
+                edge_source.append(source);
+                edge_target.append(target);
+                edge_weight.append(connection_weight);
+            }
+        }
+    }
+
+    // Collect the neurons inside the gas radius of each neuron together with the concentration coefficient
+    QVector<qint32> reach_start(size + 1);
+    QVector<qint32> reach_target;
+    QVector<double> reach_coefficient;
+    for(qint32 i = 0; i < size; ++i)
     {
-        _distances[i] = new double[_gene->segments().size()];
-        _weights[i] = new double[_gene->segments().size()];
-        for(qint32 j = 0; j < _gene->segments().size(); ++j)
+        reach_start[i] = reach_target.size();
+        if(_gene->segment(i)[gene_TypeGas]%3 == 0)
+        {
+            // No Gas is emitted
+            continue;
+        }
+        grid.neighbours(x[i], y[i], gas_radius[i], &neighbours);
+        for(qint32 j = 0; j < neighbours.size(); ++j)
         {
-            // distance
-            _distances[i][j] = calculateDistance(floatFromGeneInput(_gene->segments()[i][gene_x], _config.area_size),
-                                                  floatFromGeneInput(_gene->segments()[i][gene_y], _config.area_size),
-                                                  floatFromGeneInput(_gene->segments()[j][gene_x], _config.area_size),
-                                                  floatFromGeneInput(_gene->segments()[j][gene_y], _config.area_size));
+            reach_target.append(neighbours[j]);
+            reach_coefficient.append(qExp((-2 * calculateDistance(x[i], y[i], x[neighbours[j]], y[neighbours[j]]))/gas_radius[i]));
+        }
+    }
+    reach_start[size] = reach_target.size();
 
-            // weight
-            _weights[i][j] = 0;
-            if(i == j)
+    // Select the simulated neurons. Neurons can influence others through connections and through gas
+    if(_config.prune_neurons)
+    {
+        QVector<qint32> dependency_source(edge_source);
+        QVector<qint32> dependency_target(edge_target);
+        for(qint32 i = 0; i < size; ++i)
+        {
+            for(qint32 j = reach_start[i]; j < reach_start[i+1]; ++j)
             {
-                // recurrent connection
-                switch(_gene->segments()[i][gene_recurrent]%3)
-                {
-                case 1:
-                    _weights[i][j] = 1.0;
-                    break;
-                case 2:
-                    _weights[i][j] = -1.0;
-                    break;
-                default:
-                    _weights[i][j] = 0.0;
-                    break;
-                }
+                dependency_source.append(i);
+                dependency_target.append(reach_target[j]);
             }
-            else
+        }
+        _neuron_ids = liveNeurons(size, _len_output, dependency_source, dependency_target);
+    }
+    else
+    {
+        _neuron_ids.resize(size);
+        for(qint32 i = 0; i < size; ++i)
+        {
+            _neuron_ids[i] = i;
+        }
+    }
+    QVector<qint32> compact_id(size, -1);
+    for(qint32 i = 0; i < _neuron_ids.size(); ++i)
+    {
+        compact_id[_neuron_ids[i]] = i;
+    }
+
+    // Reuse the buffers of a previous initialisation if possible
+    if(_network == NULL || _network_size != _neuron_ids.size())
+    {
+        deleteBuffers();
+        _network_size = _neuron_ids.size();
+        _network = new double[_network_size];
+        _gas_emitting = new double[_network_size];
+    }
+
+    _resetState();
+
+    // Cache incoming connections of each simulated neuron. Only existing connections are stored so that _processInput does not need to check all pairs.
+    // Sorting the connections by target is stable, so the incoming connections stay ordered by source.
+    // The source of a connection to a simulated neuron is always simulated
+    _connection_start.fill(0, _network_size + 1);
+    for(qint32 i = 0; i < edge_target.size(); ++i)
+    {
+        if(compact_id[edge_target[i]] != -1)
+        {
+            ++_connection_start[compact_id[edge_target[i]]+1];
+        }
+    }
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _connection_start[i+1] += _connection_start[i];
+    }
+    _connection_source.resize(_connection_start[_network_size]);
+    _connection_weight.resize(_connection_start[_network_size]);
+    QVector<qint32> insert_position(_connection_start);
+    for(qint32 i = 0; i < edge_target.size(); ++i)
+    {
+        if(compact_id[edge_target[i]] != -1)
+        {
+            qint32 position = insert_position[compact_id[edge_target[i]]]++;
+            _connection_source[position] = compact_id[edge_source[i]];
+            _connection_weight[position] = edge_weight[i];
+        }
+    }
+
+    // Cache the gas neighbours of each simulated neuron
+    _gas_start.resize(_network_size + 1);
+    _gas_target.clear();
+    _gas_coefficient.clear();
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _gas_start[i] = _gas_target.size();
+        for(qint32 j = reach_start[_neuron_ids[i]]; j < reach_start[_neuron_ids[i]+1]; ++j)
+        {
+            if(compact_id[reach_target[j]] != -1)
             {
-                if(areNodesConnected(floatFromGeneInput(_gene->segments()[i][gene_x], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[i][gene_y], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[j][gene_x], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[j][gene_y], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[i][gene_PositivConeRadius], _config.area_size*_config.cone_ratio),
-                                     floatFromGeneInput(_gene->segments()[i][gene_PositivConeExt], 2*M_PI),
-                                     floatFromGeneInput(_gene->segments()[i][gene_PositivConeOrientation], 2*M_PI)))
-                {
-                    _weights[i][j] += 1.0;
-                }
-                if(areNodesConnected(floatFromGeneInput(_gene->segments()[i][gene_x], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[i][gene_y], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[j][gene_x], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[j][gene_y], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[i][gene_NegativConeRadius], _config.area_size*_config.cone_ratio),
-                                     floatFromGeneInput(_gene->segments()[i][gene_NegativConeExt], 2*M_PI),
-                                     floatFromGeneInput(_gene->segments()[i][gene_NegativConeOrientation], 2*M_PI)))
-                {
-                    _weights[i][j] += -1.0;
-                }
+                _gas_target.append(compact_id[reach_target[j]]);
+                _gas_coefficient.append(reach_coefficient[j]);
             }
         }
     }
+    _gas_start[_network_size] = _gas_target.size();
 
     // Prepare output
     if(_config.neuron_save != NULL)
@@ -269,19 +404,15 @@ void GasNet::_initialise()
                 _config.neuron_save_opened = true;
             }
         }
-        else
-        {
-            _config.neuron_save_opened = false;
-        }
         if(_config.neuron_save != NULL)
         {
             // write header
             QTextStream stream(_config.neuron_save);
-            stream << "Neuron 0";
-            for(qint32 i = 1; i < _gene->segments().size(); ++i)
+            stream << "Neuron " << _neuron_ids[0];
+            for(qint32 i = 1; i < _network_size; ++i)
             {
                 stream << ";";
-                stream << "Neuron " << i;
+                stream << "Neuron " << _neuron_ids[i];
             }
             stream << "\n";
         }
@@ -302,80 +433,44 @@ void GasNet::_initialise()
                 _config.gas_save_opened = true;
             }
         }
-        else
-        {
-            _config.gas_save_opened = false;
-        }
         if(_config.gas_save != NULL)
         {
             // write header
             QTextStream stream(_config.gas_save);
-            stream << "positive 0;negative 0";
-            for(qint32 i = 1; i < _gene->segments().size(); ++i)
+            stream << "positive " << _neuron_ids[0] << ";negative " << _neuron_ids[0];
+            for(qint32 i = 1; i < _network_size; ++i)
             {
                 stream << ";";
-                stream << "positive " << i << ";negative " << i;
+                stream << "positive " << _neuron_ids[i] << ";negative " << _neuron_ids[i];
             }
             stream << "\n";
         }
     }
 }
 
-void GasNet::_processInput(QList<double> input)
+void GasNet::_resetState()
 {
-    double gas1[_gene->segments().size()];
-    double gas2[_gene->segments().size()];
-    double k[_gene->segments().size()];
-
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
-        // Initiation
-        gas1[i] = 0;
-        gas2[i] = 0;
-        k[i] = 0;
+        _network[i] = 0;
+        _gas_emitting[i] = 0;
     }
+}
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
-    {
-        // Calculate gas concentration
-        if(_gas_emitting[i] > 0.0 && _gene->segments()[i][gene_TypeGas]%3 != 0)
-        {
-            double gas_radius = _config.offset_gas_radius + floatFromGeneInput( _gene->segments()[i][gene_Gas_radius], _config.range_gas_radius);
-            for(qint32 j = 0; j < _gene->segments().size(); ++j)
-            {
-                if(_distances[i][j] > gas_radius)
-                {
-                    continue;
-                }
-                double gas_concentration = qExp((-2 * _distances[i][j])/gas_radius) * _gas_emitting[i];
-                switch (_gene->segments()[i][gene_TypeGas]%3)
-                {
-                case 0:
-                    // No Gas is emitted
-                    break;
-
-                case 1:
-                    gas1[j] += gas_concentration;
-                    break;
-
-                case 2:
-                    gas2[j] += gas_concentration;
-                    break;
-
-                default:
-                    QNN_WARNING_MSG("Unknown gas");
-                    break;
-                }
-            }
-        }
-    }
+void GasNet::_processInput(const double *input)
+{
+    double gas1[_network_size];
+    double gas2[_network_size];
+    double k[_network_size];
+
+    calculateGasConcentration(gas1, gas2);
 
     // write gas
     if(_config.gas_save != NULL)
     {
         QTextStream stream(_config.gas_save);
         stream << gas1[0] << ";" << gas2[0];
-        for(qint32 i = 1; i < _gene->segments().size(); ++i)
+        for(qint32 i = 1; i < _network_size; ++i)
         {
             stream << ";";
             stream << gas1[i] << ";" << gas2[i];
@@ -383,10 +478,10 @@ void GasNet::_processInput(QList<double> input)
         stream << "\n";
     }
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
         // Calculate k
-        qint32 basis_index = _gene->segments()[i][gene_basis_index]%_P.length();
+        qint32 basis_index = _gene->segment(_neuron_ids[i])[gene_basis_index]%_P.length();
         qint32 index = qFloor(basis_index + gas1[i] * (_P.length() - basis_index) + gas2[i] * basis_index);
         if(index < 0)
         {
@@ -399,30 +494,33 @@ void GasNet::_processInput(QList<double> input)
         k[i] = _P[index];
     }
 
-    double *newNetwork = new double[_gene->segments().size()];
+    double *newNetwork = new double[_network_size];
+    const qint32 *connection_start = _connection_start.constData();
+    const qint32 *connection_source = _connection_source.constData();
+    const double *connection_weight = _connection_weight.constData();
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
         // Calculate new input
         double newValue = 0;
 
         // Connections
-        for(qint32 j = 0; j < _gene->segments().size(); ++j)
+        for(qint32 j = connection_start[i]; j < connection_start[i+1]; ++j)
         {
-            newValue += _network[j] * _weights[j][i];
+            newValue += _network[connection_source[j]] * connection_weight[j];
         }
 
         // Input
-        if(_gene->segments()[i][gene_input]%(_len_input+1) != 0)
+        if(_gene->segment(_neuron_ids[i])[gene_input]%(_len_input+1) != 0)
         {
-            newValue += input[_gene->segments()[i][gene_input]%(_len_input+1)-1];
+            newValue += input[_gene->segment(_neuron_ids[i])[gene_input]%(_len_input+1)-1];
         }
 
         // K
         newValue *= k[i];
 
         // Bias
-        newValue += weight(_gene->segments()[i][gene_bias], _config.bias_scalar);
+        newValue += weight(_gene->segment(_neuron_ids[i])[gene_bias], _config.bias_scalar);
 
         // tanh
         newNetwork[i] = tanh(newValue);
@@ -431,11 +529,11 @@ void GasNet::_processInput(QList<double> input)
     delete [] _network;
     _network = newNetwork;
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
         // Calculate emition of gas
         bool emittingGas = false;
-        switch (_gene->segments()[i][gene_WhenGas]%3)
+        switch (_gene->segment(_neuron_ids[i])[gene_WhenGas]%3)
         {
         case 0: // Electric charge
             if(_network[i] > _config.electric_threshhold)
@@ -465,11 +563,11 @@ void GasNet::_processInput(QList<double> input)
 
         if(emittingGas)
         {
-            _gas_emitting[i] = cut01(_gas_emitting[i] + 1.0 / (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segments()[i][gene_Rate_of_gas], _config.range_rate_of_gas)));
+            _gas_emitting[i] = cut01(_gas_emitting[i] + 1.0 / (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_Rate_of_gas], _config.range_rate_of_gas)));
         }
         else
         {
-            _gas_emitting[i] = cut01(_gas_emitting[i] - 1.0 / (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segments()[i][gene_Rate_of_gas], _config.range_rate_of_gas)));
+            _gas_emitting[i] = cut01(_gas_emitting[i] - 1.0 / (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_Rate_of_gas], _config.range_rate_of_gas)));
         }
     }
 
@@ -478,7 +576,7 @@ void GasNet::_processInput(QList<double> input)
     {
         QTextStream stream(_config.neuron_save);
         stream << _network[0];
-        for(qint32 i = 1; i < _gene->segments().size(); ++i)
+        for(qint32 i = 1; i < _network_size; ++i)
         {
             stream << ";";
             stream << _network[i];
@@ -487,6 +585,32 @@ void GasNet::_processInput(QList<double> input)
     }
 }
 
+void GasNet::calculateGasConcentration(double *gas1, double *gas2)
+{
+    const qint32 *gas_start = _gas_start.constData();
+    const qint32 *gas_target = _gas_target.constData();
+    const double *gas_coefficient = _gas_coefficient.constData();
+
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        gas1[i] = 0;
+        gas2[i] = 0;
+    }
+
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        if(_gas_emitting[i] > 0.0)
+        {
+            // Only neurons emitting gas 1 or gas 2 have neighbours
+            double *gas = _gene->segment(_neuron_ids[i])[gene_TypeGas]%3 == 1 ? gas1 : gas2;
+            for(qint32 j = gas_start[i]; j < gas_start[i+1]; ++j)
+            {
+                gas[gas_target[j]] += gas_coefficient[j] * _gas_emitting[i];
+            }
+        }
+    }
+}
+
 double GasNet::_getNeuronOutput(qint32 i)
 {
     if(Q_LIKELY(i >= 0 && i < _len_output))
@@ -500,6 +624,14 @@ double GasNet::_getNeuronOutput(qint32 i)
     }
 }
 
+void GasNet::_getOutputs(double *output)
+{
+    for(qint32 i = 0; i < _len_output; ++i)
+    {
+        output[i] = _network[i];
+    }
+}
+
 bool GasNet::_saveNetworkConfig(QXmlStreamWriter *stream)
 {
     QMap<QString, QVariant> config_network;
@@ -514,62 +646,22 @@ bool GasNet::_saveNetworkConfig(QXmlStreamWriter *stream)
     config_network["range_rate_of_gas"] = _config.range_rate_of_gas;
     config_network["min_size"] = _config.min_size;
     config_network["max_size"] = _config.max_size;
+    config_network["prune_neurons"] = _config.prune_neurons;
     config_network["len_input"] = _len_input;
     config_network["len_output"] = _len_output;
 
     writeConfigStart("GasNet", config_network, stream);
 
-    double gas1[_gene->segments().size()];
-    double gas2[_gene->segments().size()];
-    double k[_gene->segments().size()];
-
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
-    {
-        // Initiation
-        gas1[i] = 0;
-        gas2[i] = 0;
-        k[i] = 0;
-    }
+    double gas1[_network_size];
+    double gas2[_network_size];
+    double k[_network_size];
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
-    {
-        // Calculate gas concentration
-        if(_gas_emitting[i] > 0.0 && _gene->segments()[i][gene_TypeGas]%3 != 0)
-        {
-            double gas_radius = _config.offset_gas_radius + floatFromGeneInput( _gene->segments()[i][gene_Gas_radius], _config.range_gas_radius);
-            for(qint32 j = 0; j < _gene->segments().size(); ++j)
-            {
-                if(_distances[i][j] > gas_radius)
-                {
-                    continue;
-                }
-                double gas_concentration = qExp((-2 * _distances[i][j])/gas_radius) * _gas_emitting[i];
-                switch (_gene->segments()[i][gene_TypeGas]%3)
-                {
-                case 0:
-                    // No Gas is emitted
-                    break;
-
-                case 1:
-                    gas1[j] += gas_concentration;
-                    break;
-
-                case 2:
-                    gas2[j] += gas_concentration;
-                    break;
-
-                default:
-                    QNN_WARNING_MSG("Unknown gas");
-                    break;
-                }
-            }
-        }
-    }
+    calculateGasConcentration(gas1, gas2);
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
         // Calculate k
-        qint32 basis_index = _gene->segments()[i][gene_basis_index]%_P.length();
+        qint32 basis_index = _gene->segment(_neuron_ids[i])[gene_basis_index]%_P.length();
         qint32 index = qFloor(basis_index + gas1[i] * (_P.length() - basis_index) + gas2[i] * basis_index);
         if(index < 0)
         {
@@ -582,30 +674,30 @@ bool GasNet::_saveNetworkConfig(QXmlStreamWriter *stream)
         k[i] = _P[index];
     }
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
         QMap<QString, QVariant> config_neuron;
         QMap<qint32, double> connections_neuron;
 
-        config_neuron["pos_x"] = floatFromGeneInput(_gene->segments()[i][gene_x], _config.area_size);
-        config_neuron["pos_y"] = floatFromGeneInput(_gene->segments()[i][gene_y], _config.area_size);
-        config_neuron["positiv_cone_radius"] = floatFromGeneInput(_gene->segments()[i][gene_PositivConeRadius], _config.area_size*_config.cone_ratio);
-        config_neuron["positiv_cone_extension"] = floatFromGeneInput(_gene->segments()[i][gene_PositivConeExt], 2*M_PI);
-        config_neuron["positiv_cone_orientation"] = floatFromGeneInput(_gene->segments()[i][gene_PositivConeOrientation], 2*M_PI);
-        config_neuron["negativ_cone_radius"] = floatFromGeneInput(_gene->segments()[i][gene_NegativConeRadius], _config.area_size*_config.cone_ratio);
-        config_neuron["negativ_cone_extension"] = floatFromGeneInput(_gene->segments()[i][gene_NegativConeExt], 2*M_PI);
-        config_neuron["negativ_cone_orientation"] = floatFromGeneInput(_gene->segments()[i][gene_NegativConeOrientation], 2*M_PI);
-        config_neuron["bias"] = weight(_gene->segments()[i][gene_bias], _config.bias_scalar);
-        config_neuron["rate_of_gas"] = (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segments()[i][gene_Rate_of_gas], _config.range_rate_of_gas));
-
-        if(_gene->segments()[i][gene_input]%(_len_input+1) != 0)
+        config_neuron["pos_x"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_x], _config.area_size);
+        config_neuron["pos_y"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_y], _config.area_size);
+        config_neuron["positiv_cone_radius"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_PositivConeRadius], _config.area_size*_config.cone_ratio);
+        config_neuron["positiv_cone_extension"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_PositivConeExt], 2*M_PI);
+        config_neuron["positiv_cone_orientation"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_PositivConeOrientation], 2*M_PI);
+        config_neuron["negativ_cone_radius"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_NegativConeRadius], _config.area_size*_config.cone_ratio);
+        config_neuron["negativ_cone_extension"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_NegativConeExt], 2*M_PI);
+        config_neuron["negativ_cone_orientation"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_NegativConeOrientation], 2*M_PI);
+        config_neuron["bias"] = weight(_gene->segment(_neuron_ids[i])[gene_bias], _config.bias_scalar);
+        config_neuron["rate_of_gas"] = (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_Rate_of_gas], _config.range_rate_of_gas));
+
+        if(_gene->segment(_neuron_ids[i])[gene_input]%(_len_input+1) != 0)
         {
-            config_neuron["input"] = _gene->segments()[i][gene_input]%(_len_input+1)-1;
+            config_neuron["input"] = _gene->segment(_neuron_ids[i])[gene_input]%(_len_input+1)-1;
         }
 
-        config_neuron["gas_radius"] = _config.offset_gas_radius + floatFromGeneInput( _gene->segments()[i][gene_Gas_radius], _config.range_gas_radius);
+        config_neuron["gas_radius"] = _config.offset_gas_radius + floatFromGeneInput( _gene->segment(_neuron_ids[i])[gene_Gas_radius], _config.range_gas_radius);
 
-        switch (_gene->segments()[i][gene_TypeGas]%3)
+        switch (_gene->segment(_neuron_ids[i])[gene_TypeGas]%3)
         {
         case 0:
             config_neuron["gas_type"] = "No gas";
@@ -626,10 +718,10 @@ bool GasNet::_saveNetworkConfig(QXmlStreamWriter *stream)
 
         config_neuron["gas1_concentration"] = gas1[i];
         config_neuron["gas2_concentration"] = gas2[i];
-        config_neuron["k_basis"] = _P[_gene->segments()[i][gene_basis_index]%_P.length()];
+        config_neuron["k_basis"] = _P[_gene->segment(_neuron_ids[i])[gene_basis_index]%_P.length()];
         config_neuron["k_modulated"] = k[i];
 
-        switch (_gene->segments()[i][gene_WhenGas]%3)
+        switch (_gene->segment(_neuron_ids[i])[gene_WhenGas]%3)
         {
         case 0: // Electric charge
             config_neuron["when_gas_emitting"] = "electric charge";
@@ -648,15 +740,12 @@ bool GasNet::_saveNetworkConfig(QXmlStreamWriter *stream)
             break;
         }
 
-        for(qint32 j = 0; j < _gene->segments().size(); ++j)
+        for(qint32 j = _connection_start[i]; j < _connection_start[i+1]; ++j)
         {
-            if(_weights[j][i] != 0)
-            {
-                connections_neuron[j] = _weights[j][i];
-            }
+            connections_neuron[_neuron_ids[_connection_source[j]]] = _connection_weight[j];
         }
 
-        writeConfigNeuron(i, config_neuron, connections_neuron, stream);
+        writeConfigNeuron(_neuron_ids[i], config_neuron, connections_neuron, stream);
     }
     writeConfigEnd(stream);
     return true;
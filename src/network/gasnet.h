@@ -23,6 +23,8 @@
 
 #include "abstractneuralnetwork.h"
 
+#include <QVector>
+
 /*!
  * \brief The GasNet class represents a GasNet which is inspired by the discovery of freely floating gas in the human brain.
  *
@@ -99,6 +101,14 @@ public:
          */
         qint32 max_size;
 
+        /*!
+         * \brief If prune_neurons is true only neurons which can influence the output are simulated.
+         *
+         * Neurons influence each other through connections and gas. Pruning does not change the output of the network.
+         * Traces and saved configurations only contain the simulated neurons, identified by their position in the gene.
+         */
+        bool prune_neurons;
+
         /*!
          * \brief If neuron_save is not NULL the value of the neurons will be saved to the QIODevice
          *
@@ -144,6 +154,7 @@ public:
             range_rate_of_gas(10.0),
             min_size(-1),
             max_size(-1),
+            prune_neurons(false),
             neuron_save(NULL),
             neuron_save_opened(false),
             gas_save(NULL),
@@ -205,16 +216,26 @@ protected:
                                 gene_basis_index = 14,
                                 gene_bias= 15};
 
+    /*!
+     * \brief Frees all buffers allocated in _initialise.
+     */
+    void deleteBuffers();
+
     /*!
      * \brief Overwritten function to initialise the network.
      */
     void _initialise();
 
+    /*!
+     * \brief Overwritten function to reset the dynamic state of the network.
+     */
+    void _resetState();
+
     /*!
      * \brief Overwritten method to process input
      * \param input Input to process
      */
-    void _processInput(QList<double> input);
+    void _processInput(const double *input);
 
     /*!
      * \brief Overwritten function to get output
@@ -223,6 +244,12 @@ protected:
      */
     double _getNeuronOutput(qint32 i);
 
+    /*!
+     * \brief Overwritten function to get the output of all output neurons
+     * \param output Pointer to which the output is written
+     */
+    void _getOutputs(double *output);
+
     /*!
      * \brief Overwritten function to save network config
      * \param stream Stream to save config to. Stream is guaranteed to be a valid pointer
@@ -230,6 +257,13 @@ protected:
      */
     bool _saveNetworkConfig(QXmlStreamWriter *stream);
 
+    /*!
+     * \brief Calculates the gas concentration at all neurons from the current emission.
+     * \param gas1 Pointer to which the concentration of gas 1 is written. Must hold one value per neuron
+     * \param gas2 Pointer to which the concentration of gas 2 is written. Must hold one value per neuron
+     */
+    void calculateGasConcentration(double *gas1, double *gas2);
+
     /*!
      * \brief The configuration of the network
      */
@@ -246,14 +280,52 @@ protected:
     double *_gas_emitting;
 
     /*!
-     * \brief Holds precalculated distances
+     * \brief Index of the first incoming connection of each neuron in _connection_source / _connection_weight.
+     *
+     * The incoming connections of neuron i are stored from _connection_start[i] to _connection_start[i+1]-1 (compressed sparse row format).
+     */
+    QVector<qint32> _connection_start;
+
+    /*!
+     * \brief Source neuron of each connection
+     */
+    QVector<qint32> _connection_source;
+
+    /*!
+     * \brief Weight of each connection. Connections with weight 0 are not stored
+     */
+    QVector<double> _connection_weight;
+
+    /*!
+     * \brief Index of the first neighbour of each neuron in _gas_target / _gas_coefficient.
+     *
+     * The neighbours of neuron i which are reached by its gas are stored from _gas_start[i] to _gas_start[i+1]-1.
+     * Neurons which do not emit any gas have no neighbours.
+     */
+    QVector<qint32> _gas_start;
+
+    /*!
+     * \brief Neuron reached by the gas
+     */
+    QVector<qint32> _gas_target;
+
+    /*!
+     * \brief Concentration of the gas at the target neuron if the source emits with strength 1
+     */
+    QVector<double> _gas_coefficient;
+
+    /*!
+     * \brief Position in the gene of each simulated neuron.
+     *
+     * All other members use the index of the simulated neuron. Without pruning all neurons are simulated in gene order.
+     * The output neurons are always the first simulated neurons.
      */
-    double **_distances;
+    QVector<qint32> _neuron_ids;
 
     /*!
-     * \brief Holds precalculated weights
+     * \brief Number of simulated neurons the buffers have been allocated for
      */
-    double **_weights;
+    qint32 _network_size;
 
     /*!
      * \brief P array as defined by Husbands
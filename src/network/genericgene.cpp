@@ -18,15 +18,52 @@
 
 #include "genericgene.h"
 #include <QTime>
+#include <QFile>
+#include <QBuffer>
+#include <QtEndian>
 #include <cstdlib>
+#include <cstring>
+#include <limits>
 #include <randomhelper.h>
 
-GenericGene::GenericGene()
+namespace {
+/*
+  Binary gene format (all values little endian):
+
+  magic "QNNGENE\0" (8 byte) | quint32 version | quint32 identifier size | identifier (UTF-8, padded to 8 byte)
+  qint32 segment size | qint32 amount of segments | quint64 payload size | payload (qint32 values, row-major)
+  quint32 size of gene-specific block | gene-specific block (written by _saveGeneBinary)
+*/
+
+const char BINARY_MAGIC[] = "QNNGENE";
+const qint32 BINARY_MAGIC_SIZE = 8;
+const qint32 BINARY_FIXED_HEADER_SIZE = 16;
+const quint32 BINARY_MAX_IDENTIFIER_SIZE = 1024;
+
+qint32 binaryPadding(qint32 size)
+{
+    return (8 - size % 8) % 8;
+}
+
+void prepareBinaryStream(QDataStream *stream)
+{
+    stream->setVersion(QDataStream::Qt_5_0);
+    stream->setByteOrder(QDataStream::LittleEndian);
+}
+}
+
+GenericGene::GenericGene() :
+    _flat(NULL),
+    _flat_capacity(0),
+    _num_segments(0),
+    _segment_size(0)
 {
 }
 
 GenericGene::GenericGene(qint32 initialLength, qint32 segment_size) :
-    _gene(),
+    _flat(NULL),
+    _flat_capacity(0),
+    _num_segments(0),
     _segment_size(segment_size)
 {
     if(Q_UNLIKELY(initialLength < 0))
@@ -38,105 +75,144 @@ GenericGene::GenericGene(qint32 initialLength, qint32 segment_size) :
         QNN_FATAL_MSG("Segment size must be greater then 0");
     }
 
-    _gene.reserve(initialLength);
-    for(qint32 i = 0; i < initialLength; ++i)
+    resizeSegments(initialLength);
+    for(qint32 i = 0; i < initialLength * _segment_size; ++i)
     {
-        QVector<qint32> list;
-        for(qint32 j = 0; j < _segment_size; ++j)
-        {
-            list.reserve(_segment_size);
-            list.append(getIndependentRandomInt());
-        }
-        _gene.append(list);
+        _flat[i] = getIndependentRandomInt();
     }
 }
 
 GenericGene::GenericGene(QVector< QVector<qint32> > gene, qint32 segment_size) :
-    _gene(gene),
+    _flat(NULL),
+    _flat_capacity(0),
+    _num_segments(0),
     _segment_size(segment_size)
 {
+    resizeSegments(gene.size());
+    for(qint32 i = 0; i < gene.size(); ++i)
+    {
+        // Values not present in the list stay 0
+        qint32 length = qMin(gene[i].size(), _segment_size);
+        memcpy(segment(i), gene[i].constData(), length * sizeof(qint32));
+    }
+}
+
+GenericGene::GenericGene(const qint32 *values, qint32 num_segments, qint32 segment_size) :
+    _flat(NULL),
+    _flat_capacity(0),
+    _num_segments(0),
+    _segment_size(segment_size)
+{
+    resizeSegments(num_segments);
+    memcpy(_flat, values, (qint64) num_segments * _segment_size * sizeof(qint32));
 }
 
 GenericGene::~GenericGene()
 {
+    qFreeAligned(_flat);
+}
+
+const QVector<QVector<qint32> > GenericGene::segments() const
+{
+    QVector< QVector<qint32> > gene;
+    gene.reserve(_num_segments);
+    for(qint32 i = 0; i < _num_segments; ++i)
+    {
+        QVector<qint32> values(_segment_size);
+        memcpy(values.data(), segment(i), _segment_size * sizeof(qint32));
+        gene.append(values);
+    }
+    return gene;
 }
 
-QVector<QVector<qint32> > &GenericGene::segments()
+void GenericGene::resizeSegments(qint32 num_segments)
 {
-    return _gene;
+    qint32 size = num_segments * _segment_size;
+    if(size > _flat_capacity || _flat == NULL)
+    {
+        // Grow geometrically so genes changing their length one segment at a time do not reallocate every time
+        qint32 capacity = qMax(qMax(size, 2 * _flat_capacity), 1);
+        qint32 *flat = static_cast<qint32 *>(qMallocAligned(capacity * sizeof(qint32), ALIGNMENT_FLAT_STORAGE));
+        if(Q_UNLIKELY(flat == NULL))
+        {
+            QNN_FATAL_MSG("Can not allocate gene storage");
+        }
+        if(_flat != NULL)
+        {
+            memcpy(flat, _flat, _num_segments * _segment_size * sizeof(qint32));
+            qFreeAligned(_flat);
+        }
+        _flat = flat;
+        _flat_capacity = capacity;
+    }
+    for(qint32 i = _num_segments * _segment_size; i < size; ++i)
+    {
+        _flat[i] = 0;
+    }
+    _num_segments = num_segments;
+}
+
+void GenericGene::removeSegment(qint32 i)
+{
+    memmove(segment(i), segment(i+1), (_num_segments - i - 1) * _segment_size * sizeof(qint32));
+    --_num_segments;
 }
 
 GenericGene *GenericGene::createCopy()
 {
-    return new GenericGene(_gene, _segment_size);
+    return new GenericGene(_flat, _num_segments, _segment_size);
 }
 
 void GenericGene::mutate()
 {
     //Simple mutation py probability - the chance of mutating a value is the same for every value.
-    for(qint32 i = 0; i < _gene.size(); ++i)
+    for(qint32 i = 0; i < _num_segments * _segment_size; ++i)
     {
-        for(qint32 j = 0; j < _gene[i].size(); ++j)
+        if(RandomHelper::getRandomDouble(0,1) < MUTATION_RATE)
         {
-            if(RandomHelper::getRandomDouble(0,1) < MUTATION_RATE)
-            {
-                _gene[i][j] = getIndependentRandomInt();
-            }
+            _flat[i] = getIndependentRandomInt();
         }
     }
 }
 
 QList<GenericGene *> GenericGene::combine(GenericGene *gene1, GenericGene *gene2)
 {
-    if(gene1->_gene[0].size() != gene2->_gene[0].size())
+    if(gene1->_segment_size != gene2->_segment_size)
     {
         QNN_CRITICAL_MSG("Attemted crossover of different type of genes");
         return QList<GenericGene *>();
     }
-    QVector< QVector<qint32> > newGene1;
-    QVector< QVector<qint32> > newGene2;
-    qint32 smallerLength = gene1->_gene.size() < gene2->_gene.size() ? gene1->_gene.size() : gene2->_gene.size();
-    qint32 largerLength = gene1->_gene.size() > gene2->_gene.size() ? gene1->_gene.size() : gene2->_gene.size();
+    qint32 segment_size = gene1->_segment_size;
+    qint32 smallerLength = qMin(gene1->_num_segments, gene2->_num_segments);
     qint32 outer_crossover = RandomHelper::getRandomInt(0, smallerLength-1);
-    qint32 inner_crossover = RandomHelper::getRandomInt(0, gene1->_gene[0].size()-1);
-    qint32 i;
-    for(i = 0; i < outer_crossover; ++i)
+    qint32 inner_crossover = RandomHelper::getRandomInt(0, segment_size-1);
+
+    // The children start as copies of their parents (keeping the gene type and configuration)
+    // and get the segments from the other parent after the crossover point
+    GenericGene *newGene1 = gene1->createCopy();
+    GenericGene *newGene2 = gene2->createCopy();
+    newGene1->resizeSegments(gene2->_num_segments);
+    newGene2->resizeSegments(gene1->_num_segments);
+
+    qint32 i = outer_crossover;
+    if(i >= inner_crossover)
     {
-        newGene1.append(gene1->_gene[i]);
-        newGene2.append(gene2->_gene[i]);
+        memcpy(newGene1->segment(i), gene2->segment(i), segment_size * sizeof(qint32));
+        memcpy(newGene2->segment(i), gene1->segment(i), segment_size * sizeof(qint32));
     }
-    QVector<qint32> crossover1;
-    QVector<qint32> crossover2;
-    for(qint32 j = 0; j < gene1->_gene[0].size(); ++j)
+    ++i;
+    if(i < gene2->_num_segments)
     {
-        if(i < inner_crossover)
-        {
-            crossover1.append(gene1->_gene[i][j]);
-            crossover2.append(gene2->_gene[i][j]);
-        }
-        else
-        {
-            crossover1.append(gene2->_gene[i][j]);
-            crossover2.append(gene1->_gene[i][j]);
-        }
+        memcpy(newGene1->segment(i), gene2->segment(i), (gene2->_num_segments - i) * segment_size * sizeof(qint32));
     }
-    newGene1.append(crossover1);
-    newGene2.append(crossover2);
-    for(++i; i < largerLength; ++i)
+    if(i < gene1->_num_segments)
     {
-        if(i < gene2->_gene.size())
-        {
-            newGene1.append(gene2->_gene[i]);
-        }
-        if(i < gene1->_gene.size())
-        {
-            newGene2.append(gene1->_gene[i]);
-        }
+        memcpy(newGene2->segment(i), gene1->segment(i), (gene1->_num_segments - i) * segment_size * sizeof(qint32));
     }
 
     QList<GenericGene *> geneList;
-    geneList.append(gene1->createGene(newGene1, gene1->_gene[0].size()));
-    geneList.append(gene2->createGene(newGene2, gene2->_gene[0].size()));
+    geneList.append(newGene1);
+    geneList.append(newGene2);
     return geneList;
 }
 
@@ -162,12 +238,12 @@ bool GenericGene::saveGene(QIODevice *device)
     stream << identifier() << " ";
     stream << "segments " << _segment_size << " ";
     stream << "gene ";
-    foreach(QVector<qint32> segment, _gene)
+    for(qint32 i = 0; i < _num_segments; ++i)
     {
         stream << "genesegment ";
-        foreach(qint32 i, segment)
+        for(qint32 j = 0; j < _segment_size; ++j)
         {
-            stream << i << " ";
+            stream << segment(i)[j] << " ";
         }
     }
     stream << "geneend ";
@@ -179,6 +255,68 @@ bool GenericGene::saveGene(QIODevice *device)
     return result;
 }
 
+bool GenericGene::saveGeneBinary(QIODevice *device)
+{
+    if(Q_UNLIKELY(device == NULL))
+    {
+        return false;
+    }
+    bool opened_device = false;
+    if(!device->isOpen())
+    {
+        QNN_DEBUG_MSG("Opening device");
+        if(!device->open(QIODevice::WriteOnly))
+        {
+            QNN_CRITICAL_MSG("Can not open device");
+            return false;
+        }
+        opened_device = true;
+    }
+    QDataStream stream(device);
+    prepareBinaryStream(&stream);
+
+    // Header
+    QByteArray gene_identifier = identifier().toUtf8();
+    stream.writeRawData(BINARY_MAGIC, BINARY_MAGIC_SIZE);
+    stream << BINARY_FORMAT_VERSION;
+    stream << (quint32) gene_identifier.size();
+    stream.writeRawData(gene_identifier.constData(), gene_identifier.size());
+    for(qint32 i = 0; i < binaryPadding(gene_identifier.size()); ++i)
+    {
+        stream << (quint8) 0;
+    }
+    qint64 payload_size = (qint64) numSegments() * _segment_size * sizeof(qint32);
+    stream << _segment_size;
+    stream << numSegments();
+    stream << (quint64) payload_size;
+
+    // Payload
+    const qint32 *payload = flatSegments();
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    stream.writeRawData(reinterpret_cast<const char *>(payload), payload_size);
+#else
+    for(qint64 i = 0; i < payload_size / (qint64) sizeof(qint32); ++i)
+    {
+        stream << payload[i];
+    }
+#endif
+
+    // Gene-specific values
+    QByteArray extra;
+    QDataStream extra_stream(&extra, QIODevice::WriteOnly);
+    prepareBinaryStream(&extra_stream);
+    bool result = _saveGeneBinary(&extra_stream);
+    stream << (quint32) extra.size();
+    stream.writeRawData(extra.constData(), extra.size());
+
+    result = result && stream.status() == QDataStream::Ok;
+    if(opened_device)
+    {
+        device->close();
+    }
+    return result;
+}
+
 GenericGene *GenericGene::loadGene(QIODevice *device)
 {
     if(Q_UNLIKELY(device == NULL))
@@ -200,6 +338,17 @@ GenericGene *GenericGene::loadGene(QIODevice *device)
         }
         opened_device = true;
     }
+
+    if(isBinaryGene(device))
+    {
+        GenericGene *newGene = loadGeneBinary(device);
+        if(opened_device)
+        {
+            device->close();
+        }
+        return newGene;
+    }
+
     QTextStream stream(device);
     QString command;
     stream >> command;
@@ -283,6 +432,17 @@ bool GenericGene::canLoad(QIODevice *device)
         }
         opened_device = true;
     }
+
+    if(isBinaryGene(device))
+    {
+        bool result = canLoadBinary(device);
+        if(opened_device)
+        {
+            device->close();
+        }
+        return result;
+    }
+
     QString gene_identifier;
 
     QTextStream stream(device);
@@ -297,6 +457,184 @@ bool GenericGene::canLoad(QIODevice *device)
     return gene_identifier == identifier();
 }
 
+GenericGene *GenericGene::loadGene(const uchar *data, qint64 size, qint64 *used)
+{
+    if(Q_UNLIKELY(data == NULL || size < BINARY_MAGIC_SIZE || memcmp(data, BINARY_MAGIC, BINARY_MAGIC_SIZE) != 0))
+    {
+        QNN_CRITICAL_MSG("No binary gene");
+        return NULL;
+    }
+
+    // A single gene never exceeds the size of a QByteArray
+    QByteArray raw = QByteArray::fromRawData(reinterpret_cast<const char *>(data), qMin(size, (qint64) std::numeric_limits<int>::max()));
+    QBuffer buffer(&raw);
+    buffer.open(QIODevice::ReadOnly);
+
+    GenericGene *newGene = readGeneBinary(&buffer, data);
+    if(used != NULL)
+    {
+        *used = buffer.pos();
+    }
+    return newGene;
+}
+
+GenericGene *GenericGene::loadGeneBinary(QIODevice *device)
+{
+    // Map the rest of a file once and read the gene from memory
+    QFile *file = qobject_cast<QFile *>(device);
+    if(file != NULL)
+    {
+        qint64 position = file->pos();
+        qint64 length = file->size() - position;
+        uchar *mapping = length > 0 ? file->map(position, length) : NULL;
+        if(mapping != NULL)
+        {
+            qint64 used = 0;
+            GenericGene *newGene = loadGene(mapping, length, &used);
+            file->unmap(mapping);
+            file->seek(position + used);
+            return newGene;
+        }
+    }
+
+    return readGeneBinary(device, NULL);
+}
+
+GenericGene *GenericGene::readGeneBinary(QIODevice *device, const uchar *memory)
+{
+    QDataStream stream(device);
+    prepareBinaryStream(&stream);
+
+    // Header
+    char magic[BINARY_MAGIC_SIZE];
+    if(stream.readRawData(magic, BINARY_MAGIC_SIZE) != BINARY_MAGIC_SIZE || memcmp(magic, BINARY_MAGIC, BINARY_MAGIC_SIZE) != 0)
+    {
+        QNN_CRITICAL_MSG("No binary gene");
+        return NULL;
+    }
+
+    quint32 version;
+    quint32 identifier_size;
+    stream >> version;
+    stream >> identifier_size;
+    if(stream.status() != QDataStream::Ok || version != BINARY_FORMAT_VERSION)
+    {
+        QNN_CRITICAL_MSG("Unsupported binary gene version");
+        return NULL;
+    }
+    if(identifier_size > BINARY_MAX_IDENTIFIER_SIZE)
+    {
+        QNN_CRITICAL_MSG("Invalid identifier");
+        return NULL;
+    }
+    QByteArray gene_identifier(identifier_size, '\0');
+    if(stream.readRawData(gene_identifier.data(), identifier_size) != (qint32) identifier_size || QString::fromUtf8(gene_identifier) != identifier())
+    {
+        QNN_CRITICAL_MSG("Wrong gene type");
+        return NULL;
+    }
+    stream.skipRawData(binaryPadding(identifier_size));
+
+    qint32 segment_size;
+    qint32 segment_count;
+    quint64 payload_size;
+    stream >> segment_size;
+    stream >> segment_count;
+    stream >> payload_size;
+    if(stream.status() != QDataStream::Ok || segment_size <= 0 || segment_count < 0 || payload_size != (quint64) segment_size * segment_count * sizeof(qint32))
+    {
+        QNN_CRITICAL_MSG("Invalid segment size");
+        return NULL;
+    }
+
+    // Payload - used in place if the device reads from memory
+    QByteArray buffer;
+    const uchar *payload = NULL;
+    if(memory != NULL)
+    {
+        qint64 position = device->pos();
+        if((quint64) (device->size() - position) < payload_size)
+        {
+            QNN_CRITICAL_MSG("Payload too short");
+            return NULL;
+        }
+        payload = memory + position;
+        device->seek(position + payload_size);
+    }
+    else
+    {
+        buffer = device->read(payload_size);
+        if((quint64) buffer.size() != payload_size)
+        {
+            QNN_CRITICAL_MSG("Payload too short");
+            return NULL;
+        }
+        payload = reinterpret_cast<const uchar *>(buffer.constData());
+    }
+
+    // Gene-specific values
+    quint32 extra_size;
+    stream >> extra_size;
+    QByteArray extra = device->read(extra_size);
+    if(stream.status() != QDataStream::Ok || (quint32) extra.size() != extra_size)
+    {
+        QNN_CRITICAL_MSG("Gene-specific values missing");
+        return NULL;
+    }
+    QDataStream extra_stream(&extra, QIODevice::ReadOnly);
+    prepareBinaryStream(&extra_stream);
+
+    const qint32 *values = reinterpret_cast<const qint32 *>(payload);
+    QVector<qint32> converted;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    if(Q_UNLIKELY(reinterpret_cast<quintptr>(payload) % sizeof(qint32) != 0))
+    {
+        converted.resize(segment_count * segment_size);
+        memcpy(converted.data(), payload, payload_size);
+        values = converted.constData();
+    }
+#else
+    converted.resize(segment_count * segment_size);
+    for(qint32 i = 0; i < converted.size(); ++i)
+    {
+        converted[i] = qFromLittleEndian<qint32>(payload + i * sizeof(qint32));
+    }
+    values = converted.constData();
+#endif
+
+    return _loadGeneBinary(values, segment_count, segment_size, &extra_stream);
+}
+
+bool GenericGene::canLoadBinary(QIODevice *device)
+{
+    QByteArray header = device->peek(BINARY_FIXED_HEADER_SIZE);
+    if(header.size() != BINARY_FIXED_HEADER_SIZE || memcmp(header.constData(), BINARY_MAGIC, BINARY_MAGIC_SIZE) != 0)
+    {
+        return false;
+    }
+
+    const uchar *data = reinterpret_cast<const uchar *>(header.constData());
+    quint32 version = qFromLittleEndian<quint32>(data + BINARY_MAGIC_SIZE);
+    quint32 identifier_size = qFromLittleEndian<quint32>(data + BINARY_MAGIC_SIZE + sizeof(quint32));
+    if(version != BINARY_FORMAT_VERSION || identifier_size > BINARY_MAX_IDENTIFIER_SIZE)
+    {
+        return false;
+    }
+
+    header = device->peek(BINARY_FIXED_HEADER_SIZE + identifier_size);
+    if((quint32) header.size() != BINARY_FIXED_HEADER_SIZE + identifier_size)
+    {
+        return false;
+    }
+    return QString::fromUtf8(header.constData() + BINARY_FIXED_HEADER_SIZE, identifier_size) == identifier();
+}
+
+bool GenericGene::isBinaryGene(QIODevice *device)
+{
+    QByteArray magic = device->peek(BINARY_MAGIC_SIZE);
+    return magic.size() == BINARY_MAGIC_SIZE && memcmp(magic.constData(), BINARY_MAGIC, BINARY_MAGIC_SIZE) == 0;
+}
+
 qint32 GenericGene::getIndependentRandomInt()
 {
     return RandomHelper::getRandomInt(0, MAX_GENE_VALUE);
@@ -335,3 +673,15 @@ GenericGene *GenericGene::_loadGene(QVector< QVector<qint32> > gene, qint32 segm
     Q_UNUSED(stream); // Nothing extra to save here
     return new GenericGene(gene, segment_size);
 }
+
+bool GenericGene::_saveGeneBinary(QDataStream *stream)
+{
+    Q_UNUSED(stream); // Nothing extra to save here
+    return true;
+}
+
+GenericGene *GenericGene::_loadGeneBinary(const qint32 *data, qint32 num_segments, qint32 segment_size, QDataStream *stream)
+{
+    Q_UNUSED(stream); // Nothing extra to load here
+    return new GenericGene(data, num_segments, segment_size);
+}
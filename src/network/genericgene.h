@@ -24,6 +24,7 @@
 #include <QVector>
 #include <QIODevice>
 #include <QTextStream>
+#include <QDataStream>
 
 /*!
  * @brief GenericGene provides a base class for all genes
@@ -40,6 +41,9 @@
  *  - GenericGene::createGene(QVector< QVector<qint32> > gene, qint32 segment_size)
  *  - GenericGene::createCopy()
  *
+ * Genes which save additional values should also override:
+ *  - GenericGene::_saveGeneBinary(QDataStream *stream)
+ *  - GenericGene::_loadGeneBinary(const qint32 *data, qint32 num_segments, qint32 segment_size, QDataStream *stream)
  *
  * Each implementation should also provide the following static methods:
  *  - static GenericGene * GenericGene::loadThisGene(QIODevice *device)
@@ -69,14 +73,86 @@ public:
     virtual void mutate();
 
     /*!
-     * \brief segments Return the list of segments from this gene.
+     * \brief segments Returns a copy of the segments of this gene.
      *
-     * Please note: The list is returned by reference which means the content of the gene can be changed through it.
-     * Although this might be desired for implementing other learning methods and such the segments should not be changed without explicit actions.
+     * The segments are stored in one contiguous buffer (see flatSegments()). This method is kept for compatibility and
+     * builds a nested copy of the buffer, so it should not be used in performance critical code.
+     * To change the content of the gene (e.g. for implementing other learning methods) use segment(i) or flatSegments().
      *
-     * \return Reference of list of segments
+     * \return Copy of the list of segments
      */
-    virtual QVector< QVector<qint32> >& segments();
+    const QVector< QVector<qint32> > segments() const;
+
+    /*!
+     * \brief Returns the amount of segments of this gene.
+     * \return Amount of segments
+     */
+    inline qint32 numSegments() const
+    {
+        return _num_segments;
+    }
+
+    /*!
+     * \brief Returns the size of each segment.
+     * \return Size of the segments
+     */
+    inline qint32 segmentSize() const
+    {
+        return _segment_size;
+    }
+
+    /*!
+     * \brief Returns all segments as one contiguous, aligned buffer.
+     *
+     * The buffer is the storage of the gene and is stored row-major, segment i starts at position i*segmentSize().
+     * The pointer is valid until the amount of segments changes (e.g. by mutate() of a LengthChangingGene).
+     * Reading the gene never changes it, so a gene can be read by multiple threads at the same time.
+     *
+     * \return Pointer to the first value of the first segment
+     */
+    inline const qint32 *flatSegments() const
+    {
+        return _flat;
+    }
+
+    /*!
+     * \brief Returns all segments as one contiguous, aligned buffer.
+     *
+     * This is the writable version of flatSegments() const. The values may be changed through the pointer.
+     *
+     * \return Pointer to the first value of the first segment
+     */
+    inline qint32 *flatSegments()
+    {
+        return _flat;
+    }
+
+    /*!
+     * \brief Returns segment i.
+     *
+     * This is a fast, non-virtual accessor which should be used in performance critical code.
+     * See flatSegments() for the lifetime of the pointer.
+     *
+     * \param i Number of segment (0 <= i < numSegments())
+     * \return Pointer to the first value of segment i. The segment has segmentSize() values
+     */
+    inline const qint32 *segment(qint32 i) const
+    {
+        return _flat + i * _segment_size;
+    }
+
+    /*!
+     * \brief Returns segment i.
+     *
+     * This is the writable version of segment(qint32 i) const. The values may be changed through the pointer.
+     *
+     * \param i Number of segment (0 <= i < numSegments())
+     * \return Pointer to the first value of segment i. The segment has segmentSize() values
+     */
+    inline qint32 *segment(qint32 i)
+    {
+        return _flat + i * _segment_size;
+    }
 
     /*!
      * \brief createCopy Creates a deep copy of the gene.
@@ -88,7 +164,7 @@ public:
      * \brief Combines two genes and returns their two children.
      *
      * The combination used in this method is a one-point-crossover.
-     * The children are created using the createGene method. Both genes must have the same segment size.
+     * The children are created as copies of the parents (using createCopy) and then overwritten. Both genes must have the same segment size.
      *
      * \param gene1 First parent gene
      * \param gene2 second parent gene
@@ -107,12 +183,30 @@ public:
      */
     bool saveGene(QIODevice *device);
 
+    /*!
+     * \brief Saves this gene to a given device using the binary format.
+     *
+     * The binary format is much faster to load and smaller than the text format used by saveGene.
+     * It consists of a versioned header (magic, identifier, segment size, amount of segments),
+     * a length-prefixed payload holding all segment values as little endian qint32 and a length-prefixed block of gene-specific values.
+     * This method will call _saveGeneBinary where subclasses can save their values.
+     *
+     * Both formats can be loaded with loadGene.
+     *
+     * \param device The QIODevice to which the gene is saved
+     * \return True if save was successful
+     */
+    bool saveGeneBinary(QIODevice *device);
+
     /*!
      * \brief Creates a gene from a given device.
      *
      * This is a wrapper function which manages the device as well saves the GenericGene.
      * This method will then call _saveGene where subclasses can save their values.
      *
+     * The format (text or binary) is detected automatically. If the device is a QFile the binary gene is read through a memory mapping
+     * and the segment values are copied once, directly into the new gene.
+     *
      * If the gene can't be loaded NULL will be returned.
      *
      * \param device The QIODevice from which the gene is loaded
@@ -120,11 +214,25 @@ public:
      */
     GenericGene *loadGene(QIODevice *device);
 
+    /*!
+     * \brief Creates a gene saved in the binary format from memory, e.g. from a memory mapped file.
+     *
+     * The segment values are copied once, directly into the new gene.
+     * If the gene can't be loaded NULL will be returned.
+     *
+     * \param data Start of the binary gene
+     * \param size Amount of bytes available at data
+     * \param used If not NULL the amount of bytes occupied by the gene is stored here
+     * \return Loaded Gene (NULL if unsuccessful). The caller must delete the gene
+     */
+    GenericGene *loadGene(const uchar *data, qint64 size, qint64 *used = NULL);
+
     /*!
      * \brief Test if the gene can be loaded from the device.
      *
      * This method performs a simple test if the gene can be loaded from a given device.
      * However if this method returns true it does not mean that the load procedure will be successful.
+     * For the binary format only the header is checked.
      *
      * \param device The QIODevice to test
      * \return True if the gene can be loaded
@@ -216,11 +324,103 @@ protected:
     virtual GenericGene *_loadGene(QVector< QVector<qint32> > gene, qint32 segment_size, QTextStream *stream);
 
     /*!
-     * \brief The list of segments.
+     * \brief Saves gene-specific values in the binary format
+     *
+     * This method is called by saveGeneBinary after the segments have been saved. It should be used to save gene-specific values of subclasses.
+     * The stream writes little endian values into the length-prefixed block following the segments.
+     *
+     * \param stream Stream to save values to. Stream is guaranteed to be a valid pointer
+     * \return True if save was successful
+     */
+    virtual bool _saveGeneBinary(QDataStream *stream);
+
+    /*!
+     * \brief Loads gene-specific values from the binary format
+     *
+     * This method is called by loadGene after the segments of a binary gene have been loaded. It is the binary counterpart to _loadGene.
+     * The result should be a pointer on a new gene object or NULL if the gene could not be loaded.
+     *
+     * The segment values are passed without intermediate copies (usually straight from a memory mapping) and should be copied into the new gene
+     * with the row-major constructor GenericGene(const qint32 *values, qint32 num_segments, qint32 segment_size).
+     *
+     * \param data Row-major buffer holding num_segments*segment_size values in host byte order. Only valid during the call
+     * \param num_segments Loaded amount of segments
+     * \param segment_size Loaded length of segments
+     * \param stream Stream to load values from. Stream is guaranteed to be a valid pointer
+     * \return Loaded gene. The caller must delete the gene
+     */
+    virtual GenericGene *_loadGeneBinary(const qint32 *data, qint32 num_segments, qint32 segment_size, QDataStream *stream);
+
+    /*!
+     * \brief Loads a gene in the binary format from an opened device
+     * \param device The QIODevice from which the gene is loaded. Must be open
+     * \return Loaded Gene (NULL if unsuccessful). The caller must delete the gene
+     */
+    GenericGene *loadGeneBinary(QIODevice *device);
+
+    /*!
+     * \brief Reads a gene in the binary format from an opened device
+     * \param device The QIODevice from which the gene is read. Must be open
+     * \param memory If not NULL the device reads from this memory (position 0 of the device) and the payload is used in place
+     * \return Loaded Gene (NULL if unsuccessful). The caller must delete the gene
+     */
+    GenericGene *readGeneBinary(QIODevice *device, const uchar *memory);
+
+    /*!
+     * \brief Tests if the header of a binary gene on an opened device matches this gene type
+     * \param device The QIODevice to test. Must be open
+     * \return True if the gene can be loaded
+     */
+    bool canLoadBinary(QIODevice *device);
+
+    /*!
+     * \brief Tests if the gene on an opened device is saved in the binary format.
+     *
+     * The device position is not changed.
+     *
+     * \param device The QIODevice to test. Must be open
+     * \return True if the gene is saved in the binary format
+     */
+    static bool isBinaryGene(QIODevice *device);
+
+    /*!
+     * \brief A constructor which creates a gene from a row-major buffer
+     * \param values Buffer holding num_segments*segment_size values. The values are copied
+     * \param num_segments Amount of segments
+     * \param segment_size Length of the segments
+     */
+    GenericGene(const qint32 *values, qint32 num_segments, qint32 segment_size);
+
+    /*!
+     * \brief Changes the amount of segments.
+     *
+     * Existing segments are kept, new segments are filled with 0.
+     * This invalidates all pointers returned by flatSegments() and segment().
      *
-     * A segment is a QList of qint32
+     * \param num_segments New amount of segments
      */
-    QVector< QVector<qint32> > _gene;
+    void resizeSegments(qint32 num_segments);
+
+    /*!
+     * \brief Removes segment i. All following segments are moved to the front.
+     * \param i Number of segment (0 <= i < numSegments())
+     */
+    void removeSegment(qint32 i);
+
+    /*!
+     * \brief Segment storage, row-major and aligned to ALIGNMENT_FLAT_STORAGE bytes
+     */
+    qint32 *_flat;
+
+    /*!
+     * \brief Number of values _flat can hold
+     */
+    qint32 _flat_capacity;
+
+    /*!
+     * \brief Amount of segments
+     */
+    qint32 _num_segments;
 
     /*!
      * \brief The length of a segment
@@ -231,6 +431,19 @@ protected:
      * \brief MUTATION_RATE is the probability of a mutation occuring.
      */
     static constexpr double MUTATION_RATE = 0.03;
+
+    /*!
+     * \brief Alignment of the flat storage in bytes (one cache line)
+     */
+    static const size_t ALIGNMENT_FLAT_STORAGE = 64;
+
+    /*!
+     * \brief Version of the binary gene format
+     */
+    static const quint32 BINARY_FORMAT_VERSION = 1;
+
+private:
+    Q_DISABLE_COPY(GenericGene)
 };
 
 #endif // GENERICGENE_H
@@ -64,34 +64,39 @@ LengthChangingGene::LengthChangingGene(QVector< QVector<qint32> > gene, qint32 s
     }
 }
 
+LengthChangingGene::LengthChangingGene(const qint32 *values, qint32 num_segments, qint32 segment_size, config config) :
+    GenericGene(values, num_segments, segment_size),
+    _config(config)
+{
+}
+
 void LengthChangingGene::mutate()
 {
     GenericGene::mutate();
-    if(_gene.size() > _config.min_length)
+    if(_num_segments > _config.min_length)
     {
         if(RandomHelper::getRandomDouble(0,1) < MUTATION_RATE)
         {
-            _gene.remove(RandomHelper::getRandomInt(0, _gene.size()-1));
+            removeSegment(RandomHelper::getRandomInt(0, _num_segments-1));
         }
     }
-    if(_gene.size() < _config.max_length)
+    if(_num_segments < _config.max_length)
     {
         if(RandomHelper::getRandomDouble(0,1) < MUTATION_RATE)
         {
-            QVector<qint32> newSegment;
-            newSegment.reserve(_segment_size);
+            resizeSegments(_num_segments + 1);
+            qint32 *newSegment = segment(_num_segments - 1);
             for(qint32 j = 0; j < _segment_size; ++j)
             {
-                newSegment.append(getIndependentRandomInt());
+                newSegment[j] = getIndependentRandomInt();
             }
-            _gene.append(newSegment);
         }
     }
 }
 
 GenericGene *LengthChangingGene::createCopy()
 {
-    return new LengthChangingGene(_gene, _segment_size, _config);
+    return new LengthChangingGene(_flat, _num_segments, _segment_size, _config);
 }
 
 GenericGene *LengthChangingGene::loadThisGene(QIODevice *device)
@@ -149,3 +154,30 @@ GenericGene *LengthChangingGene::_loadGene(QVector< QVector<qint32> > gene, qint
 
     return new LengthChangingGene(gene, segment_size, config);
 }
+
+bool LengthChangingGene::_saveGeneBinary(QDataStream *stream)
+{
+    *stream << _config.min_length;
+    *stream << _config.max_length;
+    return stream->status() == QDataStream::Ok;
+}
+
+GenericGene *LengthChangingGene::_loadGeneBinary(const qint32 *data, qint32 num_segments, qint32 segment_size, QDataStream *stream)
+{
+    config config;
+
+    *stream >> config.min_length;
+    *stream >> config.max_length;
+    if(stream->status() != QDataStream::Ok)
+    {
+        QNN_CRITICAL_MSG("No min_length / max_length");
+        return NULL;
+    }
+    if(num_segments < config.min_length || num_segments > config.max_length)
+    {
+        QNN_CRITICAL_MSG("Gene length must be between min length and max length");
+        return NULL;
+    }
+
+    return new LengthChangingGene(data, num_segments, segment_size, config);
+}
@@ -121,6 +121,15 @@ protected:
      */
     LengthChangingGene(QVector< QVector<qint32> > gene, qint32 segment_size, config config = config());
 
+    /*!
+     * \brief A constructor which creates a gene from a row-major buffer. The length is not checked against the configuration
+     * \param values Buffer holding num_segments*segment_size values. The values are copied
+     * \param num_segments Amount of segments
+     * \param segment_size Length of the segments
+     * \param config Configuration of the LengthChangingGene
+     */
+    LengthChangingGene(const qint32 *values, qint32 num_segments, qint32 segment_size, config config);
+
     /*!
      * \brief Creates a gene out of a given segment list. The created gene should hold the same configuration as the object on which the method is called.
      * \param gene Segment list
@@ -151,6 +160,23 @@ protected:
      */
     GenericGene *_loadGene(QVector< QVector<qint32> > gene, qint32 segment_size, QTextStream *stream);
 
+    /*!
+     * \brief Overwritten method to save gene in the binary format.
+     * \param stream Stream to save values to. Stream is guaranteed to be a valid pointer
+     * \return True if save was successful
+     */
+    bool _saveGeneBinary(QDataStream *stream);
+
+    /*!
+     * \brief Overwritten method to load gene from the binary format.
+     * \param data Row-major buffer holding the segment values
+     * \param num_segments Loaded amount of segments
+     * \param segment_size Loaded length of segments
+     * \param stream Stream to load values from. Stream is guaranteed to be a valid pointer
+     * \return Loaded gene. The caller must delete the gene
+     */
+    GenericGene *_loadGeneBinary(const qint32 *data, qint32 num_segments, qint32 segment_size, QDataStream *stream);
+
     /*!
      * \brief Holds the configuration of the gene.
      */
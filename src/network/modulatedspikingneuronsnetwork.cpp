@@ -20,6 +20,8 @@
 
 #include "lengthchanginggene.h"
 #include "commonnetworkfunctions.h"
+#include "spatialgrid.h"
+#include "vectorfunctions.h"
 #include "networktoxml.h"
 #include <randomhelper.h>
 
@@ -28,6 +30,12 @@
 
 #include <math.h>
 
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 // GENE ENCODING: x, y, Rp, Rext, Rort, Rn, Rext, Rort, input, recurrent, WhenGas, TypeGas, Rate of gas (1-11), radius,   a,   b,   c,   d
 //                0  1   2   3      4    5    6     7     8     9             10     11               12        13       14   15   16   17
 
@@ -36,11 +44,18 @@ using CommonNetworkFunctions::weight;
 using CommonNetworkFunctions::calculateDistance;
 using CommonNetworkFunctions::areNodesConnected;
 using CommonNetworkFunctions::cut01;
+using CommonNetworkFunctions::liveNeurons;
 
 using NetworkToXML::writeConfigStart;
 using NetworkToXML::writeConfigNeuron;
 using NetworkToXML::writeConfigEnd;
 
+using VectorFunctions::paddedLength;
+using VectorFunctions::allocateDoubles;
+using VectorFunctions::freeDoubles;
+
+const double ModulatedSpikingNeuronsNetwork::SPIKE_INPUT = 30.0;
+
 namespace {
 double getModulatedValue(bool modulation_applied, double gasPos, double gasNeg, qint32 basis_index, QVector<double> &array)
 {
@@ -62,6 +77,91 @@ double getModulatedValue(bool modulation_applied, double gasPos, double gasNeg,
         return array[basis_index];
     }
 }
+
+// Izhikevich membrane update of all neurons: v' = v + 0.04v^2 + 5v + 140 - u + input, u' = u + a(bv - u)
+// All vectors must be aligned and padded with paddedLength
+void izhikevichStep(double *v, double *u, const double *a, const double *b, const double *input, qint32 length)
+{
+#if defined(__AVX__)
+    const __m256d factor_square = _mm256_set1_pd(0.04);
+    const __m256d factor_linear = _mm256_set1_pd(5.0);
+    const __m256d offset = _mm256_set1_pd(140.0);
+    for(qint32 i = 0; i < length; i += 4)
+    {
+        __m256d value_v = _mm256_load_pd(v + i);
+        __m256d value_u = _mm256_load_pd(u + i);
+        __m256d delta_v = _mm256_mul_pd(_mm256_mul_pd(factor_square, value_v), value_v);
+        delta_v = _mm256_add_pd(delta_v, _mm256_mul_pd(factor_linear, value_v));
+        delta_v = _mm256_sub_pd(_mm256_add_pd(delta_v, offset), value_u);
+        delta_v = _mm256_add_pd(delta_v, _mm256_load_pd(input + i));
+        __m256d delta_u = _mm256_mul_pd(_mm256_load_pd(a + i), _mm256_sub_pd(_mm256_mul_pd(_mm256_load_pd(b + i), value_v), value_u));
+        _mm256_store_pd(v + i, _mm256_add_pd(value_v, delta_v));
+        _mm256_store_pd(u + i, _mm256_add_pd(value_u, delta_u));
+    }
+#elif defined(__SSE2__)
+    const __m128d factor_square = _mm_set1_pd(0.04);
+    const __m128d factor_linear = _mm_set1_pd(5.0);
+    const __m128d offset = _mm_set1_pd(140.0);
+    for(qint32 i = 0; i < length; i += 2)
+    {
+        __m128d value_v = _mm_load_pd(v + i);
+        __m128d value_u = _mm_load_pd(u + i);
+        __m128d delta_v = _mm_mul_pd(_mm_mul_pd(factor_square, value_v), value_v);
+        delta_v = _mm_add_pd(delta_v, _mm_mul_pd(factor_linear, value_v));
+        delta_v = _mm_sub_pd(_mm_add_pd(delta_v, offset), value_u);
+        delta_v = _mm_add_pd(delta_v, _mm_load_pd(input + i));
+        __m128d delta_u = _mm_mul_pd(_mm_load_pd(a + i), _mm_sub_pd(_mm_mul_pd(_mm_load_pd(b + i), value_v), value_u));
+        _mm_store_pd(v + i, _mm_add_pd(value_v, delta_v));
+        _mm_store_pd(u + i, _mm_add_pd(value_u, delta_u));
+    }
+#else
+    for(qint32 i = 0; i < length; ++i)
+    {
+        double value_v = v[i];
+        v[i] = value_v + (0.04 * value_v * value_v + 5.0 * value_v + 140.0 - u[i] + input[i]);
+        u[i] = u[i] + (a[i] * (b[i] * value_v - u[i]));
+    }
+#endif
+}
+
+// Resets all neurons with v >= 30 to v = c, u = u + d and counts the spike
+// All vectors must be aligned and padded with paddedLength
+void izhikevichFire(double *v, double *u, const double *c, const double *d, double *firecount, qint32 length)
+{
+#if defined(__AVX__)
+    const __m256d threshold = _mm256_set1_pd(30.0);
+    const __m256d one = _mm256_set1_pd(1.0);
+    for(qint32 i = 0; i < length; i += 4)
+    {
+        __m256d value_v = _mm256_load_pd(v + i);
+        __m256d value_u = _mm256_load_pd(u + i);
+        __m256d fired = _mm256_cmp_pd(value_v, threshold, _CMP_GE_OQ);
+        _mm256_store_pd(v + i, _mm256_blendv_pd(value_v, _mm256_load_pd(c + i), fired));
+        _mm256_store_pd(u + i, _mm256_blendv_pd(value_u, _mm256_add_pd(value_u, _mm256_load_pd(d + i)), fired));
+        _mm256_store_pd(firecount + i, _mm256_add_pd(_mm256_load_pd(firecount + i), _mm256_and_pd(fired, one)));
+    }
+#elif defined(__SSE2__)
+    const __m128d threshold = _mm_set1_pd(30.0);
+    const __m128d one = _mm_set1_pd(1.0);
+    for(qint32 i = 0; i < length; i += 2)
+    {
+        __m128d value_v = _mm_load_pd(v + i);
+        __m128d value_u = _mm_load_pd(u + i);
+        __m128d fired = _mm_cmpge_pd(value_v, threshold);
+        _mm_store_pd(v + i, _mm_or_pd(_mm_andnot_pd(fired, value_v), _mm_and_pd(fired, _mm_load_pd(c + i))));
+        _mm_store_pd(u + i, _mm_or_pd(_mm_andnot_pd(fired, value_u), _mm_and_pd(fired, _mm_add_pd(value_u, _mm_load_pd(d + i)))));
+        _mm_store_pd(firecount + i, _mm_add_pd(_mm_load_pd(firecount + i), _mm_and_pd(fired, one)));
+    }
+#else
+    for(qint32 i = 0; i < length; ++i)
+    {
+        bool fired = v[i] >= 30.0;
+        v[i] = fired ? c[i] : v[i];
+        u[i] = fired ? u[i] + d[i] : u[i];
+        firecount[i] += fired ? 1.0 : 0.0;
+    }
+#endif
+}
 }
 
 
@@ -72,8 +172,31 @@ ModulatedSpikingNeuronsNetwork::ModulatedSpikingNeuronsNetwork(qint32 len_input,
     _gas_emitting(NULL),
     _u(NULL),
     _firecount(NULL),
-    _distances(NULL),
-    _weights(NULL),
+    _connection_start(),
+    _connection_source(),
+    _connection_weight(),
+    _gas_start(),
+    _gas_target(),
+    _gas_coefficient(),
+    _outgoing_start(),
+    _outgoing_target(),
+    _outgoing_weight(),
+    _spike_input(NULL),
+    _a(NULL),
+    _b(NULL),
+    _c(NULL),
+    _d(NULL),
+    _synaptic_input(NULL),
+    _gas(NULL),
+    _gas_applied(NULL),
+    _gas_sources(),
+    _gas_channel(),
+    _gas_update_count(0),
+    _basis_index(),
+    _input(),
+    _neuron_ids(),
+    _network_size(0),
+    _stride(0),
     _Pa(),
     _Pb(),
     _Pc(),
@@ -94,6 +217,10 @@ ModulatedSpikingNeuronsNetwork::ModulatedSpikingNeuronsNetwork(qint32 len_input,
     {
         QNN_FATAL_MSG("offset_rate_of_gas must be greater then 0");
     }
+    if(Q_UNLIKELY(_config.gas_update_interval < 1))
+    {
+        QNN_FATAL_MSG("gas_update_interval must be at least 1");
+    }
 
     _config.neuron_save_opened = false;
     _config.gas_save_opened = false;
@@ -109,8 +236,31 @@ ModulatedSpikingNeuronsNetwork::ModulatedSpikingNeuronsNetwork() :
     _gas_emitting(NULL),
     _u(NULL),
     _firecount(NULL),
-    _distances(NULL),
-    _weights(NULL),
+    _connection_start(),
+    _connection_source(),
+    _connection_weight(),
+    _gas_start(),
+    _gas_target(),
+    _gas_coefficient(),
+    _outgoing_start(),
+    _outgoing_target(),
+    _outgoing_weight(),
+    _spike_input(NULL),
+    _a(NULL),
+    _b(NULL),
+    _c(NULL),
+    _d(NULL),
+    _synaptic_input(NULL),
+    _gas(NULL),
+    _gas_applied(NULL),
+    _gas_sources(),
+    _gas_channel(),
+    _gas_update_count(0),
+    _basis_index(),
+    _input(),
+    _neuron_ids(),
+    _network_size(0),
+    _stride(0),
     _Pa(),
     _Pb(),
     _Pc(),
@@ -123,27 +273,7 @@ ModulatedSpikingNeuronsNetwork::ModulatedSpikingNeuronsNetwork() :
 
 ModulatedSpikingNeuronsNetwork::~ModulatedSpikingNeuronsNetwork()
 {
-    delete [] _network;
-    delete [] _gas_emitting;
-    delete [] _u;
-    delete [] _firecount;
-
-    if(_distances != NULL && _gene != NULL)
-    {
-        for(qint32 i = 0; i < _gene->segments().size(); ++i)
-        {
-            delete [] _distances[i];
-        }
-        delete [] _distances;
-    }
-    if(_weights != NULL && _gene != NULL)
-    {
-        for(qint32 i = 0; i < _gene->segments().size(); ++i)
-        {
-            delete [] _weights[i];
-        }
-        delete [] _weights;
-    }
+    deleteBuffers();
     if(_config.neuron_save != NULL && _config.neuron_save_opened)
     {
         _config.neuron_save->close();
@@ -307,89 +437,337 @@ AbstractNeuralNetwork *ModulatedSpikingNeuronsNetwork::createConfigCopy()
     return new ModulatedSpikingNeuronsNetwork(_len_input, _len_output, _config);
 }
 
+void ModulatedSpikingNeuronsNetwork::deleteBuffers()
+{
+    freeDoubles(_network);
+    freeDoubles(_gas_emitting);
+    freeDoubles(_u);
+    freeDoubles(_firecount);
+    freeDoubles(_spike_input);
+    freeDoubles(_a);
+    freeDoubles(_b);
+    freeDoubles(_c);
+    freeDoubles(_d);
+    freeDoubles(_synaptic_input);
+    freeDoubles(_gas);
+    freeDoubles(_gas_applied);
+
+    _network = NULL;
+    _gas_emitting = NULL;
+    _u = NULL;
+    _firecount = NULL;
+    _spike_input = NULL;
+    _a = NULL;
+    _b = NULL;
+    _c = NULL;
+    _d = NULL;
+    _synaptic_input = NULL;
+    _gas = NULL;
+    _gas_applied = NULL;
+    _network_size = 0;
+    _stride = 0;
+}
+
 void ModulatedSpikingNeuronsNetwork::_initialise()
 {
-    if(Q_UNLIKELY(_gene->segments().size() < _len_output))
+    if(Q_UNLIKELY(_gene->numSegments() < _len_output))
     {
         QNN_FATAL_MSG("Gene length must be bigger then len_output");
     }
-    if(Q_UNLIKELY(_gene->segments()[0].size() != 18))
+    if(Q_UNLIKELY(_gene->segmentSize() != 18))
     {
         QNN_FATAL_MSG("Wrong gene segment length");
     }
-    _network = new double[_gene->segments().size()];
-    _gas_emitting = new double[_gene->segments().size()];
-    _u = new double[_gene->segments().size()];
-    _firecount = new double[_gene->segments().size()];
-
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    qint32 size = _gene->numSegments();
+
+    // Decode positions, cones and gas radii once
+    QVector<double> x(size);
+    QVector<double> y(size);
+    QVector<double> positiv_radius(size);
+    QVector<double> positiv_extension(size);
+    QVector<double> positiv_orientation(size);
+    QVector<double> negativ_radius(size);
+    QVector<double> negativ_extension(size);
+    QVector<double> negativ_orientation(size);
+    QVector<double> gas_radius(size);
+    double max_radius = 0.0;
+    for(qint32 i = 0; i < size; ++i)
     {
-        _network[i] = 0;
-        _gas_emitting[i] = 0;
-        _u[i] = 0;
-        _firecount[i] = 0;
+        x[i] = floatFromGeneInput(_gene->segment(i)[gene_x], _config.area_size);
+        y[i] = floatFromGeneInput(_gene->segment(i)[gene_y], _config.area_size);
+        positiv_radius[i] = floatFromGeneInput(_gene->segment(i)[gene_PositivConeRadius], _config.area_size*_config.cone_ratio);
+        positiv_extension[i] = floatFromGeneInput(_gene->segment(i)[gene_PositivConeExt], 2*M_PI);
+        positiv_orientation[i] = floatFromGeneInput(_gene->segment(i)[gene_PositivConeOrientation], 2*M_PI);
+        negativ_radius[i] = floatFromGeneInput(_gene->segment(i)[gene_NegativConeRadius], _config.area_size*_config.cone_ratio);
+        negativ_extension[i] = floatFromGeneInput(_gene->segment(i)[gene_NegativConeExt], 2*M_PI);
+        negativ_orientation[i] = floatFromGeneInput(_gene->segment(i)[gene_NegativConeOrientation], 2*M_PI);
+        gas_radius[i] = _config.offset_gas_radius + floatFromGeneInput( _gene->segment(i)[gene_Gas_radius], _config.range_gas_radius);
+
+        max_radius = qMax(max_radius, qMax(positiv_radius[i], negativ_radius[i]));
+        if(_TypeGas_list[_gene->segment(i)[gene_TypeGas]%_TypeGas_list.size()] != NoGas)
+        {
+            max_radius = qMax(max_radius, gas_radius[i]);
+        }
     }
 
-    // Cache distances and connection for faster calculation later
-    _distances = new double*[_gene->segments().size()];
-    _weights = new double*[_gene->segments().size()];
+    // Only neurons near each other can be connected or reached by gas, so the pairs are found through a grid instead of testing all of them
+    SpatialGrid grid;
+    grid.build(x.constData(), y.constData(), size, max_radius);
+    QVector<qint32> neighbours;
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    // Collect all outgoing connections ordered by source
+    QVector<qint32> edge_source;
+    QVector<qint32> edge_target;
+    QVector<double> edge_weight;
+    for(qint32 source = 0; source < size; ++source)
     {
-        _distances[i] = new double[_gene->segments().size()];
-        _weights[i] = new double[_gene->segments().size()];
-        for(qint32 j = 0; j < _gene->segments().size(); ++j)
+        // recurrent connection
+        double recurrent_weight = 0.0;
+        switch(_gene->segment(source)[gene_recurrent]%3)
+        {
+        case 1:
+            recurrent_weight = 1.0;
+            break;
+        case 2:
+            recurrent_weight = -1.0;
+            break;
+        default:
+            recurrent_weight = 0.0;
+            break;
+        }
+        if(recurrent_weight != 0.0)
+        {
+            edge_source.append(source);
+            edge_target.append(source);
+            edge_weight.append(recurrent_weight);
+        }
+
+        grid.neighbours(x[source], y[source], qMax(positiv_radius[source], negativ_radius[source]), &neighbours);
+        for(qint32 i = 0; i < neighbours.size(); ++i)
         {
-            // distance
-            _distances[i][j] = calculateDistance(floatFromGeneInput(_gene->segments()[i][gene_x], _config.area_size),
-                                                 floatFromGeneInput(_gene->segments()[i][gene_y], _config.area_size),
-                                                 floatFromGeneInput(_gene->segments()[j][gene_x], _config.area_size),
-                                                 floatFromGeneInput(_gene->segments()[j][gene_y], _config.area_size));
+            qint32 target = neighbours[i];
+            if(target == source)
+            {
+                continue;
+            }
 
-            // weight
-            _weights[i][j] = 0;
-            if(i == j)
+            double connection_weight = 0.0;
+            if(areNodesConnected(x[source], y[source], x[target], y[target], positiv_radius[source], positiv_extension[source], positiv_orientation[source]))
             {
-                // recurrent connection
-                switch(_gene->segments()[i][gene_recurrent]%3)
-                {
-                case 1:
-                    _weights[i][j] = 1.0;
-                    break;
-                case 2:
-                    _weights[i][j] = -1.0;
-                    break;
-                default:
-                    _weights[i][j] = 0.0;
-                    break;
-                }
+                connection_weight += 1.0;
             }
-            else
+            if(areNodesConnected(x[source], y[source], x[target], y[target], negativ_radius[source], negativ_extension[source], negativ_orientation[source]))
             {
-                if(areNodesConnected(floatFromGeneInput(_gene->segments()[i][gene_x], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[i][gene_y], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[j][gene_x], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[j][gene_y], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[i][gene_PositivConeRadius], _config.area_size*_config.cone_ratio),
-                                     floatFromGeneInput(_gene->segments()[i][gene_PositivConeExt], 2*M_PI),
-                                     floatFromGeneInput(_gene->segments()[i][gene_PositivConeOrientation], 2*M_PI)))
-                {
-                    _weights[i][j] += 1.0;
-                }
-                if(areNodesConnected(floatFromGeneInput(_gene->segments()[i][gene_x], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[i][gene_y], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[j][gene_x], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[j][gene_y], _config.area_size),
-                                     floatFromGeneInput(_gene->segments()[i][gene_NegativConeRadius], _config.area_size*_config.cone_ratio),
-                                     floatFromGeneInput(_gene->segments()[i][gene_NegativConeExt], 2*M_PI),
-                                     floatFromGeneInput(_gene->segments()[i][gene_NegativConeOrientation], 2*M_PI)))
-                {
-                    _weights[i][j] += -1.0;
-                }
+                connection_weight += -1.0;
             }
+
+            if(connection_weight != 0.0)
+            {
+                edge_source.append(source);
+                edge_target.append(target);
+                edge_weight.append(connection_weight);
+            }
+        }
+    }
+
+    // Collect the neurons inside the gas radius of each neuron together with the concentration coefficient
+    QVector<qint32> reach_start(size + 1);
+    QVector<qint32> reach_target;
+    QVector<double> reach_coefficient;
+    for(qint32 i = 0; i < size; ++i)
+    {
+        reach_start[i] = reach_target.size();
+        if(_TypeGas_list[_gene->segment(i)[gene_TypeGas]%_TypeGas_list.size()] == NoGas)
+        {
+            // No Gas is emitted
+            continue;
+        }
+        grid.neighbours(x[i], y[i], gas_radius[i], &neighbours);
+        for(qint32 j = 0; j < neighbours.size(); ++j)
+        {
+            reach_target.append(neighbours[j]);
+            reach_coefficient.append(qExp((-2 * calculateDistance(x[i], y[i], x[neighbours[j]], y[neighbours[j]]))/gas_radius[i]));
+        }
+    }
+    reach_start[size] = reach_target.size();
+
+    // Select the simulated neurons. Neurons can influence others through connections and through gas
+    if(_config.prune_neurons)
+    {
+        QVector<qint32> dependency_source(edge_source);
+        QVector<qint32> dependency_target(edge_target);
+        for(qint32 i = 0; i < size; ++i)
+        {
+            for(qint32 j = reach_start[i]; j < reach_start[i+1]; ++j)
+            {
+                dependency_source.append(i);
+                dependency_target.append(reach_target[j]);
+            }
+        }
+        _neuron_ids = liveNeurons(size, _len_output, dependency_source, dependency_target);
+    }
+    else
+    {
+        _neuron_ids.resize(size);
+        for(qint32 i = 0; i < size; ++i)
+        {
+            _neuron_ids[i] = i;
+        }
+    }
+    QVector<qint32> compact_id(size, -1);
+    for(qint32 i = 0; i < _neuron_ids.size(); ++i)
+    {
+        compact_id[_neuron_ids[i]] = i;
+    }
+
+    // Reuse the buffers of a previous initialisation if possible
+    if(_network == NULL || _network_size != _neuron_ids.size())
+    {
+        deleteBuffers();
+        _network_size = _neuron_ids.size();
+        _stride = paddedLength(_network_size);
+        _network = allocateDoubles(_network_size);
+        _gas_emitting = allocateDoubles(_network_size);
+        _u = allocateDoubles(_network_size);
+        _firecount = allocateDoubles(_network_size);
+        _spike_input = allocateDoubles(_network_size);
+        _a = allocateDoubles(_network_size);
+        _b = allocateDoubles(_network_size);
+        _c = allocateDoubles(_network_size);
+        _d = allocateDoubles(_network_size);
+        _synaptic_input = allocateDoubles(_network_size);
+        _gas = allocateDoubles(8 * _stride);
+        _gas_applied = allocateDoubles(_network_size);
+        _gas_sources.resize(8 * _stride);
+    }
+
+    _resetState();
+
+    // Decode the neuron parameters once. Parameters which are not modulated never change
+    _basis_index.resize(4 * _network_size);
+    _input.resize(_network_size);
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _basis_index[i] = _gene->segment(_neuron_ids[i])[gene_a]%_Pa.size();
+        _basis_index[_network_size + i] = _gene->segment(_neuron_ids[i])[gene_b]%_Pb.size();
+        _basis_index[2 * _network_size + i] = _gene->segment(_neuron_ids[i])[gene_c]%_Pc.size();
+        _basis_index[3 * _network_size + i] = _gene->segment(_neuron_ids[i])[gene_d]%_Pd.size();
+        _a[i] = _Pa[_basis_index[i]];
+        _b[i] = _Pb[_basis_index[_network_size + i]];
+        _c[i] = _Pc[_basis_index[2 * _network_size + i]];
+        _d[i] = _Pd[_basis_index[3 * _network_size + i]];
+        _input[i] = _gene->segment(_neuron_ids[i])[gene_input]%(_len_input+1) - 1;
+    }
+
+    // Channel of _gas each neuron emits to
+    _gas_channel.resize(_network_size);
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        switch(_TypeGas_list[_gene->segment(_neuron_ids[i])[gene_TypeGas]%_TypeGas_list.size()])
+        {
+        case APositiv:
+            _gas_channel[i] = 0;
+            break;
+
+        case ANegativ:
+            _gas_channel[i] = 1;
+            break;
+
+        case BPositiv:
+            _gas_channel[i] = 2;
+            break;
+
+        case BNegativ:
+            _gas_channel[i] = 3;
+            break;
+
+        case CPositiv:
+            _gas_channel[i] = 4;
+            break;
+
+        case CNegativ:
+            _gas_channel[i] = 5;
+            break;
+
+        case DPositiv:
+            _gas_channel[i] = 6;
+            break;
+
+        case DNegativ:
+            _gas_channel[i] = 7;
+            break;
+
+        default:
+            // No Gas is emitted
+            _gas_channel[i] = -1;
+            break;
+        }
+    }
+
+    // Cache incoming connections of each simulated neuron. Only existing connections are stored so that _processInput does not need to check all pairs.
+    // Sorting the connections by target is stable, so the incoming connections stay ordered by source.
+    // The source of a connection to a simulated neuron is always simulated
+    _connection_start.fill(0, _network_size + 1);
+    for(qint32 i = 0; i < edge_target.size(); ++i)
+    {
+        if(compact_id[edge_target[i]] != -1)
+        {
+            ++_connection_start[compact_id[edge_target[i]]+1];
+        }
+    }
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _connection_start[i+1] += _connection_start[i];
+    }
+    _connection_source.resize(_connection_start[_network_size]);
+    _connection_weight.resize(_connection_start[_network_size]);
+    QVector<qint32> insert_position(_connection_start);
+    for(qint32 i = 0; i < edge_target.size(); ++i)
+    {
+        if(compact_id[edge_target[i]] != -1)
+        {
+            qint32 position = insert_position[compact_id[edge_target[i]]]++;
+            _connection_source[position] = compact_id[edge_source[i]];
+            _connection_weight[position] = edge_weight[i];
         }
     }
 
+    // The connections are ordered by source, event_propagation uses them to send spikes to the simulated neurons
+    _outgoing_start.fill(0, _network_size + 1);
+    _outgoing_target.clear();
+    _outgoing_weight.clear();
+    for(qint32 i = 0; i < edge_source.size(); ++i)
+    {
+        if(compact_id[edge_target[i]] != -1)
+        {
+            ++_outgoing_start[compact_id[edge_source[i]]+1];
+            _outgoing_target.append(compact_id[edge_target[i]]);
+            _outgoing_weight.append(edge_weight[i]);
+        }
+    }
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _outgoing_start[i+1] += _outgoing_start[i];
+    }
+
+    // Cache the gas neighbours of each simulated neuron
+    _gas_start.resize(_network_size + 1);
+    _gas_target.clear();
+    _gas_coefficient.clear();
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _gas_start[i] = _gas_target.size();
+        for(qint32 j = reach_start[_neuron_ids[i]]; j < reach_start[_neuron_ids[i]+1]; ++j)
+        {
+            if(compact_id[reach_target[j]] != -1)
+            {
+                _gas_target.append(compact_id[reach_target[j]]);
+                _gas_coefficient.append(reach_coefficient[j]);
+            }
+        }
+    }
+    _gas_start[_network_size] = _gas_target.size();
+
     // Prepare output
     if(_config.neuron_save != NULL)
     {
@@ -407,19 +785,15 @@ void ModulatedSpikingNeuronsNetwork::_initialise()
                 _config.neuron_save_opened = true;
             }
         }
-        else
-        {
-            _config.neuron_save_opened = false;
-        }
         if(_config.neuron_save != NULL)
         {
             // write header
             QTextStream stream(_config.neuron_save);
-            stream << "Neuron 0";
-            for(qint32 i = 1; i < _gene->segments().size(); ++i)
+            stream << "Neuron " << _neuron_ids[0];
+            for(qint32 i = 1; i < _network_size; ++i)
             {
                 stream << ";";
-                stream << "Neuron " << i;
+                stream << "Neuron " << _neuron_ids[i];
             }
             stream << "\n";
         }
@@ -440,128 +814,84 @@ void ModulatedSpikingNeuronsNetwork::_initialise()
                 _config.gas_save_opened = true;
             }
         }
-        else
-        {
-            _config.gas_save_opened = false;
-        }
         if(_config.gas_save != NULL)
         {
             // write header
             QTextStream stream(_config.gas_save);
-            stream << "APos 0;ANeg 0;BPos 0;BNeg 0;CPos 0;CNeg 0;DPos 0;DNeg 0";
-            for(qint32 i = 1; i < _gene->segments().size(); ++i)
+            for(qint32 i = 0; i < _network_size; ++i)
             {
-                stream << ";";
-                stream << "APos " << i << ";ANeg " << i
-                       << ";BPos " << i << ";BNeg " << i
-                       << ";CPos " << i << ";CNeg " << i
-                       << ";DPos " << i << ";DNeg " << i;
+                if(i != 0)
+                {
+                    stream << ";";
+                }
+                qint32 id = _neuron_ids[i];
+                stream << "APos " << id << ";ANeg " << id
+                       << ";BPos " << id << ";BNeg " << id
+                       << ";CPos " << id << ";CNeg " << id
+                       << ";DPos " << id << ";DNeg " << id;
             }
             stream << "\n";
         }
     }
 }
 
-void ModulatedSpikingNeuronsNetwork::_processInput(QList<double> input)
+void ModulatedSpikingNeuronsNetwork::_resetState()
 {
-    // Clear fire count
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
+        _network[i] = 0;
+        _gas_emitting[i] = 0;
+        _u[i] = 0;
         _firecount[i] = 0;
+        _spike_input[i] = 0;
+        _gas_applied[i] = 0;
     }
-
-    for(qint32 timesteps = 0; timesteps < 1.0 / _config.timestep_size; ++timesteps)
+    for(qint32 i = 0; i < 8 * _stride; ++i)
     {
-        double *newNetwork = new double[_gene->segments().size()];
-        double *newU = new double[_gene->segments().size()];
+        _gas[i] = 0;
+        _gas_sources[i] = 0;
+    }
+    _gas_update_count = 0;
+}
 
-        double gasAPos[_gene->segments().size()];
-        double gasANeg[_gene->segments().size()];
-        double gasBPos[_gene->segments().size()];
-        double gasBNeg[_gene->segments().size()];
-        double gasCPos[_gene->segments().size()];
-        double gasCNeg[_gene->segments().size()];
-        double gasDPos[_gene->segments().size()];
-        double gasDNeg[_gene->segments().size()];
+void ModulatedSpikingNeuronsNetwork::_processInput(const double *input)
+{
+    runTimesteps(input, _config.propagation);
+}
 
-        double a;
-        double b;
-        double c[_gene->segments().size()]; // This both parameter have to be cached
-        double d[_gene->segments().size()];
+void ModulatedSpikingNeuronsNetwork::runTimesteps(const double *input, Propagation propagation)
+{
+    // Clear fire count
+    for(qint32 i = 0; i < _network_size; ++i)
+    {
+        _firecount[i] = 0;
+    }
 
-        for(qint32 i = 0; i < _gene->segments().size(); ++i)
-        {
-            // Initiation
-            gasAPos[i] = 0;
-            gasANeg[i] = 0;
-            gasBPos[i] = 0;
-            gasBNeg[i] = 0;
-            gasCPos[i] = 0;
-            gasCNeg[i] = 0;
-            gasDPos[i] = 0;
-            gasDNeg[i] = 0;
-        }
+    // Gas concentrations are stored as one channel per gas
+    double *gasAPos = _gas;
+    double *gasANeg = _gas + _stride;
+    double *gasBPos = _gas + 2 * _stride;
+    double *gasBNeg = _gas + 3 * _stride;
+    double *gasCPos = _gas + 4 * _stride;
+    double *gasCNeg = _gas + 5 * _stride;
+    double *gasDPos = _gas + 6 * _stride;
+    double *gasDNeg = _gas + 7 * _stride;
+
+    const qint32 *basis_a = _basis_index.constData();
+    const qint32 *basis_b = basis_a + _network_size;
+    const qint32 *basis_c = basis_a + 2 * _network_size;
+    const qint32 *basis_d = basis_a + 3 * _network_size;
+
+    const qint32 *connection_start = _connection_start.constData();
+    const qint32 *connection_source = _connection_source.constData();
+    const double *connection_weight = _connection_weight.constData();
+    const qint32 *neuron_input = _input.constData();
 
+    for(qint32 timesteps = 0; timesteps < 1.0 / _config.timestep_size; ++timesteps)
+    {
         if(_emitting_possible)
         {
-            for(qint32 i = 0; i < _gene->segments().size(); ++i)
-            {
-                // Calculate gas concentration
-                if(_gas_emitting[i] > 0.0 && _TypeGas_list[_gene->segments()[i][gene_TypeGas]%_TypeGas_list.size()] != NoGas)
-                {
-                    double gas_radius = _config.offset_gas_radius + floatFromGeneInput( _gene->segments()[i][gene_Gas_radius], _config.range_gas_radius);
-                    for(qint32 j = 0; j < _gene->segments().size(); ++j)
-                    {
-                        if(_distances[i][j] > gas_radius)
-                        {
-                            continue;
-                        }
-                        double gas_concentration = qExp((-2 * _distances[i][j])/gas_radius) * _gas_emitting[i];
-                        switch(_TypeGas_list[_gene->segments()[i][gene_TypeGas]%_TypeGas_list.size()])
-                        {
-                        case NoGas:
-                            // No Gas is emitted
-                            break;
-
-                        case APositiv:
-                            gasAPos[j] += gas_concentration;
-                            break;
-
-                        case ANegativ:
-                            gasANeg[j] += gas_concentration;
-                            break;
-
-                        case BPositiv:
-                            gasBPos[j] += gas_concentration;
-                            break;
-
-                        case BNegativ:
-                            gasBNeg[j] += gas_concentration;
-                            break;
-
-                        case CPositiv:
-                            gasCPos[j] += gas_concentration;
-                            break;
-
-                        case CNegativ:
-                            gasCNeg[j] += gas_concentration;
-                            break;
-
-                        case DPositiv:
-                            gasDPos[j] += gas_concentration;
-                            break;
-
-                        case DNegativ:
-                            gasDNeg[j] += gas_concentration;
-                            break;
-
-                        default:
-                            QNN_WARNING_MSG("Unknown gas");
-                            break;
-                        }
-                    }
-                }
-            }
+            updateGasConcentration();
         }
 
         // write gas
@@ -572,7 +902,7 @@ void ModulatedSpikingNeuronsNetwork::_processInput(QList<double> input)
                    << gasBPos[0] << ";" << gasBNeg[0] << ";"
                    << gasCPos[0] << ";" << gasCNeg[0] << ";"
                    << gasDPos[0] << ";" << gasDNeg[0];
-            for(qint32 i = 1; i < _gene->segments().size(); ++i)
+            for(qint32 i = 1; i < _network_size; ++i)
             {
                 stream << ";";
                 stream << gasAPos[i] << ";" << gasANeg[i] << ";"
@@ -583,50 +913,75 @@ void ModulatedSpikingNeuronsNetwork::_processInput(QList<double> input)
             stream << "\n";
         }
 
-        for(qint32 i = 0; i < _gene->segments().size(); ++i)
+        // Calculate a,b,c,d. Only modulated parameters change
+        if(_config.a_modulated)
         {
-            // Calculate a,b,c,d
-            a = getModulatedValue(_config.a_modulated, gasAPos[i], gasANeg[i], _gene->segments()[i][gene_a]%_Pa.size(), _Pa);
-            b = getModulatedValue(_config.b_modulated, gasBPos[i], gasBNeg[i], _gene->segments()[i][gene_b]%_Pb.size(), _Pb);
-            c[i] = getModulatedValue(_config.c_modulated, gasCPos[i], gasCNeg[i], _gene->segments()[i][gene_c]%_Pc.size(), _Pc);
-            d[i] = getModulatedValue(_config.d_modulated, gasDPos[i], gasDNeg[i], _gene->segments()[i][gene_d]%_Pd.size(), _Pd);
-
-
-            // Calculate new input
+            for(qint32 i = 0; i < _network_size; ++i)
+            {
+                _a[i] = getModulatedValue(true, gasAPos[i], gasANeg[i], basis_a[i], _Pa);
+            }
+        }
+        if(_config.b_modulated)
+        {
+            for(qint32 i = 0; i < _network_size; ++i)
+            {
+                _b[i] = getModulatedValue(true, gasBPos[i], gasBNeg[i], basis_b[i], _Pb);
+            }
+        }
+        if(_config.c_modulated)
+        {
+            for(qint32 i = 0; i < _network_size; ++i)
+            {
+                _c[i] = getModulatedValue(true, gasCPos[i], gasCNeg[i], basis_c[i], _Pc);
+            }
+        }
+        if(_config.d_modulated)
+        {
+            for(qint32 i = 0; i < _network_size; ++i)
+            {
+                _d[i] = getModulatedValue(true, gasDPos[i], gasDNeg[i], basis_d[i], _Pd);
+            }
+        }
 
+        // Calculate new input
+        for(qint32 i = 0; i < _network_size; ++i)
+        {
             double newValue = 0;
 
             // Connections
-            for(qint32 j = 0; j < _gene->segments().size(); ++j)
+            if(propagation == dense_propagation)
             {
-                newValue += _network[j] * _weights[j][i];
+                for(qint32 j = connection_start[i]; j < connection_start[i+1]; ++j)
+                {
+                    newValue += _network[connection_source[j]] * connection_weight[j];
+                }
+            }
+            else
+            {
+                // Spikes of the last timestep
+                newValue += _spike_input[i];
+                _spike_input[i] = 0;
             }
 
             // Input
-            if(_gene->segments()[i][gene_input]%(_len_input+1) != 0)
+            if(neuron_input[i] != -1)
             {
-                newValue += input[_gene->segments()[i][gene_input]%(_len_input+1)-1];
+                newValue += input[neuron_input[i]];
             }
 
-            // Calculate potential
-            newNetwork[i] = _network[i] + (0.04 * _network[i] * _network[i] + 5.0 * _network[i] + 140.0 - _u[i] + newValue);
-
-            // Calculate U
-            newU[i] = _u[i] + (a * (b * _network[i] - _u[i]));
+            _synaptic_input[i] = newValue;
         }
 
-        delete [] _network;
-        _network = newNetwork;
-        delete [] _u;
-        _u = newU;
+        // The membrane update does not depend on other neurons and is done in one sweep
+        izhikevichStep(_network, _u, _a, _b, _synaptic_input, _stride);
 
         if(_emitting_possible)
         {
-            for(qint32 i = 0; i < _gene->segments().size(); ++i)
+            for(qint32 i = 0; i < _network_size; ++i)
             {
                 // Calculate emition of gas
                 bool emittingGas = false;
-                switch(_WhenGas_list[_gene->segments()[i][gene_WhenGas]%_WhenGas_list.size()])
+                switch(_WhenGas_list[_gene->segment(_neuron_ids[i])[gene_WhenGas]%_WhenGas_list.size()])
                 {
                 case ElectricCharge:
                     if(_network[i] > _config.electric_threshhold)
@@ -698,11 +1053,11 @@ void ModulatedSpikingNeuronsNetwork::_processInput(QList<double> input)
 
                 if(emittingGas)
                 {
-                    _gas_emitting[i] = cut01(_gas_emitting[i] + 1.0 / (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segments()[i][gene_Rate_of_gas], _config.range_rate_of_gas)));
+                    _gas_emitting[i] = cut01(_gas_emitting[i] + 1.0 / (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_Rate_of_gas], _config.range_rate_of_gas)));
                 }
                 else
                 {
-                    _gas_emitting[i] = cut01(_gas_emitting[i] - 1.0 / (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segments()[i][gene_Rate_of_gas], _config.range_rate_of_gas)));
+                    _gas_emitting[i] = cut01(_gas_emitting[i] - 1.0 / (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_Rate_of_gas], _config.range_rate_of_gas)));
                 }
             }
         }
@@ -712,7 +1067,7 @@ void ModulatedSpikingNeuronsNetwork::_processInput(QList<double> input)
         {
             QTextStream stream(_config.neuron_save);
             stream << _network[0];
-            for(qint32 i = 1; i < _gene->segments().size(); ++i)
+            for(qint32 i = 1; i < _network_size; ++i)
             {
                 stream << ";";
                 stream << _network[i];
@@ -720,23 +1075,30 @@ void ModulatedSpikingNeuronsNetwork::_processInput(QList<double> input)
             stream << "\n";
         }
 
-        for(qint32 i = 0; i < _gene->segments().size(); ++i)
+        if(propagation == event_propagation)
         {
-            // Check if fired
-            if(_network[i] >= 30.0)
+            // Send spikes of all neurons which are going to fire
+            for(qint32 i = 0; i < _network_size; ++i)
             {
-                _network[i] = c[i];
-                _u[i] = _u[i] + d[i];
-                ++_firecount[i];
+                if(_network[i] >= 30.0)
+                {
+                    for(qint32 j = _outgoing_start[i]; j < _outgoing_start[i+1]; ++j)
+                    {
+                        _spike_input[_outgoing_target[j]] += _outgoing_weight[j] * SPIKE_INPUT;
+                    }
+                }
             }
         }
 
+        // Check if fired
+        izhikevichFire(_network, _u, _c, _d, _firecount, _stride);
+
         // write output after fire
         if(_config.neuron_save != NULL)
         {
             QTextStream stream(_config.neuron_save);
             stream << _network[0];
-            for(qint32 i = 1; i < _gene->segments().size(); ++i)
+            for(qint32 i = 1; i < _network_size; ++i)
             {
                 stream << ";";
                 stream << _network[i];
@@ -746,6 +1108,110 @@ void ModulatedSpikingNeuronsNetwork::_processInput(QList<double> input)
     }
 }
 
+void ModulatedSpikingNeuronsNetwork::updateGasConcentration()
+{
+    const qint32 *gas_start = _gas_start.constData();
+    const qint32 *gas_target = _gas_target.constData();
+    const double *gas_coefficient = _gas_coefficient.constData();
+    qint32 *gas_sources = _gas_sources.data();
+
+    if(_gas_update_count == 0)
+    {
+        // Full recalculation
+        for(qint32 i = 0; i < 8 * _stride; ++i)
+        {
+            _gas[i] = 0;
+            gas_sources[i] = 0;
+        }
+
+        for(qint32 i = 0; i < _network_size; ++i)
+        {
+            _gas_applied[i] = _gas_emitting[i];
+            if(_gas_emitting[i] > 0.0 && _gas_channel[i] != -1)
+            {
+                double *gas = _gas + _gas_channel[i] * _stride;
+                qint32 *sources = gas_sources + _gas_channel[i] * _stride;
+                for(qint32 k = gas_start[i]; k < gas_start[i+1]; ++k)
+                {
+                    gas[gas_target[k]] += gas_coefficient[k] * _gas_emitting[i];
+                    ++sources[gas_target[k]];
+                }
+            }
+        }
+    }
+    else
+    {
+        // Only apply the change of the emission since the last update
+        for(qint32 i = 0; i < _network_size; ++i)
+        {
+            if(_gas_emitting[i] == _gas_applied[i] || _gas_channel[i] == -1)
+            {
+                continue;
+            }
+
+            double *gas = _gas + _gas_channel[i] * _stride;
+            qint32 *sources = gas_sources + _gas_channel[i] * _stride;
+            double delta = _gas_emitting[i] - _gas_applied[i];
+            bool started = _gas_applied[i] == 0.0;
+            bool stopped = _gas_emitting[i] == 0.0;
+            for(qint32 k = gas_start[i]; k < gas_start[i+1]; ++k)
+            {
+                qint32 j = gas_target[k];
+                gas[j] += gas_coefficient[k] * delta;
+                if(started)
+                {
+                    ++sources[j];
+                }
+                else if(stopped && --sources[j] == 0)
+                {
+                    // Remove rounding errors so that a neuron without gas sees exactly 0
+                    gas[j] = 0;
+                }
+            }
+            _gas_applied[i] = _gas_emitting[i];
+        }
+    }
+
+    _gas_update_count = (_gas_update_count + 1) % _config.gas_update_interval;
+}
+
+double ModulatedSpikingNeuronsNetwork::propagationError(const double *inputs, qint32 samples)
+{
+    if(Q_UNLIKELY(_gene == NULL))
+    {
+        QNN_FATAL_MSG("Network not initialised");
+    }
+    if(Q_UNLIKELY(inputs == NULL || samples < 0))
+    {
+        QNN_CRITICAL_MSG("Invalid samples");
+        return -1.0;
+    }
+
+    // The state depends on all previous inputs, so each propagation processes the whole sequence
+    QVector<double> reference(samples * _len_output);
+    _resetState();
+    for(qint32 sample = 0; sample < samples; ++sample)
+    {
+        runTimesteps(inputs + sample * _len_input, dense_propagation);
+        _getOutputs(reference.data() + sample * _len_output);
+    }
+
+    double output[_len_output];
+    double max_error = 0.0;
+    _resetState();
+    for(qint32 sample = 0; sample < samples; ++sample)
+    {
+        runTimesteps(inputs + sample * _len_input, _config.propagation);
+        _getOutputs(output);
+        for(qint32 i = 0; i < _len_output; ++i)
+        {
+            max_error = qMax(max_error, qAbs(output[i] - reference[sample * _len_output + i]));
+        }
+    }
+    _resetState();
+    return max_error;
+}
+
 double ModulatedSpikingNeuronsNetwork::_getNeuronOutput(qint32 i)
 {
     if(Q_LIKELY(i >= 0 && i < _len_output))
@@ -759,6 +1225,14 @@ double ModulatedSpikingNeuronsNetwork::_getNeuronOutput(qint32 i)
     }
 }
 
+void ModulatedSpikingNeuronsNetwork::_getOutputs(double *output)
+{
+    for(qint32 i = 0; i < _len_output; ++i)
+    {
+        output[i] = _firecount[i] * _config.timestep_size;
+    }
+}
+
 bool ModulatedSpikingNeuronsNetwork::_saveNetworkConfig(QXmlStreamWriter *stream)
 {
     QMap<QString, QVariant> network_config;
@@ -774,26 +1248,29 @@ bool ModulatedSpikingNeuronsNetwork::_saveNetworkConfig(QXmlStreamWriter *stream
     network_config["range_rate_of_gas"] = _config.range_rate_of_gas;
     network_config["min_size"] = _config.min_size;
     network_config["max_size"] = _config.max_size;
+    network_config["prune_neurons"] = _config.prune_neurons;
     network_config["a_modulated"] = _config.a_modulated;
     network_config["b_modulated"] = _config.b_modulated;
     network_config["c_modulated"] = _config.c_modulated;
     network_config["d_modulated"] = _config.d_modulated;
     network_config["timestep_size"] = _config.timestep_size;
+    network_config["gas_update_interval"] = _config.gas_update_interval;
+    network_config["propagation"] = _config.propagation == dense_propagation ? "dense" : "event";
 
     writeConfigStart("ModulatedSpikingNeuronsNetwork", network_config, stream);
 
     // Gas concentration
 
-    double gasAPos[_gene->segments().size()];
-    double gasANeg[_gene->segments().size()];
-    double gasBPos[_gene->segments().size()];
-    double gasBNeg[_gene->segments().size()];
-    double gasCPos[_gene->segments().size()];
-    double gasCNeg[_gene->segments().size()];
-    double gasDPos[_gene->segments().size()];
-    double gasDNeg[_gene->segments().size()];
+    double gasAPos[_network_size];
+    double gasANeg[_network_size];
+    double gasBPos[_network_size];
+    double gasBNeg[_network_size];
+    double gasCPos[_network_size];
+    double gasCNeg[_network_size];
+    double gasDPos[_network_size];
+    double gasDNeg[_network_size];
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
         // Initiation
         gasAPos[i] = 0;
@@ -808,20 +1285,17 @@ bool ModulatedSpikingNeuronsNetwork::_saveNetworkConfig(QXmlStreamWriter *stream
 
     if(_emitting_possible)
     {
-        for(qint32 i = 0; i < _gene->segments().size(); ++i)
+        for(qint32 i = 0; i < _network_size; ++i)
         {
             // Calculate gas concentration
-            if(_gas_emitting[i] > 0.0 && _TypeGas_list[_gene->segments()[i][gene_TypeGas]%_TypeGas_list.size()] != NoGas)
+            if(_gas_emitting[i] > 0.0 && _TypeGas_list[_gene->segment(_neuron_ids[i])[gene_TypeGas]%_TypeGas_list.size()] != NoGas)
             {
-                double gas_radius = _config.offset_gas_radius + floatFromGeneInput( _gene->segments()[i][gene_Gas_radius], _config.range_gas_radius);
-                for(qint32 j = 0; j < _gene->segments().size(); ++j)
+                // Only neurons inside the gas radius are stored
+                for(qint32 k = _gas_start[i]; k < _gas_start[i+1]; ++k)
                 {
-                    if(_distances[i][j] > gas_radius)
-                    {
-                        continue;
-                    }
-                    double gas_concentration = qExp((-2 * _distances[i][j])/gas_radius) * _gas_emitting[i];
-                    switch(_TypeGas_list[_gene->segments()[i][gene_TypeGas]%_TypeGas_list.size()])
+                    qint32 j = _gas_target[k];
+                    double gas_concentration = _gas_coefficient[k] * _gas_emitting[i];
+                    switch(_TypeGas_list[_gene->segment(_neuron_ids[i])[gene_TypeGas]%_TypeGas_list.size()])
                     {
                     case NoGas:
                         // No Gas is emitted
@@ -870,19 +1344,19 @@ bool ModulatedSpikingNeuronsNetwork::_saveNetworkConfig(QXmlStreamWriter *stream
 
     // Write neuron config
 
-    for(qint32 i = 0; i < _gene->segments().size(); ++i)
+    for(qint32 i = 0; i < _network_size; ++i)
     {
         QMap<QString, QVariant> config_neuron;
         QMap<qint32, double> connections_neuron;
 
-        config_neuron["pos_x"] = floatFromGeneInput(_gene->segments()[i][gene_x], _config.area_size);
-        config_neuron["pos_y"] = floatFromGeneInput(_gene->segments()[i][gene_y], _config.area_size);
-        config_neuron["positiv_cone_radius"] = floatFromGeneInput(_gene->segments()[i][gene_PositivConeRadius], _config.area_size*_config.cone_ratio);
-        config_neuron["positiv_cone_extension"] = floatFromGeneInput(_gene->segments()[i][gene_PositivConeExt], 2*M_PI);
-        config_neuron["positiv_cone_orientation"] = floatFromGeneInput(_gene->segments()[i][gene_PositivConeOrientation], 2*M_PI);
-        config_neuron["negativ_cone_radius"] = floatFromGeneInput(_gene->segments()[i][gene_NegativConeRadius], _config.area_size*_config.cone_ratio);
-        config_neuron["negativ_cone_extension"] = floatFromGeneInput(_gene->segments()[i][gene_NegativConeExt], 2*M_PI);
-        config_neuron["negativ_cone_orientation"] = floatFromGeneInput(_gene->segments()[i][gene_NegativConeOrientation], 2*M_PI);
+        config_neuron["pos_x"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_x], _config.area_size);
+        config_neuron["pos_y"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_y], _config.area_size);
+        config_neuron["positiv_cone_radius"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_PositivConeRadius], _config.area_size*_config.cone_ratio);
+        config_neuron["positiv_cone_extension"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_PositivConeExt], 2*M_PI);
+        config_neuron["positiv_cone_orientation"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_PositivConeOrientation], 2*M_PI);
+        config_neuron["negativ_cone_radius"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_NegativConeRadius], _config.area_size*_config.cone_ratio);
+        config_neuron["negativ_cone_extension"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_NegativConeExt], 2*M_PI);
+        config_neuron["negativ_cone_orientation"] = floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_NegativConeOrientation], 2*M_PI);
         config_neuron["gasAPos_concentration"] = gasAPos[i];
         config_neuron["gasBPos_concentration"] = gasBPos[i];
         config_neuron["gasCPos_concentration"] = gasCPos[i];
@@ -892,14 +1366,14 @@ bool ModulatedSpikingNeuronsNetwork::_saveNetworkConfig(QXmlStreamWriter *stream
         config_neuron["gasCNeg_concentration"] = gasCNeg[i];
         config_neuron["gasDNeg_concentration"] = gasDNeg[i];
 
-        if(_gene->segments()[i][gene_input]%(_len_input+1) != 0)
+        if(_gene->segment(_neuron_ids[i])[gene_input]%(_len_input+1) != 0)
         {
-            config_neuron["input"] = _gene->segments()[i][gene_input]%(_len_input+1)-1;
+            config_neuron["input"] = _gene->segment(_neuron_ids[i])[gene_input]%(_len_input+1)-1;
         }
 
         if(_emitting_possible)
         {
-            switch(_WhenGas_list[_gene->segments()[i][gene_WhenGas]%_WhenGas_list.size()])
+            switch(_WhenGas_list[_gene->segment(_neuron_ids[i])[gene_WhenGas]%_WhenGas_list.size()])
             {
             case ElectricCharge:
                 config_neuron["when_gas_emitting"] = "electric charge";
@@ -942,7 +1416,7 @@ bool ModulatedSpikingNeuronsNetwork::_saveNetworkConfig(QXmlStreamWriter *stream
                 break;
             }
 
-            switch(_TypeGas_list[_gene->segments()[i][gene_TypeGas]%_TypeGas_list.size()])
+            switch(_TypeGas_list[_gene->segment(_neuron_ids[i])[gene_TypeGas]%_TypeGas_list.size()])
             {
             case NoGas:
                 config_neuron["gas_type"] = "No gas";
@@ -991,28 +1465,25 @@ bool ModulatedSpikingNeuronsNetwork::_saveNetworkConfig(QXmlStreamWriter *stream
             config_neuron["when_gas_emitting"] = "Not emitting";
         }
 
-        config_neuron["rate_of_gas"] = (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segments()[i][gene_Rate_of_gas], _config.range_rate_of_gas));
-        config_neuron["gas_radius"] = _config.offset_gas_radius + floatFromGeneInput( _gene->segments()[i][gene_Gas_radius], _config.range_gas_radius);
-        config_neuron["a_basis"] = _Pa[_gene->segments()[i][gene_a]%_Pa.size()];
-        config_neuron["b_basis"] = _Pb[_gene->segments()[i][gene_b]%_Pb.size()];
-        config_neuron["c_basis"] = _Pc[_gene->segments()[i][gene_c]%_Pc.size()];
-        config_neuron["d_basis"] = _Pd[_gene->segments()[i][gene_d]%_Pd.size()];
-        config_neuron["a_modulated"] = getModulatedValue(_config.a_modulated, gasAPos[i], gasANeg[i], _gene->segments()[i][gene_a]%_Pa.size(), _Pa);
-        config_neuron["b_modulated"] = getModulatedValue(_config.b_modulated, gasBPos[i], gasBNeg[i], _gene->segments()[i][gene_b]%_Pb.size(), _Pb);
-        config_neuron["c_modulated"] = getModulatedValue(_config.c_modulated, gasCPos[i], gasCNeg[i], _gene->segments()[i][gene_c]%_Pc.size(), _Pc);
-        config_neuron["d_modulated"] = getModulatedValue(_config.d_modulated, gasDPos[i], gasDNeg[i], _gene->segments()[i][gene_d]%_Pd.size(), _Pd);
+        config_neuron["rate_of_gas"] = (_config.offset_rate_of_gas + floatFromGeneInput(_gene->segment(_neuron_ids[i])[gene_Rate_of_gas], _config.range_rate_of_gas));
+        config_neuron["gas_radius"] = _config.offset_gas_radius + floatFromGeneInput( _gene->segment(_neuron_ids[i])[gene_Gas_radius], _config.range_gas_radius);
+        config_neuron["a_basis"] = _Pa[_gene->segment(_neuron_ids[i])[gene_a]%_Pa.size()];
+        config_neuron["b_basis"] = _Pb[_gene->segment(_neuron_ids[i])[gene_b]%_Pb.size()];
+        config_neuron["c_basis"] = _Pc[_gene->segment(_neuron_ids[i])[gene_c]%_Pc.size()];
+        config_neuron["d_basis"] = _Pd[_gene->segment(_neuron_ids[i])[gene_d]%_Pd.size()];
+        config_neuron["a_modulated"] = getModulatedValue(_config.a_modulated, gasAPos[i], gasANeg[i], _gene->segment(_neuron_ids[i])[gene_a]%_Pa.size(), _Pa);
+        config_neuron["b_modulated"] = getModulatedValue(_config.b_modulated, gasBPos[i], gasBNeg[i], _gene->segment(_neuron_ids[i])[gene_b]%_Pb.size(), _Pb);
+        config_neuron["c_modulated"] = getModulatedValue(_config.c_modulated, gasCPos[i], gasCNeg[i], _gene->segment(_neuron_ids[i])[gene_c]%_Pc.size(), _Pc);
+        config_neuron["d_modulated"] = getModulatedValue(_config.d_modulated, gasDPos[i], gasDNeg[i], _gene->segment(_neuron_ids[i])[gene_d]%_Pd.size(), _Pd);
         config_neuron["internal_charge"] = _network[i];
         config_neuron["fire_output"] = _firecount[i] * _config.timestep_size;
 
-        for(qint32 j = 0; j < _gene->segments().size(); ++j)
+        for(qint32 j = _connection_start[i]; j < _connection_start[i+1]; ++j)
         {
-            if(_weights[j][i] != 0)
-            {
-                connections_neuron[j] = _weights[j][i];
-            }
+            connections_neuron[_neuron_ids[_connection_source[j]]] = _connection_weight[j];
         }
 
-        writeConfigNeuron(i, config_neuron, connections_neuron, stream);
+        writeConfigNeuron(_neuron_ids[i], config_neuron, connections_neuron, stream);
     }
 
     writeConfigEnd(stream);
@@ -23,6 +23,8 @@
 
 #include "abstractneuralnetwork.h"
 
+#include <QVector>
+
 /*!
  * \brief The ModulatedSpikingNeuronsNetwork class represents a modulated spiking-neurons network, a combination of GasNets and spiking neurons.
  *
@@ -36,6 +38,29 @@ class QNNSHARED_EXPORT ModulatedSpikingNeuronsNetwork : public AbstractNeuralNet
 {
 public:
 
+    /*!
+     * \brief Method used to propagate the activity of a neuron to the connected neurons
+     */
+    enum Propagation {
+        /*!
+         * \brief In every timestep each neuron receives the membrane potential of all connected neurons multiplied by the weight of the connection
+         */
+        dense_propagation,
+
+        /*!
+         * \brief A neuron only sends input to the connected neurons when it fires.
+         * The connected neurons receive SPIKE_INPUT multiplied by the weight of the connection in the next timestep.
+         *
+         * This is a different neuron model than dense_propagation, so networks evolved with one method will behave differently with the other.
+         */
+        event_propagation
+    };
+
+    /*!
+     * \brief Input a connection with weight 1 transmits when the source neuron fires in event_propagation
+     */
+    static const double SPIKE_INPUT;
+
     /*!
      * \brief This struct contains all configuration option of MSNNs
      */
@@ -124,6 +149,30 @@ public:
          * The range should be (0,1]
          */
         double timestep_size;
+        /*!
+         * \brief propagation sets how the activity of neurons is transmitted over the connections.
+         *
+         * event_propagation only needs work for firing neurons, which is much faster for sparse firing networks.
+         * Use propagationError to compare it with dense_propagation for a network.
+         */
+        Propagation propagation;
+        /*!
+         * \brief gas_update_interval sets after how many timesteps the gas concentration is calculated from scratch.
+         *
+         * In the other timesteps only the change of the emission is applied to the concentration,
+         * which is faster but accumulates rounding errors. 1 calculates the concentration from scratch in every timestep
+         * and gives the exact result of the full calculation.
+         * The rounding errors can flip gas thresholds, so values greater than 1 may change results slightly.
+         * 100 is recommended if speed matters more than reproducibility.
+         */
+        qint32 gas_update_interval;
+        /*!
+         * \brief If prune_neurons is true only neurons which can influence the output are simulated.
+         *
+         * Neurons influence each other through connections and gas. Pruning does not change the output of the network.
+         * Traces and saved configurations only contain the simulated neurons, identified by their position in the gene.
+         */
+        bool prune_neurons;
 
         /*!
          * \brief If neuron_save is not NULL the value of the neurons will be saved to the QIODevice
@@ -175,6 +224,9 @@ public:
             c_modulated(false),
             d_modulated(true),
             timestep_size(0.1),
+            propagation(dense_propagation),
+            gas_update_interval(1),
+            prune_neurons(false),
             neuron_save(NULL),
             neuron_save_opened(false),
             gas_save(NULL),
@@ -208,6 +260,17 @@ public:
      */
     AbstractNeuralNetwork *createConfigCopy();
 
+    /*!
+     * \brief Compares the configured propagation with dense_propagation.
+     *
+     * The samples are processed as a sequence starting from a reset network, once with each propagation. The state of the network is reset afterwards.
+     *
+     * \param inputs Row-major inputs. Must hold samples * len_input values
+     * \param samples Number of samples
+     * \return Maximum absolute difference of an output between configured propagation and dense_propagation. -1 on error
+     */
+    double propagationError(const double *inputs, qint32 samples);
+
 protected:
     /*!
      * \brief Empty constructor
@@ -261,16 +324,38 @@ protected:
                     DNegativ,
                     NoGas};
 
+    /*!
+     * \brief Frees all buffers allocated in _initialise.
+     */
+    void deleteBuffers();
+
     /*!
      * \brief Overwritten function to initialise the network.
      */
     void _initialise();
 
+    /*!
+     * \brief Overwritten function to reset the dynamic state of the network.
+     */
+    void _resetState();
+
     /*!
      * \brief Overwritten method to process input
      * \param input Input to process
      */
-    void _processInput(QList<double> input);
+    void _processInput(const double *input);
+
+    /*!
+     * \brief Processes one input with all timesteps
+     * \param input Input to process
+     * \param propagation Propagation used for the connections
+     */
+    void runTimesteps(const double *input, Propagation propagation);
+
+    /*!
+     * \brief Brings the gas concentration in _gas up to date with the current emission
+     */
+    void updateGasConcentration();
 
     /*!
      * \brief Overwritten function to get output
@@ -279,6 +364,12 @@ protected:
      */
     double _getNeuronOutput(qint32 i);
 
+    /*!
+     * \brief Overwritten function to get the output of all output neurons
+     * \param output Pointer to which the output is written
+     */
+    void _getOutputs(double *output);
+
     /*!
      * \brief Overwritten function to save network config
      * \param stream Stream to save config to. Stream is guaranteed to be a valid pointer
@@ -292,7 +383,10 @@ protected:
     config _config;
 
     /*!
-     * \brief Holds the values for the v parameter at timestep t
+     * \brief Holds the values for the v parameter at timestep t.
+     *
+     * All buffers of the neurons are aligned and padded with VectorFunctions::paddedLength so that the timesteps can be calculated with vector instructions.
+     * The padding values are not part of the network.
      */
     double *_network;
 
@@ -312,14 +406,143 @@ protected:
     double *_firecount;
 
     /*!
-     * \brief Holds precalculated distances
+     * \brief Index of the first incoming connection of each neuron in _connection_source / _connection_weight.
+     *
+     * The incoming connections of neuron i are stored from _connection_start[i] to _connection_start[i+1]-1 (compressed sparse row format).
+     */
+    QVector<qint32> _connection_start;
+
+    /*!
+     * \brief Source neuron of each connection
+     */
+    QVector<qint32> _connection_source;
+
+    /*!
+     * \brief Weight of each connection. Connections with weight 0 are not stored
+     */
+    QVector<double> _connection_weight;
+
+    /*!
+     * \brief Index of the first neighbour of each neuron in _gas_target / _gas_coefficient.
+     *
+     * The neighbours of neuron i which are reached by its gas are stored from _gas_start[i] to _gas_start[i+1]-1.
+     * Neurons which do not emit any gas have no neighbours.
+     */
+    QVector<qint32> _gas_start;
+
+    /*!
+     * \brief Neuron reached by the gas
+     */
+    QVector<qint32> _gas_target;
+
+    /*!
+     * \brief Concentration of the gas at the target neuron if the source emits with strength 1
+     */
+    QVector<double> _gas_coefficient;
+
+    /*!
+     * \brief Index of the first outgoing connection of each neuron in _outgoing_target / _outgoing_weight.
+     *
+     * Used by event_propagation to send the spikes of a neuron.
+     */
+    QVector<qint32> _outgoing_start;
+
+    /*!
+     * \brief Target neuron of each outgoing connection
+     */
+    QVector<qint32> _outgoing_target;
+
+    /*!
+     * \brief Weight of each outgoing connection
+     */
+    QVector<double> _outgoing_weight;
+
+    /*!
+     * \brief Input received by spikes which will be applied in the next timestep (event_propagation only)
+     */
+    double *_spike_input;
+
+    /*!
+     * \brief Current a parameter of all neurons
+     */
+    double *_a;
+
+    /*!
+     * \brief Current b parameter of all neurons
+     */
+    double *_b;
+
+    /*!
+     * \brief Current c parameter of all neurons
+     */
+    double *_c;
+
+    /*!
+     * \brief Current d parameter of all neurons
+     */
+    double *_d;
+
+    /*!
+     * \brief Input of all neurons in the current timestep
+     */
+    double *_synaptic_input;
+
+    /*!
+     * \brief Gas concentration at all neurons.
+     *
+     * Holds one channel of _stride values for each gas in the order APos, ANeg, BPos, BNeg, CPos, CNeg, DPos, DNeg.
+     */
+    double *_gas;
+
+    /*!
+     * \brief Emission of all neurons which is contained in _gas
+     */
+    double *_gas_applied;
+
+    /*!
+     * \brief Number of emitting neurons which reach a neuron, with the same layout as _gas
+     */
+    QVector<qint32> _gas_sources;
+
+    /*!
+     * \brief Channel of _gas the neurons emit to. -1 if the neuron does not emit gas
+     */
+    QVector<qint32> _gas_channel;
+
+    /*!
+     * \brief Number of timesteps since the gas concentration was calculated from scratch, modulo gas_update_interval
+     */
+    qint32 _gas_update_count;
+
+    /*!
+     * \brief Decoded index into the P arrays of all neurons.
+     *
+     * Holds the indices for a, b, c and d one after another, each with one value per neuron.
+     */
+    QVector<qint32> _basis_index;
+
+    /*!
+     * \brief Decoded input of all neurons. -1 if the neuron gets no input
+     */
+    QVector<qint32> _input;
+
+    /*!
+     * \brief Position in the gene of each simulated neuron.
+     *
+     * All other members use the index of the simulated neuron. Without pruning all neurons are simulated in gene order.
+     * The output neurons are always the first simulated neurons.
+     */
+    QVector<qint32> _neuron_ids;
+
+    /*!
+     * \brief Number of simulated neurons the buffers have been allocated for
      */
-    double **_distances;
+    qint32 _network_size;
 
     /*!
-     * \brief Holds precalculated weights
+     * \brief Padded length of all neuron buffers
      */
-    double **_weights;
+    qint32 _stride;
 
     /*!
      * \brief P array for a variable as defined by Bruhns
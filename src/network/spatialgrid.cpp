@@ -0,0 +1,140 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "spatialgrid.h"
+
+#include "commonnetworkfunctions.h"
+
+#include <QtCore/qmath.h>
+#include <QtAlgorithms>
+
+using CommonNetworkFunctions::calculateDistance;
+
+SpatialGrid::SpatialGrid() :
+    _x(),
+    _y(),
+    _cell_start(),
+    _cell_points(),
+    _min_x(0.0),
+    _min_y(0.0),
+    _cell_size(1.0),
+    _columns(1),
+    _rows(1)
+{
+}
+
+void SpatialGrid::build(const double *x, const double *y, qint32 size, double max_radius)
+{
+    _x.resize(size);
+    _y.resize(size);
+    _min_x = 0.0;
+    _min_y = 0.0;
+    double max_x = 0.0;
+    double max_y = 0.0;
+    for(qint32 i = 0; i < size; ++i)
+    {
+        _x[i] = x[i];
+        _y[i] = y[i];
+        if(i == 0 || x[i] < _min_x)
+        {
+            _min_x = x[i];
+        }
+        if(i == 0 || y[i] < _min_y)
+        {
+            _min_y = y[i];
+        }
+        if(i == 0 || x[i] > max_x)
+        {
+            max_x = x[i];
+        }
+        if(i == 0 || y[i] > max_y)
+        {
+            max_y = y[i];
+        }
+    }
+
+    // Cells should be as large as the search radius so that a search only visits the neighbouring cells.
+    // The number of cells is limited to about the number of points to keep the grid small for tiny radii.
+    double extent = qMax(max_x - _min_x, max_y - _min_y);
+    qint32 max_cells = qMax(1, qCeil(qSqrt(size)));
+    _cell_size = qMax(max_radius, extent / max_cells);
+    if(_cell_size <= 0.0)
+    {
+        _cell_size = 1.0;
+    }
+    _columns = qMin(max_cells, qFloor((max_x - _min_x) / _cell_size) + 1);
+    _rows = qMin(max_cells, qFloor((max_y - _min_y) / _cell_size) + 1);
+
+    // Counting sort of the points into the cells. Points are inserted in ascending order
+    _cell_start.fill(0, _columns * _rows + 1);
+    for(qint32 i = 0; i < size; ++i)
+    {
+        ++_cell_start[cellY(y[i]) * _columns + cellX(x[i]) + 1];
+    }
+    for(qint32 cell = 0; cell < _columns * _rows; ++cell)
+    {
+        _cell_start[cell+1] += _cell_start[cell];
+    }
+    _cell_points.resize(size);
+    QVector<qint32> insert_position(_cell_start);
+    for(qint32 i = 0; i < size; ++i)
+    {
+        _cell_points[insert_position[cellY(y[i]) * _columns + cellX(x[i])]++] = i;
+    }
+}
+
+void SpatialGrid::neighbours(double x, double y, double radius, QVector<qint32> *result) const
+{
+    result->clear();
+
+    qint32 first_column = cellX(x - radius);
+    qint32 last_column = cellX(x + radius);
+    qint32 first_row = cellY(y - radius);
+    qint32 last_row = cellY(y + radius);
+
+    for(qint32 row = first_row; row <= last_row; ++row)
+    {
+        for(qint32 column = first_column; column <= last_column; ++column)
+        {
+            qint32 cell = row * _columns + column;
+            for(qint32 i = _cell_start[cell]; i < _cell_start[cell+1]; ++i)
+            {
+                qint32 point = _cell_points[i];
+                if(calculateDistance(x, y, _x[point], _y[point]) <= radius)
+                {
+                    result->append(point);
+                }
+            }
+        }
+    }
+
+    qSort(result->begin(), result->end());
+}
+
+qint32 SpatialGrid::cellX(double x) const
+{
+    qint32 column = qFloor((x - _min_x) / _cell_size);
+    return qBound(0, column, _columns - 1);
+}
+
+qint32 SpatialGrid::cellY(double y) const
+{
+    qint32 row = qFloor((y - _min_y) / _cell_size);
+    return qBound(0, row, _rows - 1);
+}
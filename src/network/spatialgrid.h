@@ -0,0 +1,124 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#ifndef SPATIALGRID_H
+#define SPATIALGRID_H
+
+#include <qnn-global.h>
+
+#include <QVector>
+
+/*!
+ * \brief The SpatialGrid class is a uniform grid over a set of 2D points which allows to find all points inside a radius without testing all points.
+ *
+ * The points are identified by their index. Neighbours are always returned in ascending order so that callers can keep the summation order of a full search.
+ */
+class QNNSHARED_EXPORT SpatialGrid
+{
+public:
+    /*!
+     * \brief Constructor
+     */
+    SpatialGrid();
+
+    /*!
+     * \brief Builds the grid for a new set of points
+     * \param x X coordinates of the points
+     * \param y Y coordinates of the points
+     * \param size Number of points
+     * \param max_radius Largest radius which will be used in neighbours(). It is used to select the size of the cells
+     */
+    void build(const double *x, const double *y, qint32 size, double max_radius);
+
+    /*!
+     * \brief Finds all points which are inside a radius around a position
+     *
+     * A point is inside the radius if CommonNetworkFunctions::calculateDistance(x, y, point_x, point_y) <= radius.
+     *
+     * \param x X coordinate of the position
+     * \param y Y coordinate of the position
+     * \param radius Radius to search
+     * \param result Indices of the points in ascending order. Previous content is removed
+     */
+    void neighbours(double x, double y, double radius, QVector<qint32> *result) const;
+
+private:
+    /*!
+     * \brief Returns the cell column of an x coordinate. Coordinates outside the grid are clamped to the border cells
+     * \param x X coordinate
+     * \return Column of the cell
+     */
+    qint32 cellX(double x) const;
+
+    /*!
+     * \brief Returns the cell row of an y coordinate. Coordinates outside the grid are clamped to the border cells
+     * \param y Y coordinate
+     * \return Row of the cell
+     */
+    qint32 cellY(double y) const;
+
+    /*!
+     * \brief X coordinates of the points
+     */
+    QVector<double> _x;
+
+    /*!
+     * \brief Y coordinates of the points
+     */
+    QVector<double> _y;
+
+    /*!
+     * \brief Index of the first point of each cell in _cell_points.
+     *
+     * The points of cell c are stored from _cell_start[c] to _cell_start[c+1]-1.
+     */
+    QVector<qint32> _cell_start;
+
+    /*!
+     * \brief Points sorted by cell. Inside a cell the points are sorted ascending
+     */
+    QVector<qint32> _cell_points;
+
+    /*!
+     * \brief Smallest x coordinate of all points
+     */
+    double _min_x;
+
+    /*!
+     * \brief Smallest y coordinate of all points
+     */
+    double _min_y;
+
+    /*!
+     * \brief Edge length of a cell
+     */
+    double _cell_size;
+
+    /*!
+     * \brief Number of cells in x direction
+     */
+    qint32 _columns;
+
+    /*!
+     * \brief Number of cells in y direction
+     */
+    qint32 _rows;
+};
+
+#endif // SPATIALGRID_H
@@ -0,0 +1,366 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "vectorfunctions.h"
+
+#include <cstring>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace VectorFunctions {
+qint32 paddedLength(qint32 length, qint32 lanes)
+{
+    return (length + lanes - 1) / lanes * lanes;
+}
+
+double *allocateDoubles(qint32 length)
+{
+    qint32 size = qMax(paddedLength(length), DOUBLE_LANES);
+    double *vector = static_cast<double *>(qMallocAligned(size * sizeof(double), ALIGNMENT));
+    if(Q_UNLIKELY(vector == NULL))
+    {
+        QNN_FATAL_MSG("Can not allocate vector");
+    }
+    memset(vector, 0, size * sizeof(double));
+    return vector;
+}
+
+void freeDoubles(double *vector)
+{
+    qFreeAligned(vector);
+}
+
+float *allocateFloats(qint32 length)
+{
+    qint32 size = qMax(paddedLength(length, FLOAT_LANES), FLOAT_LANES);
+    float *vector = static_cast<float *>(qMallocAligned(size * sizeof(float), ALIGNMENT));
+    if(Q_UNLIKELY(vector == NULL))
+    {
+        QNN_FATAL_MSG("Can not allocate vector");
+    }
+    memset(vector, 0, size * sizeof(float));
+    return vector;
+}
+
+void freeFloats(float *vector)
+{
+    qFreeAligned(vector);
+}
+
+void matrixVectorProduct(const double *matrix, qint32 stride, qint32 rows, qint32 columns, const double *vector, const double *bias, double *result)
+{
+#if defined(__AVX__)
+    for(qint32 row = 0; row < rows; row += 4)
+    {
+        __m256d sum = _mm256_setzero_pd();
+        const double *column = matrix + row;
+        for(qint32 i = 0; i < columns; ++i, column += stride)
+        {
+            sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_load_pd(column), _mm256_broadcast_sd(vector + i)));
+        }
+        _mm256_store_pd(result + row, _mm256_add_pd(sum, _mm256_load_pd(bias + row)));
+    }
+#elif defined(__SSE2__)
+    for(qint32 row = 0; row < rows; row += 4)
+    {
+        __m128d sum_low = _mm_setzero_pd();
+        __m128d sum_high = _mm_setzero_pd();
+        const double *column = matrix + row;
+        for(qint32 i = 0; i < columns; ++i, column += stride)
+        {
+            __m128d value = _mm_set1_pd(vector[i]);
+            sum_low = _mm_add_pd(sum_low, _mm_mul_pd(_mm_load_pd(column), value));
+            sum_high = _mm_add_pd(sum_high, _mm_mul_pd(_mm_load_pd(column + 2), value));
+        }
+        _mm_store_pd(result + row, _mm_add_pd(sum_low, _mm_load_pd(bias + row)));
+        _mm_store_pd(result + row + 2, _mm_add_pd(sum_high, _mm_load_pd(bias + row + 2)));
+    }
+#else
+    for(qint32 row = 0; row < rows; ++row)
+    {
+        double sum = 0.0;
+        const double *column = matrix + row;
+        for(qint32 i = 0; i < columns; ++i, column += stride)
+        {
+            sum += *column * vector[i];
+        }
+        result[row] = sum + bias[row];
+    }
+#endif
+}
+
+void matrixVectorAccumulate(const double *matrix, qint32 stride, qint32 rows, qint32 columns, const double *vector, double *result)
+{
+#if defined(__AVX__)
+    for(qint32 row = 0; row < rows; row += 4)
+    {
+        __m256d sum = _mm256_load_pd(result + row);
+        const double *column = matrix + row;
+        for(qint32 i = 0; i < columns; ++i, column += stride)
+        {
+            sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_load_pd(column), _mm256_broadcast_sd(vector + i)));
+        }
+        _mm256_store_pd(result + row, sum);
+    }
+#elif defined(__SSE2__)
+    for(qint32 row = 0; row < rows; row += 4)
+    {
+        __m128d sum_low = _mm_load_pd(result + row);
+        __m128d sum_high = _mm_load_pd(result + row + 2);
+        const double *column = matrix + row;
+        for(qint32 i = 0; i < columns; ++i, column += stride)
+        {
+            __m128d value = _mm_set1_pd(vector[i]);
+            sum_low = _mm_add_pd(sum_low, _mm_mul_pd(_mm_load_pd(column), value));
+            sum_high = _mm_add_pd(sum_high, _mm_mul_pd(_mm_load_pd(column + 2), value));
+        }
+        _mm_store_pd(result + row, sum_low);
+        _mm_store_pd(result + row + 2, sum_high);
+    }
+#else
+    for(qint32 row = 0; row < rows; ++row)
+    {
+        double sum = result[row];
+        const double *column = matrix + row;
+        for(qint32 i = 0; i < columns; ++i, column += stride)
+        {
+            sum += *column * vector[i];
+        }
+        result[row] = sum;
+    }
+#endif
+}
+
+void matrixVectorProduct(const float *matrix, qint32 stride, qint32 rows, qint32 columns, const float *vector, const float *bias, float *result)
+{
+#if defined(__AVX__)
+    for(qint32 row = 0; row < rows; row += 8)
+    {
+        __m256 sum = _mm256_setzero_ps();
+        const float *column = matrix + row;
+        for(qint32 i = 0; i < columns; ++i, column += stride)
+        {
+            sum = _mm256_add_ps(sum, _mm256_mul_ps(_mm256_load_ps(column), _mm256_broadcast_ss(vector + i)));
+        }
+        _mm256_store_ps(result + row, _mm256_add_ps(sum, _mm256_load_ps(bias + row)));
+    }
+#elif defined(__SSE2__)
+    for(qint32 row = 0; row < rows; row += 8)
+    {
+        __m128 sum_low = _mm_setzero_ps();
+        __m128 sum_high = _mm_setzero_ps();
+        const float *column = matrix + row;
+        for(qint32 i = 0; i < columns; ++i, column += stride)
+        {
+            __m128 value = _mm_set1_ps(vector[i]);
+            sum_low = _mm_add_ps(sum_low, _mm_mul_ps(_mm_load_ps(column), value));
+            sum_high = _mm_add_ps(sum_high, _mm_mul_ps(_mm_load_ps(column + 4), value));
+        }
+        _mm_store_ps(result + row, _mm_add_ps(sum_low, _mm_load_ps(bias + row)));
+        _mm_store_ps(result + row + 4, _mm_add_ps(sum_high, _mm_load_ps(bias + row + 4)));
+    }
+#else
+    for(qint32 row = 0; row < rows; ++row)
+    {
+        float sum = 0.0f;
+        const float *column = matrix + row;
+        for(qint32 i = 0; i < columns; ++i, column += stride)
+        {
+            sum += *column * vector[i];
+        }
+        result[row] = sum + bias[row];
+    }
+#endif
+}
+
+void quantizedMatrixVectorProduct(const qint8 *matrix, const double *matrix_scale, qint32 rows, qint32 columns, const qint8 *vector, double vector_scale, const double *bias, double *result)
+{
+    for(qint32 row = 0; row < rows; ++row)
+    {
+        // Simple loop which is vectorized by the compiler
+        const qint8 *weights = matrix + row * columns;
+        qint32 sum = 0;
+        for(qint32 i = 0; i < columns; ++i)
+        {
+            sum += qint32(weights[i]) * qint32(vector[i]);
+        }
+        result[row] = sum * matrix_scale[row] * vector_scale + bias[row];
+    }
+}
+
+double quantize(const double *vector, qint32 length, qint8 *result)
+{
+    double max = 0.0;
+    for(qint32 i = 0; i < length; ++i)
+    {
+        max = qMax(max, qAbs(vector[i]));
+    }
+    if(max == 0.0)
+    {
+        for(qint32 i = 0; i < length; ++i)
+        {
+            result[i] = 0;
+        }
+        return 0.0;
+    }
+
+    double scale = max / 127.0;
+    for(qint32 i = 0; i < length; ++i)
+    {
+        result[i] = qint8(qRound(vector[i] / scale));
+    }
+    return scale;
+}
+
+void matrixMatrixProduct(const double *matrix, qint32 stride, qint32 rows, qint32 columns, const double *input, qint32 input_stride, qint32 samples, const double *bias, double *result)
+{
+    qint32 sample = 0;
+
+    // The sums of a small block of samples times 4 rows are kept in registers
+#if defined(__AVX__)
+    for(; sample + 4 <= samples; sample += 4)
+    {
+        const double *input0 = input + sample * input_stride;
+        const double *input1 = input0 + input_stride;
+        const double *input2 = input1 + input_stride;
+        const double *input3 = input2 + input_stride;
+        double *result0 = result + sample * stride;
+
+        for(qint32 row = 0; row < rows; row += 4)
+        {
+            __m256d sum0 = _mm256_setzero_pd();
+            __m256d sum1 = _mm256_setzero_pd();
+            __m256d sum2 = _mm256_setzero_pd();
+            __m256d sum3 = _mm256_setzero_pd();
+            const double *column = matrix + row;
+            for(qint32 i = 0; i < columns; ++i, column += stride)
+            {
+                __m256d weights = _mm256_load_pd(column);
+                sum0 = _mm256_add_pd(sum0, _mm256_mul_pd(weights, _mm256_broadcast_sd(input0 + i)));
+                sum1 = _mm256_add_pd(sum1, _mm256_mul_pd(weights, _mm256_broadcast_sd(input1 + i)));
+                sum2 = _mm256_add_pd(sum2, _mm256_mul_pd(weights, _mm256_broadcast_sd(input2 + i)));
+                sum3 = _mm256_add_pd(sum3, _mm256_mul_pd(weights, _mm256_broadcast_sd(input3 + i)));
+            }
+            __m256d bias_row = _mm256_load_pd(bias + row);
+            _mm256_store_pd(result0 + row, _mm256_add_pd(sum0, bias_row));
+            _mm256_store_pd(result0 + stride + row, _mm256_add_pd(sum1, bias_row));
+            _mm256_store_pd(result0 + 2*stride + row, _mm256_add_pd(sum2, bias_row));
+            _mm256_store_pd(result0 + 3*stride + row, _mm256_add_pd(sum3, bias_row));
+        }
+    }
+#elif defined(__SSE2__)
+    for(; sample + 2 <= samples; sample += 2)
+    {
+        const double *input0 = input + sample * input_stride;
+        const double *input1 = input0 + input_stride;
+        double *result0 = result + sample * stride;
+
+        for(qint32 row = 0; row < rows; row += 4)
+        {
+            __m128d sum0_low = _mm_setzero_pd();
+            __m128d sum0_high = _mm_setzero_pd();
+            __m128d sum1_low = _mm_setzero_pd();
+            __m128d sum1_high = _mm_setzero_pd();
+            const double *column = matrix + row;
+            for(qint32 i = 0; i < columns; ++i, column += stride)
+            {
+                __m128d weights_low = _mm_load_pd(column);
+                __m128d weights_high = _mm_load_pd(column + 2);
+                __m128d value0 = _mm_set1_pd(input0[i]);
+                __m128d value1 = _mm_set1_pd(input1[i]);
+                sum0_low = _mm_add_pd(sum0_low, _mm_mul_pd(weights_low, value0));
+                sum0_high = _mm_add_pd(sum0_high, _mm_mul_pd(weights_high, value0));
+                sum1_low = _mm_add_pd(sum1_low, _mm_mul_pd(weights_low, value1));
+                sum1_high = _mm_add_pd(sum1_high, _mm_mul_pd(weights_high, value1));
+            }
+            __m128d bias_low = _mm_load_pd(bias + row);
+            __m128d bias_high = _mm_load_pd(bias + row + 2);
+            _mm_store_pd(result0 + row, _mm_add_pd(sum0_low, bias_low));
+            _mm_store_pd(result0 + row + 2, _mm_add_pd(sum0_high, bias_high));
+            _mm_store_pd(result0 + stride + row, _mm_add_pd(sum1_low, bias_low));
+            _mm_store_pd(result0 + stride + row + 2, _mm_add_pd(sum1_high, bias_high));
+        }
+    }
+#endif
+
+    // Remaining samples
+    for(; sample < samples; ++sample)
+    {
+        matrixVectorProduct(matrix, stride, rows, columns, input + sample * input_stride, bias, result + sample * stride);
+    }
+}
+
+void lanewiseMatrixVectorProduct(const double *matrix, qint32 rows, qint32 columns, qint32 lanes, const double *vector, const double *bias, double *result)
+{
+    const qint32 column_stride = rows * lanes;
+    for(qint32 row = 0; row < rows; ++row)
+    {
+        for(qint32 lane = 0; lane < lanes; lane += 4)
+        {
+            const double *weights = matrix + row * lanes + lane;
+            const double *value = vector + lane;
+#if defined(__AVX__)
+            __m256d sum = _mm256_setzero_pd();
+            for(qint32 i = 0; i < columns; ++i, weights += column_stride, value += lanes)
+            {
+                sum = _mm256_add_pd(sum, _mm256_mul_pd(_mm256_load_pd(weights), _mm256_load_pd(value)));
+            }
+            _mm256_store_pd(result + row * lanes + lane, _mm256_add_pd(sum, _mm256_load_pd(bias + row * lanes + lane)));
+#elif defined(__SSE2__)
+            __m128d sum_low = _mm_setzero_pd();
+            __m128d sum_high = _mm_setzero_pd();
+            for(qint32 i = 0; i < columns; ++i, weights += column_stride, value += lanes)
+            {
+                sum_low = _mm_add_pd(sum_low, _mm_mul_pd(_mm_load_pd(weights), _mm_load_pd(value)));
+                sum_high = _mm_add_pd(sum_high, _mm_mul_pd(_mm_load_pd(weights + 2), _mm_load_pd(value + 2)));
+            }
+            _mm_store_pd(result + row * lanes + lane, _mm_add_pd(sum_low, _mm_load_pd(bias + row * lanes + lane)));
+            _mm_store_pd(result + row * lanes + lane + 2, _mm_add_pd(sum_high, _mm_load_pd(bias + row * lanes + lane + 2)));
+#else
+            double sum[4] = {0.0, 0.0, 0.0, 0.0};
+            for(qint32 i = 0; i < columns; ++i, weights += column_stride, value += lanes)
+            {
+                for(qint32 j = 0; j < 4; ++j)
+                {
+                    sum[j] += weights[j] * value[j];
+                }
+            }
+            for(qint32 j = 0; j < 4; ++j)
+            {
+                result[row * lanes + lane + j] = sum[j] + bias[row * lanes + lane + j];
+            }
+#endif
+        }
+    }
+}
+
+const char *instructionSet()
+{
+#if defined(__AVX__)
+    return "AVX";
+#elif defined(__SSE2__)
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
+}
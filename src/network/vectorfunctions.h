@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2015 Marcus Soll
+ * This file is part of qnn.
+ *
+ * qnn is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * qnn is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with qnn.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef VECTORFUNCTIONS_H
+#define VECTORFUNCTIONS_H
+
+#include <qnn-global.h>
+
+/*!
+ * \brief This namespace contains vectorized linear algebra functions used by the networks.
+ *
+ * The instruction set (AVX, SSE2 or plain C++) is selected at compile time. SSE2 is used by default, AVX requires building with CONFIG+=avx.
+ *
+ * All matrices are stored column-major. Each column is padded to paddedLength(rows) values (paddedLength(rows, FLOAT_LANES) for floats)
+ * and aligned to ALIGNMENT bytes, so that the kernels can always work on whole vector registers. Padding values must be 0.
+ */
+namespace VectorFunctions {
+
+/*!
+ * \brief Alignment in bytes of all buffers used with the functions of this namespace
+ */
+static const size_t ALIGNMENT = 64;
+
+/*!
+ * \brief Number of doubles all vectors are padded to
+ */
+static const qint32 DOUBLE_LANES = 4;
+
+/*!
+ * \brief Number of floats all float vectors are padded to
+ */
+static const qint32 FLOAT_LANES = 8;
+
+/*!
+ * \brief Returns the length of a vector after padding
+ * \param length Length of the vector
+ * \param lanes Number of values the vector is padded to
+ * \return Length rounded up to a multiple of lanes
+ */
+qint32 paddedLength(qint32 length, qint32 lanes = DOUBLE_LANES);
+
+/*!
+ * \brief Allocates an aligned vector of doubles initialised with 0
+ * \param length Length of the vector. The vector is padded to paddedLength(length)
+ * \return Aligned vector. Must be freed with freeDoubles
+ */
+double *allocateDoubles(qint32 length);
+
+/*!
+ * \brief Frees a vector allocated with allocateDoubles
+ * \param vector Vector to free. May be NULL
+ */
+void freeDoubles(double *vector);
+
+/*!
+ * \brief Allocates an aligned vector of floats initialised with 0
+ * \param length Length of the vector. The vector is padded to paddedLength(length, FLOAT_LANES)
+ * \return Aligned vector. Must be freed with freeFloats
+ */
+float *allocateFloats(qint32 length);
+
+/*!
+ * \brief Frees a vector allocated with allocateFloats
+ * \param vector Vector to free. May be NULL
+ */
+void freeFloats(float *vector);
+
+/*!
+ * \brief Calculates result = matrix * vector + bias
+ *
+ * For each row the products are summed up in the order of the columns before the bias is added.
+ * This matches the order of a plain scalar loop, so the results are the same on all instruction sets.
+ *
+ * \param matrix Column-major matrix. Column i starts at matrix + i*stride
+ * \param stride Distance between two columns. Must be paddedLength(rows)
+ * \param rows Number of rows
+ * \param columns Number of columns
+ * \param vector Vector with 'columns' values. Does not need to be aligned or padded
+ * \param bias Aligned bias vector with 'stride' values
+ * \param result Aligned vector with space for 'stride' values
+ */
+void matrixVectorProduct(const double *matrix, qint32 stride, qint32 rows, qint32 columns, const double *vector, const double *bias, double *result);
+
+/*!
+ * \brief Calculates result = result + matrix * vector
+ *
+ * The products are added to the existing value of result in the order of the columns.
+ * This matches a scalar loop that adds each product to a running sum.
+ *
+ * \param matrix Column-major matrix. Column i starts at matrix + i*stride
+ * \param stride Distance between two columns. Must be paddedLength(rows)
+ * \param rows Number of rows
+ * \param columns Number of columns
+ * \param vector Vector with 'columns' values. Does not need to be aligned or padded
+ * \param result Aligned vector with 'stride' values containing the start values of the sums
+ */
+void matrixVectorAccumulate(const double *matrix, qint32 stride, qint32 rows, qint32 columns, const double *vector, double *result);
+
+/*!
+ * \brief Calculates result = matrix * vector + bias in single precision
+ *
+ * This is the same as the double version, but twice as many values fit into a vector register.
+ *
+ * \param matrix Column-major matrix. Column i starts at matrix + i*stride
+ * \param stride Distance between two columns. Must be paddedLength(rows, FLOAT_LANES)
+ * \param rows Number of rows
+ * \param columns Number of columns
+ * \param vector Vector with 'columns' values. Does not need to be aligned or padded
+ * \param bias Aligned bias vector with 'stride' values
+ * \param result Aligned vector with space for 'stride' values
+ */
+void matrixVectorProduct(const float *matrix, qint32 stride, qint32 rows, qint32 columns, const float *vector, const float *bias, float *result);
+
+/*!
+ * \brief Calculates result = scale * (matrix * vector) + bias with 8 bit integer matrix and vector
+ *
+ * The products are accumulated as 32 bit integers. The result of row r is then scaled with matrix_scale[r] * vector_scale.
+ *
+ * \param matrix Row-major matrix. Row r starts at matrix + r*columns
+ * \param matrix_scale Scale of each row of the matrix
+ * \param rows Number of rows
+ * \param columns Number of columns
+ * \param vector Vector with 'columns' values
+ * \param vector_scale Scale of the vector
+ * \param bias Bias vector with 'rows' values
+ * \param result Vector with space for 'rows' values
+ */
+void quantizedMatrixVectorProduct(const qint8 *matrix, const double *matrix_scale, qint32 rows, qint32 columns, const qint8 *vector, double vector_scale, const double *bias, double *result);
+
+/*!
+ * \brief Quantizes a vector to 8 bit integers.
+ *
+ * The values are scaled so that the largest absolute value is mapped to 127.
+ *
+ * \param vector Vector to quantize
+ * \param length Length of the vector
+ * \param result Pointer to which 'length' quantized values are written
+ * \return Scale of the quantized vector. vector[i] is approximately result[i] * scale
+ */
+double quantize(const double *vector, qint32 length, qint8 *result);
+
+/*!
+ * \brief Calculates result = input * matrix^T + bias for a number of samples
+ *
+ * Each row of input is one sample. The summation order for each value is the same as in matrixVectorProduct,
+ * so every sample gets exactly the same result as a call to matrixVectorProduct.
+ * Several samples are processed at once so that each loaded column of the matrix is reused for all of them.
+ *
+ * \param matrix Column-major matrix. Column i starts at matrix + i*stride
+ * \param stride Distance between two columns. Must be paddedLength(rows)
+ * \param rows Number of rows
+ * \param columns Number of columns
+ * \param input Row-major input with one sample per row. Does not need to be aligned or padded
+ * \param input_stride Distance between two samples in input
+ * \param samples Number of samples
+ * \param bias Aligned bias vector with 'stride' values
+ * \param result Aligned row-major output. Sample i starts at result + i*stride
+ */
+void matrixMatrixProduct(const double *matrix, qint32 stride, qint32 rows, qint32 columns, const double *input, qint32 input_stride, qint32 samples, const double *bias, double *result);
+
+/*!
+ * \brief Calculates a matrix-vector product for a number of independent matrices and vectors at once
+ *
+ * Matrix, vector and bias of all lanes are interleaved so that the same element of all lanes is stored consecutively:
+ * result[r*lanes+k] = sum over c of matrix[(c*rows+r)*lanes+k] * vector[c*lanes+k], plus bias[r*lanes+k].
+ * The products are summed up in the same order as in matrixVectorProduct, so each lane gets exactly the same result.
+ *
+ * \param matrix Aligned interleaved matrices
+ * \param rows Number of rows
+ * \param columns Number of columns
+ * \param lanes Number of lanes. Must be paddedLength of the number of matrices
+ * \param vector Aligned interleaved vectors
+ * \param bias Aligned interleaved bias vectors
+ * \param result Aligned interleaved output with space for rows*lanes values
+ */
+void lanewiseMatrixVectorProduct(const double *matrix, qint32 rows, qint32 columns, qint32 lanes, const double *vector, const double *bias, double *result);
+
+/*!
+ * \brief Returns the name of the instruction set used by the kernels
+ * \return Name of the instruction set
+ */
+const char *instructionSet();
+}
+
+#endif // VECTORFUNCTIONS_H
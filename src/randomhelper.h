@@ -4,6 +4,7 @@
 #include <qnn-global.h>
 
 #include <random>
+#include <sstream>
 #include <QVector>
 #include <QThread>
 #include <QTime>
@@ -14,22 +15,17 @@
  */
 namespace RandomHelper {
 /*!
- * \brief Random engine
- */
-static thread_local std::mt19937 rnd;
-
-/*!
- * \brief Shows wether the random engine has been initialised
- */
-static thread_local bool initialised = false;
-
-/*!
- * \brief Initialises the engine
+ * \brief Returns the random engine of the current thread
+ *
+ * Each thread has its own engine. Because the engine is a static variable of an inline function all translation units share the same engine per thread.
+ * The engine is initialised on first use.
  *
- * This method checks wether the random engine has been initialised and initialises the random engine if it has not been initialised
+ * \return Random engine of the current thread
  */
-inline void check_initialised()
+inline std::mt19937 &engine()
 {
+    static thread_local std::mt19937 rnd;
+    static thread_local bool initialised = false;
     if(Q_UNLIKELY(!initialised))
     {
         std::random_device random_device;
@@ -43,6 +39,36 @@ inline void check_initialised()
         rnd.seed(seed);
         initialised = true;
     }
+    return rnd;
+}
+
+/*!
+ * \brief Returns the state of the random engine of the current thread
+ * \return State of the engine. Can be restored with restoreState
+ */
+inline QString saveState()
+{
+    std::ostringstream stream;
+    stream << engine();
+    return QString::fromStdString(stream.str());
+}
+
+/*!
+ * \brief Restores the state of the random engine of the current thread
+ * \param state State created by saveState
+ * \return True if the state was restored
+ */
+inline bool restoreState(QString state)
+{
+    std::istringstream stream(state.toStdString());
+    std::mt19937 rnd;
+    stream >> rnd;
+    if(stream.fail())
+    {
+        return false;
+    }
+    engine() = rnd;
+    return true;
 }
 
 /*!
@@ -53,9 +79,8 @@ inline void check_initialised()
  */
 inline qint32 getRandomInt(qint32 min, qint32 max)
 {
-    check_initialised();
     std::uniform_int_distribution<qint32> distribution(min, max);
-    return distribution(rnd);
+    return distribution(engine());
 }
 
 /*!
@@ -66,9 +91,8 @@ inline qint32 getRandomInt(qint32 min, qint32 max)
  */
 inline double getRandomDouble(double min, double max)
 {
-    check_initialised();
     std::uniform_real_distribution<double> distribution(min, max);
-    return distribution(rnd);
+    return distribution(engine());
 }
 
 /*!
@@ -77,9 +101,8 @@ inline double getRandomDouble(double min, double max)
  */
 inline double getNormalDistributedDouble()
 {
-    check_initialised();
     std::normal_distribution<double> distribution;
-    return distribution(rnd);
+    return distribution(engine());
 }
 
 /*!
@@ -88,9 +111,8 @@ inline double getNormalDistributedDouble()
  */
 inline bool getRandomBool()
 {
-    check_initialised();
     std::uniform_int_distribution<qint32> distribution(0, 1);
-    return distribution(rnd);
+    return distribution(engine());
 }
 }
 
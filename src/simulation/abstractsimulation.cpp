@@ -23,12 +23,14 @@
 
 AbstractSimulation::AbstractSimulation() :
     _network(NULL),
-    _gene(NULL)
+    _gene(NULL),
+    _trial_network(NULL)
 { 
 }
 
 AbstractSimulation::~AbstractSimulation()
 {
+    delete _trial_network;
     delete _network;
     delete _gene;
 }
@@ -49,6 +51,27 @@ void AbstractSimulation::initialise(AbstractNeuralNetwork *network, GenericGene
     _initialise();
 }
 
+void AbstractSimulation::reinitialise(GenericGene *gene)
+{
+    if(Q_UNLIKELY(_network == NULL || _gene == NULL))
+    {
+        QNN_FATAL_MSG("Simulation not initialised");
+    }
+    if(Q_UNLIKELY(gene == NULL))
+    {
+        QNN_FATAL_MSG("Trying to initialise with NULL");
+    }
+
+    delete _gene;
+    _gene = gene->createCopy();
+    if(_trial_network != NULL)
+    {
+        // The trial network uses the copy of the simulation, so the gene is only copied once per evaluation
+        _trial_network->reinitialiseShared(_gene);
+    }
+    _initialise();
+}
+
 double AbstractSimulation::getScore()
 {
     if(Q_UNLIKELY(_network == NULL || _gene == NULL))
@@ -57,3 +80,34 @@ double AbstractSimulation::getScore()
     }
     return _getScore();
 }
+
+QString AbstractSimulation::configDescription()
+{
+    return QString();
+}
+
+bool AbstractSimulation::supportsLockstep()
+{
+    return false;
+}
+
+QList<double> AbstractSimulation::getLockstepScores(FeedForwardNetworkEnsemble *ensemble)
+{
+    Q_UNUSED(ensemble);
+    QNN_CRITICAL_MSG("Simulation does not support lockstep evaluation");
+    return QList<double>();
+}
+
+AbstractNeuralNetwork *AbstractSimulation::trialNetwork()
+{
+    if(_trial_network == NULL)
+    {
+        _trial_network = _network->createConfigCopy();
+        _trial_network->reinitialiseShared(_gene);
+    }
+    else
+    {
+        _trial_network->resetState();
+    }
+    return _trial_network;
+}
@@ -24,6 +24,11 @@
 #include "../network/abstractneuralnetwork.h"
 #include "../network/genericgene.h"
 
+#include <QList>
+#include <QString>
+
+class FeedForwardNetworkEnsemble;
+
 /*!
  * \brief The AbstractSimulation class is the base class for all simulations.
  *
@@ -37,7 +42,10 @@
  *
  * A simulation starts in an uninitialised state. The function getScore can only be called after the simulation has be initialised.
  *
- * A subclass of this must overwrite all virtual methods.
+ * A subclass of this must overwrite all pure virtual methods.
+ *
+ * Simulations may optionally support lockstep evaluation, where a FeedForwardNetworkEnsemble is used to evaluate a number of
+ * FeedForwardNetworks at once. To support this a subclass must overwrite supportsLockstep and getLockstepScores.
  */
 class QNNSHARED_EXPORT AbstractSimulation
 {
@@ -62,6 +70,15 @@ public:
      */
     void initialise(AbstractNeuralNetwork *network, GenericGene *gene);
 
+    /*!
+     * \brief Initialises an already initialised simulation with a new gene.
+     *
+     * The network given at initialise is kept. Networks used by the simulation are reused, so this is faster than creating a new simulation for each gene.
+     *
+     * \param gene The gene defining the network to test. The caller has to delete the gene
+     */
+    void reinitialise(GenericGene *gene);
+
     /*!
      * \brief Returns the score of the network.
      * \return Score of network
@@ -86,6 +103,39 @@ public:
      */
     virtual AbstractSimulation *createConfigCopy() = 0;
 
+    /*!
+     * \brief Returns a description of the configuration of the simulation.
+     *
+     * Simulations of the same type and configuration must return the same description. It is compared in the handshake between DistributedEvaluator and DistributedWorker.
+     * The default implementation returns an empty string.
+     *
+     * \return Description of the configuration
+     */
+    virtual QString configDescription();
+
+    /*!
+     * \brief Returns if the simulation supports lockstep evaluation with getLockstepScores.
+     *
+     * The default implementation returns false.
+     *
+     * \return True if lockstep evaluation is supported
+     */
+    virtual bool supportsLockstep();
+
+    /*!
+     * \brief Returns the score of all individuals of an ensemble.
+     *
+     * All individuals are run in lockstep. The score of each individual must follow the same distribution as getScore for
+     * a simulation initialised with the gene of the individual.
+     * The simulation does not need to be initialised for this function.
+     *
+     * The default implementation prints an error and returns an empty list.
+     *
+     * \param ensemble Initialised ensemble with the input / output length needed by the simulation. The caller has to delete the ensemble
+     * \return Score of each individual of the ensemble
+     */
+    virtual QList<double> getLockstepScores(FeedForwardNetworkEnsemble *ensemble);
+
 protected:
     /*!
      * \brief Initialises the simulation
@@ -103,6 +153,16 @@ protected:
      */
     virtual double _getScore() = 0;
 
+    /*!
+     * \brief Returns a network initialised with _gene which can be used for a single trial.
+     *
+     * The network is created on the first call. Further calls only reset the state of the network, so the topology is not decoded again for each trial.
+     * The returned network is in the same state as a newly initialised network.
+     *
+     * \return Initialised network. The network is owned by the simulation
+     */
+    AbstractNeuralNetwork *trialNetwork();
+
     /*!
      * \brief The uninitialised network that should be tested.
      */
@@ -112,6 +172,11 @@ protected:
      * \brief The gene of the network that should be tested.
      */
     GenericGene *_gene;
+
+    /*!
+     * \brief The network returned by trialNetwork.
+     */
+    AbstractNeuralNetwork *_trial_network;
 };
 
 #endif // ABSTRACTSIMULATION_H
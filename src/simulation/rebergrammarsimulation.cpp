@@ -433,13 +433,11 @@ char getRandomReberChar()
     }
 }
 
-QList<double> reberCharToInput(char c)
+void reberCharToInput(char c, double *input)
 {
-    QList<double> input;
-    input.reserve(7);
     for(qint32 i = 0; i < 7; ++i)
     {
-        input << 0.0;
+        input[i] = 0.0;
     }
 
     switch (c) {
@@ -467,21 +465,20 @@ QList<double> reberCharToInput(char c)
     default:
         break;
     }
-
-    return input;
 }
 
-char networkToReberOutput(AbstractNeuralNetwork *network)
+char networkToReberOutput(AbstractNeuralNetwork *network, double *output)
 {
     double max_value = -10.0;
     qint32 max = -1;
 
+    network->getOutputs(output);
     for(qint32 i = 0; i < 8; ++i)
     {
-        if(network->getNeuronOutput(i) > max_value)
+        if(output[i] > max_value)
         {
             max = i;
-            max_value = network->getNeuronOutput(i);
+            max_value = output[i];
         }
     }
     switch(max) {
@@ -556,6 +553,17 @@ AbstractSimulation *ReberGrammarSimulation::createConfigCopy()
     return new ReberGrammarSimulation(_config);
 }
 
+QString ReberGrammarSimulation::configDescription()
+{
+    return QString("mode=%1;embedded=%2;trials_detect=%3;trials_create=%4;detect_threshold=%5;max_depth=%6")
+            .arg(_config.mode)
+            .arg(_config.embedded)
+            .arg(_config.trials_detect)
+            .arg(_config.trials_create)
+            .arg(_config.detect_threshold, 0, 'g', 17)
+            .arg(_config.max_depth);
+}
+
 void ReberGrammarSimulation::_initialise()
 {
 }
@@ -586,10 +594,13 @@ double ReberGrammarSimulation::_getScore()
         break;
     }
 
+    double input[7];
+    // The network may have more outputs than the simulation uses
+    QVector<double> output(qMax(8, _network->lenOutput()));
+
     for(qint32 trial = 0; trial < max_trials; ++trial)
     {
-        AbstractNeuralNetwork *network = _network->createConfigCopy();
-        network->initialise(_gene);
+        AbstractNeuralNetwork *network = trialNetwork();
 
         QString word;
         QString input_word;
@@ -616,9 +627,9 @@ double ReberGrammarSimulation::_getScore()
 
             while(input_word.length() != 0)
             {
-                QList<double> input = reberCharToInput(input_word.at(0).toLatin1());
+                reberCharToInput(input_word.at(0).toLatin1(), input);
                 input_word.remove(0,1);
-                network->processInput(input);
+                network->processInput(input, 7);
             }
             if((network->getNeuronOutput(0) >= _config.detect_threshold) == reber_function(word, reber_verify_word, _config.max_depth))
             {
@@ -638,9 +649,9 @@ double ReberGrammarSimulation::_getScore()
             }
             for(QString::Iterator input_iter = input_word.begin(); input_iter !=input_word.end(); ++input_iter)
             {
-                QList<double> input = reberCharToInput((*input_iter).toLatin1());
-                network->processInput(input);
-                c_output = networkToReberOutput(network);
+                reberCharToInput((*input_iter).toLatin1(), input);
+                network->processInput(input, 7);
+                c_output = networkToReberOutput(network, output.data());
             }
             qint32 current_depth = _config.max_depth-input_word.length();
             bool finished = c_output == '\0';
@@ -654,9 +665,9 @@ double ReberGrammarSimulation::_getScore()
             while(!finished && current_depth-- > 0)
             {
                 input_word.append(c_output);
-                QList<double> input = reberCharToInput(c_output);
-                network->processInput(input);
-                c_output = networkToReberOutput(network);
+                reberCharToInput(c_output, input);
+                network->processInput(input, 7);
+                c_output = networkToReberOutput(network, output.data());
                 finished = c_output == '\0';
             }
 
@@ -666,7 +677,6 @@ double ReberGrammarSimulation::_getScore()
             }
             break;
         }
-        delete network;
     }
     return score / max_trials;
 }
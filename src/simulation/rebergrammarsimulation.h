@@ -122,6 +122,12 @@ public:
      */
     AbstractSimulation *createConfigCopy();
 
+    /*!
+     * \brief Overwritten function to describe the configuration of the simulation
+     * \return Description of the configuration
+     */
+    QString configDescription();
+
 protected:
     /*!
      * \brief Overwritten function to initialise the simulation
@@ -18,6 +18,8 @@
 
 #include "tmazesimulation.h"
 
+#include "../network/feedforwardnetworkensemble.h"
+
 #include <randomhelper.h>
 
 namespace {
@@ -56,6 +58,16 @@ AbstractSimulation *TMazeSimulation::createConfigCopy()
     return new TMazeSimulation(_config);
 }
 
+QString TMazeSimulation::configDescription()
+{
+    return QString("trials=%1;max_timesteps=%2;range_input=%3;generateTMaze=%4;G1Correct=%5")
+            .arg(_config.trials)
+            .arg(_config.max_timesteps)
+            .arg(_config.range_input)
+            .arg(_config.generateTMaze == &generateStandardTMaze ? "standard" : "non-standard")
+            .arg(_config.G1Correct == &standardG1Correct ? "standard" : "non-standard");
+}
+
 void TMazeSimulation::_initialise()
 {
 }
@@ -63,6 +75,9 @@ void TMazeSimulation::_initialise()
 double TMazeSimulation::_getScore()
 {
     double score = 0.0;
+    QVector<double> input(_config.range_input);
+    // The network may have more outputs than the simulation uses
+    QVector<double> output(qMax(4, _network->lenOutput()));
 
     for(qint32 trial = 0; trial < _config.trials; ++trial)
     {
@@ -70,18 +85,10 @@ double TMazeSimulation::_getScore()
         qint32 position = 0;
         bool goalNotReached = true;
 
-        AbstractNeuralNetwork *network = _network->createConfigCopy();
-        network->initialise(_gene);
+        AbstractNeuralNetwork *network = trialNetwork();
         for(qint32 timestep = 0; timestep < _config.max_timesteps && goalNotReached; ++timestep)
         {
-            Direction direction = start_direction;
-            double max_output = -10.0;
-
-            QList<double> input;
-            for(qint32 i = 0; i < _config.range_input; ++i)
-            {
-                input << 0.0;
-            }
+            input.fill(0.0);
             if(TMaze[position] != 0)
             {
                 if(Q_UNLIKELY(TMaze[position] > _config.range_input))
@@ -90,74 +97,152 @@ double TMazeSimulation::_getScore()
                 }
                 input[TMaze[position]-1] = 1.0;
             }
-            network->processInput(input);
+            network->processInput(input.constData(), input.size());
+            network->getOutputs(output.data());
+            goalNotReached = performStep(TMaze, &position, output.constData(), &score);
+        }
+    }
 
-            for(qint32 i = 0; i < 4; ++i)
-            {
-                double output = network->getNeuronOutput(i);
-                if(output > max_output)
-                {
-                    max_output = output;
-                    direction = (Direction) i;
-                }
-                else if(output == max_output)
-                {
-                    direction = none_direction;
-                }
-            }
+    return score / _config.trials;
+}
 
-            switch(direction)
-            {
-            case start_direction:
-                QNN_WARNING_MSG("Direction ist start_direction");
-                break;
+bool TMazeSimulation::supportsLockstep()
+{
+    return true;
+}
 
-            case none_direction:
-                break;
+QList<double> TMazeSimulation::getLockstepScores(FeedForwardNetworkEnsemble *ensemble)
+{
+    if(Q_UNLIKELY(ensemble == NULL || ensemble->lenInput() != _config.range_input || ensemble->lenOutput() != 4))
+    {
+        QNN_FATAL_MSG("Ensemble does not match simulation");
+    }
 
-            case up_direction:
-                if(position < TMaze.size()-1)
-                {
-                    ++position;
-                }
-                break;
+    qint32 individuals = ensemble->numberIndividuals();
+    QVector<double> score(individuals, 0.0);
+    QVector<double> input(individuals * _config.range_input);
+    QVector<double> output(individuals * 4);
+    QVector< QVector<qint32> > TMaze(individuals);
+    QVector<qint32> position(individuals);
+    QVector<bool> goalNotReached(individuals);
 
-            case down_direction:
-                if(position > 0)
-                {
-                    --position;
-                }
-                break;
+    for(qint32 trial = 0; trial < _config.trials; ++trial)
+    {
+        for(qint32 individual = 0; individual < individuals; ++individual)
+        {
+            TMaze[individual] = _config.generateTMaze();
+            position[individual] = 0;
+            goalNotReached[individual] = true;
+        }
+        qint32 running = individuals;
 
-            case left_direction:
-                if(position == TMaze.size()-1)
+        for(qint32 timestep = 0; timestep < _config.max_timesteps && running > 0; ++timestep)
+        {
+            input.fill(0.0);
+            for(qint32 individual = 0; individual < individuals; ++individual)
+            {
+                qint32 value = TMaze[individual][position[individual]];
+                if(goalNotReached[individual] && value != 0)
                 {
-                    // G1
-                    goalNotReached = false;
-                    if(_config.G1Correct(TMaze))
+                    if(Q_UNLIKELY(value > _config.range_input))
                     {
-                        score += 1.0;
+                        QNN_FATAL_MSG("Value out of range");
                     }
+                    input[individual * _config.range_input + value-1] = 1.0;
                 }
-                break;
+            }
+            ensemble->processInput(input.constData());
+            ensemble->getOutputs(output.data());
 
-            case right_direction:
-                if(position == TMaze.size()-1)
+            for(qint32 individual = 0; individual < individuals; ++individual)
+            {
+                if(goalNotReached[individual])
                 {
-                    // G2
-                    goalNotReached = false;
-                    if(!_config.G1Correct(TMaze))
+                    goalNotReached[individual] = performStep(TMaze[individual], &position[individual], output.constData() + individual * 4, &score[individual]);
+                    if(!goalNotReached[individual])
                     {
-                        score += 1.0;
+                        --running;
                     }
                 }
-                break;
             }
         }
-        delete network;
     }
 
-    return score / _config.trials;
+    QList<double> scores;
+    scores.reserve(individuals);
+    for(qint32 individual = 0; individual < individuals; ++individual)
+    {
+        scores << score[individual] / _config.trials;
+    }
+    return scores;
+}
+
+bool TMazeSimulation::performStep(const QVector<qint32> &TMaze, qint32 *position, const double *output, double *score)
+{
+    Direction direction = start_direction;
+    double max_output = -10.0;
+
+    for(qint32 i = 0; i < 4; ++i)
+    {
+        if(output[i] > max_output)
+        {
+            max_output = output[i];
+            direction = (Direction) i;
+        }
+        else if(output[i] == max_output)
+        {
+            direction = none_direction;
+        }
+    }
+
+    switch(direction)
+    {
+    case start_direction:
+        QNN_WARNING_MSG("Direction ist start_direction");
+        break;
+
+    case none_direction:
+        break;
+
+    case up_direction:
+        if(*position < TMaze.size()-1)
+        {
+            ++*position;
+        }
+        break;
+
+    case down_direction:
+        if(*position > 0)
+        {
+            --*position;
+        }
+        break;
+
+    case left_direction:
+        if(*position == TMaze.size()-1)
+        {
+            // G1
+            if(_config.G1Correct(TMaze))
+            {
+                *score += 1.0;
+            }
+            return false;
+        }
+        break;
+
+    case right_direction:
+        if(*position == TMaze.size()-1)
+        {
+            // G2
+            if(!_config.G1Correct(TMaze))
+            {
+                *score += 1.0;
+            }
+            return false;
+        }
+        break;
+    }
+    return true;
 }
 
 QVector<qint32> TMazeSimulation::generateStandardTMaze()
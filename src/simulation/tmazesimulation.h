@@ -130,6 +130,28 @@ public:
      */
     AbstractSimulation *createConfigCopy();
 
+    /*!
+     * \brief Overwritten function to describe the configuration of the simulation
+     * \return Description of the configuration
+     */
+    QString configDescription();
+
+    /*!
+     * \brief Overwritten function to show that lockstep evaluation is supported
+     * \return True
+     */
+    bool supportsLockstep();
+
+    /*!
+     * \brief Overwritten function to calculate the score of all individuals of an ensemble
+     *
+     * Each individual walks its own randomly generated t-mazes.
+     *
+     * \param ensemble Initialised ensemble
+     * \return Score of each individual
+     */
+    QList<double> getLockstepScores(FeedForwardNetworkEnsemble *ensemble);
+
 protected:
 
     /*!
@@ -142,6 +164,16 @@ protected:
      */
     double _getScore();
 
+    /*!
+     * \brief Moves the robot according to the output of the network
+     * \param TMaze Current t-maze
+     * \param position Pointer to the position of the robot. The new position is written to it
+     * \param output Output of the network
+     * \param score Pointer to the score. The score is increased if the correct goal is reached
+     * \return False if a goal has been reached
+     */
+    bool performStep(const QVector<qint32> &TMaze, qint32 *position, const double *output, double *score);
+
     /*!
      * \brief Configuration of the simulation
      */